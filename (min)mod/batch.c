@@ -0,0 +1,91 @@
+#include "batch.h"
+#include "records.h"
+#include "lib/minmod.h"
+#include "tools/list.h"
+#include "tools/log.h"
+#include "tools/mem_tools.h"
+#include "tools/platform.h"
+#include "tools/work_stealing.h"
+
+struct Batch {
+        // "char *"s, the paths of the programs.
+        struct List file_paths;
+
+        const struct BatchOptions * options;
+
+        FILE * output;
+
+        // Keeps records from being written into each other.
+        struct Mutex output_mutex;
+
+        // Only written with "output_mutex" locked.
+        bool has_failures;
+};
+
+// Loads and runs the program "job" of "arg", a "struct Batch", and writes
+// its record.
+static void run_program(void * arg, size_t job)
+{
+        struct Batch * batch = arg;
+        const char * file_path = *(char * const *) get_list_elem_const(&batch->file_paths, job);
+
+        uint64_t start_ns = get_monotonic_ns();
+
+        // The log of a context only holds what the last call logged, so the
+        // log of loading the program is kept before running it.
+        struct MinmodContext * context = create_minmod_context();
+        struct List log = create_list(sizeof(char), NULL);
+        if (load_minmod_file(context, file_path)) {
+                append_str(&log, get_minmod_log(context));
+                set_minmod_limits(context, batch->options->max_steps,
+                                  batch->options->time_limit_ms);
+                set_minmod_memory_quota(context, batch->options->max_memory);
+                (void) run_minmod_steps(context, UINT64_MAX);
+        }
+        append_str(&log, get_minmod_log(context));
+
+        uint64_t time_ns = get_monotonic_ns() - start_ns;
+
+        char terminator = '\0';
+        list_append(&log, &terminator);
+
+        struct List record = create_list(sizeof(char), NULL);
+        append_run_record(&record, job, file_path, context, log.contents, time_ns);
+        bool is_finished = get_minmod_status(context) == MINMOD_FINISHED;
+
+        destroy_list(&log);
+        destroy_minmod_context(context);
+
+        lock_mutex(&batch->output_mutex);
+
+        fwrite(record.contents, sizeof(char), record.length, batch->output);
+        fflush(batch->output);
+        if (!is_finished) {
+                batch->has_failures = true;
+        }
+
+        unlock_mutex(&batch->output_mutex);
+
+        destroy_list(&record);
+}
+
+bool run_batch(const struct BatchOptions * options, FILE * output)
+{
+        struct Batch batch;
+        batch.options = options;
+        batch.output = output;
+        create_mutex(&batch.output_mutex);
+        batch.has_failures = false;
+
+        bool is_read = read_manifest(options->manifest_path, &batch.file_paths);
+        if (is_read) {
+                run_jobs(batch.file_paths.length, options->thread_count, run_program, &batch);
+        } else {
+                LOG_ERROR("Failed to read the manifest \"%s\".\n", options->manifest_path);
+        }
+
+        destroy_mutex(&batch.output_mutex);
+        destroy_list(&batch.file_paths);
+
+        return is_read && !batch.has_failures;
+}
@@ -0,0 +1,36 @@
+// Batch mode, which runs every program listed in a manifest in a single
+// process, spread over several threads, and writes a record of how each of
+// them went.
+// The manifest and the records are described in "records.h". Records are
+// written as soon as a program is done, and so not necessarily in the order
+// of the manifest.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct BatchOptions {
+        const char * manifest_path;
+        int thread_count;
+
+        // Each program is stopped after "max_steps" steps or
+        // "time_limit_ms" milliseconds of running, and when its stacks are
+        // about to take more than "max_memory" bytes. 0 means no limit.
+        // A program that never finishes can't keep a thread to itself then,
+        // nor take the memory of the others.
+        uint64_t max_steps;
+        uint64_t time_limit_ms;
+        size_t max_memory;
+};
+
+// Runs the programs listed in the manifest of "options", and writes their
+// records to "output".
+// Returns "false" if the manifest can't be read, or if any program fails or
+// is stopped.
+bool run_batch(const struct BatchOptions * options, FILE * output);
+
+#endif
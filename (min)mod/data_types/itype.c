@@ -1,141 +1,272 @@
-#include "itype.h"
-#include <string.h>
-#include "../tools/list.h"
-#include "../settings.h"
-#include "stack.h"
-#include "../tools/mem_tools.h"
-
-void destroy_itype(struct IType * itype)
-{
-        ASSERT(false, "Cannot destroy instruction types.");
-}
-
-void destroy_itype_void_ptr(void * itype)
-{
-        destroy_itype(itype);
-}
-
-bool itype_in_list(const struct List * itype_list, const char * instr_name)
-{
-        for (size_t i = 0; i < itype_list->length; ++i) {
-
-                const struct IType * curr_itype = get_list_elem_const(itype_list, i);
-
-                if (strcmp(curr_itype->name, instr_name) == 0) {
-                        return true;
-                }
-        }
-
-        return false;
-}
-
-static struct IType create_itype(const char * name)
-{
-        struct IType itype;
-        itype.value = NULL;
-
-        itype.name = ALLOC(char, strlen(name) + 1);
-        strcpy(itype.name, name);
-
-        return itype;
-}
-
-void add_itype_to_list(struct List * itype_list, const char * instr_name)
-{
-        ASSERT(!itype_in_list(itype_list, instr_name),
-               "Instruction %s already in instruction " LIST_FS ".",
-               instr_name, LIST_FA(*itype_list));
-
-        struct IType new_itype = create_itype(instr_name);
-        list_append(itype_list, &new_itype);
-}
-
-instr_id_t find_instr_id(const struct List * itype_list, const char * instr_name)
-{
-        for (size_t i = 0; i < itype_list->length; ++i) {
-
-                const struct IType * curr_itype = get_list_elem_const(itype_list, i);
-
-                if (strcmp(curr_itype->name, instr_name) == 0) {
-                        return (instr_id_t) i;
-                }
-        }
-
-        ASSERT(false, "Could not find instruction %s in instruction " LIST_FS ".",
-               instr_name, LIST_FA(*itype_list));
-
-        return -1;
-}
-
-struct IType * id_to_itype(struct List * itype_list, instr_id_t id)
-{
-        return get_list_elem(itype_list, id);
-}
-
-const struct IType * id_to_itype_const(const struct List * itype_list, instr_id_t id)
-{
-        return get_list_elem_const(itype_list, id);
-}
-
-struct IType * instr_name_to_itype(struct List * itype_list, const char * instr_name)
-{
-        instr_id_t id = find_instr_id(itype_list, instr_name);
-        return id_to_itype(itype_list, id);
-}
-
-static bool must_be_logged(const char * itype_name)
-{
-        if (strcmp(itype_name, g_instr_stack_str) == 0) {
-                return true;
-        }
-        if (strcmp(itype_name, g_data_stack_str) == 0) {
-                return true;
-        }
-        return false;
-}
-
-void log_itype_list(int log_level, const struct List * list)
-{
-        if (!LOGGABLE(log_level)) {
-                return;
-        }
-
-        bool first_logging = true;
-        for (size_t i = 0; i < list->length; ++i) {
-
-                const struct IType * curr_itype = get_list_elem_const(list, i);
-
-                if (!(is_itype_loggable(curr_itype->name) || must_be_logged(curr_itype->name))) {
-                        continue;
-                }
-
-                if (first_logging) {
-                        first_logging = false;
-                } else {
-                        LOG(log_level, "\n");
-                }
-
-                LOG(log_level, "%s: ", curr_itype->name);
-
-                if (curr_itype->value) {
-                        log_stack_backwards(log_level, curr_itype->value, list);
-                } else {
-                        LOG(log_level, "[uninitialized]");
-                }
-        }
-}
-
-bool is_builtin(instr_id_t id)
-{
-        return id < 0;
-}
-
-instr_id_t builtin_to_id(enum Builtin builtin)
-{
-        return -builtin - 1;
-}
-
-enum Builtin id_to_builtin(instr_id_t id)
-{
-        return -id - 1;
-}
+#include "itype.h"
+#include <string.h>
+#include "../tools/list.h"
+#include "../settings.h"
+#include "stack.h"
+#include "../tools/mem_tools.h"
+#include "../tools/ptr_map.h"
+
+static struct IType create_itype(const char * name)
+{
+        struct IType itype;
+        itype.name = name;
+        itype.value = NULL;
+        itype.constant_builtin = BUILTINS_COUNT;
+
+        return itype;
+}
+
+void add_interned_itypes(struct ITypeList * itype_list)
+{
+        size_t names_count = str_table_length(&itype_list->names);
+        for (size_t id = itype_list->itypes.length; id < names_count; ++id) {
+                struct IType new_itype = create_itype(str_table_get(&itype_list->names, id));
+                list_append(&itype_list->itypes, &new_itype);
+        }
+}
+
+struct ITypeList create_itype_list(void)
+{
+        struct ITypeList itype_list;
+        // The values are destroyed along with the list, rather than with
+        // each instruction type, since they can be shared.
+        itype_list.itypes = create_list(sizeof(struct IType), NULL);
+        itype_list.names = create_str_table();
+
+        add_itype_to_list(&itype_list, g_instr_stack_str);
+        add_itype_to_list(&itype_list, g_data_stack_str);
+
+        return itype_list;
+}
+
+// Appends "stack" to "stacks" unless it's in "found" already.
+static void find_stack(struct Stack * stack, struct List * stacks, struct PtrMap * found)
+{
+        if (!ptr_map_contains(found, stack)) {
+                ptr_map_insert(found, stack, stacks->length);
+                list_append(stacks, &stack);
+        }
+}
+
+struct List find_reachable_stacks(const struct ITypeList * itype_list)
+{
+        struct List stacks = create_list(sizeof(struct Stack *), NULL);
+        struct PtrMap found = create_ptr_map();
+
+        for (size_t i = 0; i < itype_list->itypes.length; ++i) {
+                const struct IType * itype = id_to_itype_const(itype_list, i);
+                if (itype->value) {
+                        find_stack(itype->value, &stacks, &found);
+                }
+        }
+
+        for (size_t i = 0; i < stacks.length; ++i) {
+                struct Stack * stack = *(struct Stack **) get_list_elem(&stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_SUBSTACK) {
+                                find_stack(elem->substack, &stacks, &found);
+                        } else if (elem->type == STACK_ELEM_STACK_REF) {
+                                find_stack(elem->stack_ref, &stacks, &found);
+                        }
+                }
+        }
+
+        destroy_ptr_map(&found);
+
+        return stacks;
+}
+
+void destroy_itype_list(struct ITypeList * itype_list)
+{
+        // Stacks referring to each other in a cycle are never destroyed by
+        // reference counting, so every stack reachable from the instruction
+        // types is found first, and then freed regardless of its count.
+        struct List stacks = find_reachable_stacks(itype_list);
+
+        for (size_t i = 0; i < stacks.length; ++i) {
+                free_stack(*(struct Stack **) get_list_elem(&stacks, i));
+        }
+
+        destroy_list(&stacks);
+        destroy_list(&itype_list->itypes);
+        destroy_str_table(&itype_list->names);
+}
+
+void remove_itypes(struct ITypeList * itype_list, const bool * is_kept)
+{
+        size_t itype_count = itype_list->itypes.length;
+        instr_id_t * new_ids = ALLOC(instr_id_t, itype_count);
+
+        struct List itypes = create_list(sizeof(struct IType), NULL);
+        struct StrTable names = create_str_table();
+
+        for (size_t id = 0; id < itype_count; ++id) {
+                struct IType itype = *id_to_itype(itype_list, id);
+                if (!is_kept[id]) {
+                        ASSERT(!itype.value, "Cannot remove \"%s\", which has a value.",
+                               itype.name);
+                        new_ids[id] = -1;
+                        continue;
+                }
+
+                str_id_t new_id = intern_str(&names, itype.name, strlen(itype.name));
+                new_ids[id] = (instr_id_t) new_id;
+                itype.name = str_table_get(&names, new_id);
+                list_append(&itypes, &itype);
+        }
+
+        struct List stacks = find_reachable_stacks(itype_list);
+
+        for (size_t i = 0; i < stacks.length; ++i) {
+                struct Stack * stack = *(struct Stack **) get_list_elem(&stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_INSTR && !is_builtin(elem->instr)) {
+                                ASSERT(new_ids[elem->instr] >= 0,
+                                       "Cannot remove \"%s\", which is in a stack.",
+                                       id_to_itype_const(itype_list, elem->instr)->name);
+                                elem->instr = new_ids[elem->instr];
+                        }
+                }
+        }
+
+        destroy_list(&stacks);
+        FREE(new_ids);
+
+        destroy_list(&itype_list->itypes);
+        destroy_str_table(&itype_list->names);
+        itype_list->itypes = itypes;
+        itype_list->names = names;
+}
+
+bool itype_in_list(const struct ITypeList * itype_list, const char * instr_name)
+{
+        // The name might be interned without having an instruction type yet.
+        str_id_t id;
+        if (!str_table_find(&itype_list->names, instr_name, strlen(instr_name), &id)) {
+                return false;
+        }
+        return id < itype_list->itypes.length;
+}
+
+void add_itype_to_list(struct ITypeList * itype_list, const char * instr_name)
+{
+        ASSERT(!itype_in_list(itype_list, instr_name),
+               "Instruction %s already in instruction " LIST_FS ".",
+               instr_name, LIST_FA(itype_list->itypes));
+
+        ASSERT(str_table_length(&itype_list->names) == itype_list->itypes.length,
+               "Cannot add \"%s\" while other names lack instruction types.", instr_name);
+
+        intern_str(&itype_list->names, instr_name, strlen(instr_name));
+        add_interned_itypes(itype_list);
+}
+
+instr_id_t find_instr_id(const struct ITypeList * itype_list, const char * instr_name)
+{
+        ASSERT(itype_in_list(itype_list, instr_name),
+               "Could not find instruction %s in instruction " LIST_FS ".",
+               instr_name, LIST_FA(itype_list->itypes));
+
+        str_id_t id;
+        if (str_table_find(&itype_list->names, instr_name, strlen(instr_name), &id)) {
+                return (instr_id_t) id;
+        }
+
+        return -1;
+}
+
+struct IType * id_to_itype(struct ITypeList * itype_list, instr_id_t id)
+{
+        return get_list_elem(&itype_list->itypes, id);
+}
+
+const struct IType * id_to_itype_const(const struct ITypeList * itype_list, instr_id_t id)
+{
+        return get_list_elem_const(&itype_list->itypes, id);
+}
+
+struct IType * instr_name_to_itype(struct ITypeList * itype_list, const char * instr_name)
+{
+        instr_id_t id = find_instr_id(itype_list, instr_name);
+        return id_to_itype(itype_list, id);
+}
+
+static bool must_be_logged(const char * itype_name)
+{
+        if (strcmp(itype_name, g_instr_stack_str) == 0) {
+                return true;
+        }
+        if (strcmp(itype_name, g_data_stack_str) == 0) {
+                return true;
+        }
+        return false;
+}
+
+bool is_itype_logged(const char * itype_name)
+{
+        return is_itype_loggable(itype_name) || must_be_logged(itype_name);
+}
+
+void log_itype_list(int log_level, const struct ITypeList * itype_list)
+{
+        if (!LOGGABLE(log_level)) {
+                return;
+        }
+
+        bool first_logging = true;
+        for (size_t i = 0; i < itype_list->itypes.length; ++i) {
+
+                const struct IType * curr_itype = id_to_itype_const(itype_list, i);
+
+                if (!is_itype_logged(curr_itype->name)) {
+                        continue;
+                }
+
+                if (first_logging) {
+                        first_logging = false;
+                } else {
+                        LOG(log_level, "\n");
+                }
+
+                LOG(log_level, "%s: ", curr_itype->name);
+
+                if (curr_itype->value) {
+                        log_stack_backwards(log_level, curr_itype->value, itype_list);
+                } else {
+                        LOG(log_level, "[uninitialized]");
+                }
+        }
+}
+
+bool is_builtin(instr_id_t id)
+{
+        return id < 0;
+}
+
+instr_id_t builtin_to_id(enum Builtin builtin)
+{
+        return -builtin - 1;
+}
+
+enum Builtin id_to_builtin(instr_id_t id)
+{
+        return -id - 1;
+}
+
+enum Builtin get_called_builtin(const struct ITypeList * itype_list,
+                                const struct StackElem * elem)
+{
+        if (elem->type != STACK_ELEM_INSTR || elem->indirection_level > 0) {
+                return BUILTINS_COUNT;
+        }
+
+        if (is_builtin(elem->instr)) {
+                return id_to_builtin(elem->instr);
+        }
+
+        return id_to_itype_const(itype_list, elem->instr)->constant_builtin;
+}
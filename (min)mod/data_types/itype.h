@@ -1,60 +1,110 @@
-#ifndef INSTR_TYPE_H
-#define INSTR_TYPE_H
-
-#include <stdbool.h>
-#include "../tools/list.h"
-
-typedef int instr_id_t;
-
-enum Builtin {
-        BUILTIN_SET,
-        BUILTIN_UNWRAP,
-        BUILTIN_IF,
-        BUILTINS_COUNT
-};
-
-struct IType {
-        char * name;
-        struct Stack * value;
-};
-
-// No "create_itype" function since they're only supposed to be created
-// by adding them to a list using "add_itype_to_list".
-
-void destroy_itype(struct IType * itype);
-
-void destroy_itype_void_ptr(void * itype);
-
-// Returns "true" if and only if "itype_list" contains a "struct IType" named
-// "instr_name".
-bool itype_in_list(const struct List * itype_list, const char * instr_name);
-
-// Adds a new "struct IType" to "itype_list", named "instr_name".
-// "itype_list" cannot already contain an instruction type with that name.
-void add_itype_to_list(struct List * itype_list, const char * instr_name);
-
-// Return the ID of the "struct IType" in "itype_list" named "instr_name".
-// Can only be called if such "struct IType" exists.
-instr_id_t find_instr_id(const struct List * itype_list, const char * instr_name);
-
-// Returns the name of the instruction type with ID "id" in "itype_list".
-// Can only be called if the ID is valid within the list.
-struct IType * id_to_itype(struct List * itype_list, instr_id_t id);
-
-// Same as "id_to_itype", but the argument can be constant at the cost of
-// a constant return value.
-const struct IType * id_to_itype_const(const struct List * itype_list, instr_id_t id);
-
-// Returns the instruction type named "instr_name" in "itype_list".
-// Only legal if such instruction type exists.
-struct IType * instr_name_to_itype(struct List * itype_list, const char * instr_name);
-
-void log_itype_list(int log_level, const struct List * list);
-
-bool is_builtin(instr_id_t id);
-
-instr_id_t builtin_to_id(enum Builtin builtin);
-
-enum Builtin id_to_builtin(instr_id_t id);
-
-#endif
+#ifndef INSTR_TYPE_H
+#define INSTR_TYPE_H
+
+#include <stdbool.h>
+#include "../tools/list.h"
+#include "../tools/str_table.h"
+
+typedef int instr_id_t;
+
+struct StackElem;
+
+enum Builtin {
+        BUILTIN_SET,
+        BUILTIN_UNWRAP,
+        BUILTIN_IF,
+        BUILTINS_COUNT
+};
+
+struct IType {
+        // Owned by the names of the "struct ITypeList" containing the
+        // instruction type.
+        const char * name;
+        struct Stack * value;
+
+        // The built-in that is all the value will ever be, so that calling
+        // the instruction type can run it right away, or "BUILTINS_COUNT"
+        // if the value may be anything else. Found by "optimize".
+        enum Builtin constant_builtin;
+};
+
+struct ITypeList {
+        // The "struct IType"s themselves, indexed by "instr_id_t". Instruction
+        // types are only removed by "remove_itypes", before the program runs,
+        // so IDs stay the same while it runs.
+        struct List itypes;
+
+        // The name of each instruction type, interned with the same ID as
+        // the instruction type itself. Names can be interned before their
+        // instruction types exist (the lexer does so), which is how tokens
+        // get their instruction IDs without any string comparisons.
+        struct StrTable names;
+};
+
+// No "create_itype" or "destroy_itype" functions since they're only
+// supposed to be created by adding them to a list using
+// "add_itype_to_list", and destroyed along with the list.
+
+// Creates a list with the instruction types for the instruction stack and
+// the data stack, as they're used implicitly by the built-in instructions.
+struct ITypeList create_itype_list(void);
+
+// Destroys "itype_list" along with every stack of the program in it.
+void destroy_itype_list(struct ITypeList * itype_list);
+
+// Returns every stack reachable from the instruction types of "itype_list"
+// as a list of "struct Stack *"s, with no stack listed twice.
+struct List find_reachable_stacks(const struct ITypeList * itype_list);
+
+// Adds instruction types for the names interned in "itype_list->names"
+// that don't have one yet, with IDs equal to the IDs of their names.
+void add_interned_itypes(struct ITypeList * itype_list);
+
+// Removes the instruction types of "itype_list" whose IDs aren't
+// "is_kept", which can't have a value or be in any stack of the program.
+// The rest get new IDs, in the same order, and the stacks are changed to
+// match.
+void remove_itypes(struct ITypeList * itype_list, const bool * is_kept);
+
+// Returns "true" if and only if "itype_list" contains a "struct IType" named
+// "instr_name".
+bool itype_in_list(const struct ITypeList * itype_list, const char * instr_name);
+
+// Adds a new "struct IType" to "itype_list", named "instr_name".
+// "itype_list" cannot already contain an instruction type with that name.
+void add_itype_to_list(struct ITypeList * itype_list, const char * instr_name);
+
+// Return the ID of the "struct IType" in "itype_list" named "instr_name".
+// Can only be called if such "struct IType" exists.
+instr_id_t find_instr_id(const struct ITypeList * itype_list, const char * instr_name);
+
+// Returns the name of the instruction type with ID "id" in "itype_list".
+// Can only be called if the ID is valid within the list.
+struct IType * id_to_itype(struct ITypeList * itype_list, instr_id_t id);
+
+// Same as "id_to_itype", but the argument can be constant at the cost of
+// a constant return value.
+const struct IType * id_to_itype_const(const struct ITypeList * itype_list, instr_id_t id);
+
+// Returns the instruction type named "instr_name" in "itype_list".
+// Only legal if such instruction type exists.
+struct IType * instr_name_to_itype(struct ITypeList * itype_list, const char * instr_name);
+
+// Whether "log_itype_list" logs the instruction type named "itype_name".
+bool is_itype_logged(const char * itype_name);
+
+void log_itype_list(int log_level, const struct ITypeList * itype_list);
+
+bool is_builtin(instr_id_t id);
+
+instr_id_t builtin_to_id(enum Builtin builtin);
+
+enum Builtin id_to_builtin(instr_id_t id);
+
+// Returns the built-in "elem" runs right away, when it's the built-in itself
+// or an instruction type that's always the built-in, or "BUILTINS_COUNT" if
+// it doesn't run one, being pushed or not an instruction.
+enum Builtin get_called_builtin(const struct ITypeList * itype_list,
+                                const struct StackElem * elem);
+
+#endif
@@ -1,254 +1,385 @@
-#include "stack.h"
-#include "../tools/mem_tools.h"
-#include "../settings.h"
-
-#define MIN_STACK_CAPACITY 2
-#define STACK_CAPACITY_MULTIPLIER 1.5
-
-struct Stack * create_stack(void)
-{
-        struct Stack * stack = ALLOC(struct Stack, 1);
-        stack->capacity = MIN_STACK_CAPACITY;
-        stack->contents = ALLOC(struct StackElem, stack->capacity);
-        stack->size = 0;
-        stack->reference_count = 1;
-
-        return stack;
-}
-
-struct Stack * create_invalid_stack(void)
-{
-        // As per the time of writing this comment, "is_stack_valid" simply
-        // checks if the capacity is too little for the size or for
-        // "MIN_STACK_CAPACITY". Yet, all the variables are initialized
-        // with values as bad as possible to make sure that even if
-        // "is_stack_valid" for some magical reason changes, it'll still
-        // return "false" for stacks created by this function.
-        struct Stack * stack = ALLOC(struct Stack, 1);
-        stack->capacity = 0;
-        stack->contents = NULL;
-        stack->size = 1;
-        stack->reference_count = -1;
-
-        return stack;
-}
-
-// Do not change this function without making sure it will still return
-// "false" for values created using "create_invalid_stack".
-bool is_stack_valid(const struct Stack * stack)
-{
-        return stack->capacity >= stack->size && stack->capacity >= MIN_STACK_CAPACITY;
-}
-
-void add_stack_reference(struct Stack * stack)
-{
-        ++stack->reference_count;
-}
-
-void remove_stack_reference(struct Stack * stack)
-{
-        --stack->reference_count;
-        if (stack->reference_count == 0) {
-                destroy_stack(stack);
-        }
-}
-
-static void destroy_stack_elem(struct StackElem * elem)
-{
-        if (elem->type == STACK_ELEM_SUBSTACK) {
-                remove_stack_reference(elem->substack);
-        } else if (elem->type == STACK_ELEM_STACK_REF) {
-                remove_stack_reference(elem->stack_ref);
-        }
-}
-
-void destroy_stack(struct Stack * stack)
-{
-        for (size_t i = 0; i < stack->size; ++i) {
-                destroy_stack_elem(&stack->contents[i]);
-        }
-
-        FREE(stack->contents);
-        FREE(stack);
-}
-
-void destroy_stack_void_ptr(void * stack)
-{
-        destroy_stack(stack);
-}
-
-static void resize_stack(struct Stack * stack, size_t new_size)
-{
-        while (new_size > stack->capacity) {
-                stack->capacity *= STACK_CAPACITY_MULTIPLIER;
-        }
-        REALLOC(&stack->contents, struct StackElem, stack->capacity);
-
-        stack->size = new_size;
-}
-
-void stack_push(struct Stack * stack, const struct StackElem * stack_elem)
-{
-        resize_stack(stack, stack->size + 1);
-        stack->contents[stack->size - 1] = *stack_elem;
-
-        if (stack_elem->type == STACK_ELEM_SUBSTACK) {
-                add_stack_reference(stack_elem->substack);
-        } else if (stack_elem->type == STACK_ELEM_STACK_REF) {
-                add_stack_reference(stack_elem->stack_ref);
-        }
-}
-
-void stack_pop(struct Stack * stack)
-{
-        destroy_stack_elem(&stack->contents[stack->size - 1]);
-        resize_stack(stack, stack->size - 1);
-}
-
-struct StackElem * stack_peek(struct Stack * stack, int idx)
-{
-        return &stack->contents[stack->size - idx - 1];
-}
-
-struct Stack * deepcopy_stack(const struct Stack * stack)
-{
-        struct Stack * clone = ALLOC(struct Stack, 1);
-        clone->reference_count = 1;
-        clone->capacity = stack->capacity;
-        clone->size = stack->size;
-
-        clone->contents = ALLOC(struct StackElem, clone->capacity);
-        COPY_MEMORY(clone->contents, stack->contents, struct StackElem, clone->capacity);
-
-        // Clone all the sub-stacks.
-        for (size_t i = 0; i < clone->size; ++i) {
-                struct StackElem * clone_elem = &clone->contents[i];
-                const struct StackElem * original_elem = &stack->contents[i];
-
-                if (clone_elem->type == STACK_ELEM_SUBSTACK) {
-                        clone_elem->substack = deepcopy_stack(original_elem->substack);
-                }
-        }
-
-        return clone;
-}
-
-void reverse_stack(struct Stack * stack)
-{
-        int lower_idx = 0;
-        int upper_idx = stack->size - 1;
-
-        while (lower_idx < upper_idx) {
-
-                struct StackElem temp = stack->contents[lower_idx];
-                stack->contents[lower_idx] = stack->contents[upper_idx];
-                stack->contents[upper_idx] = temp;
-
-                ++lower_idx;
-                --upper_idx;
-        }
-}
-
-struct StackElem instr_to_stack_elem(instr_id_t instr, int indirection_level)
-{
-        struct StackElem stack_elem;
-        stack_elem.type = STACK_ELEM_INSTR;
-        stack_elem.instr = instr;
-        stack_elem.indirection_level = indirection_level;
-
-        return stack_elem;
-}
-
-struct StackElem create_stack_ref(struct Stack * stack, int indirection_level)
-{
-        struct StackElem stack_elem;
-        stack_elem.type = STACK_ELEM_STACK_REF;
-        stack_elem.indirection_level = indirection_level;
-
-        stack_elem.stack_ref = stack;
-
-        add_stack_reference(stack);
-
-        return stack_elem;
-}
-
-struct StackElem create_substack(struct Stack * substack, int indirection_level)
-{
-        struct StackElem stack_elem;
-        stack_elem.type = STACK_ELEM_SUBSTACK;
-        stack_elem.indirection_level = indirection_level;
-
-        stack_elem.substack = substack;
-
-        add_stack_reference(substack);
-
-        return stack_elem;
-}
-
-struct StackElem create_invalid_stack_elem(void)
-{
-        struct StackElem stack_elem;
-        stack_elem.type = STACK_ELEM_INVALID;
-        return stack_elem;
-}
-
-bool is_stack_elem_valid(const struct StackElem * stack_elem)
-{
-        return stack_elem->type != STACK_ELEM_INVALID;
-}
-
-static void log_n_times(int log_level, char ch, int count)
-{
-        for (int i = 0; i < count; ++i) {
-                LOG(log_level, "%c", ch);
-        }
-}
-
-static void log_stack_elem(int log_level,
-                           const struct StackElem * stack_elem,
-                           const struct List * itype_list)
-{
-        switch (stack_elem->type) {
-        case STACK_ELEM_INSTR: {
-                if (is_builtin(stack_elem->instr)) {
-                        enum Builtin builtin = id_to_builtin(stack_elem->instr);
-                        LOG(log_level, "[%s]", g_builtin_names[builtin]);
-                } else {
-                        const struct IType * itype;
-                        itype = id_to_itype_const(itype_list, stack_elem->instr);
-
-                        LOG(log_level, "%s", itype->name);
-                }
-                break;
-        case STACK_ELEM_STACK_REF:
-                LOG(log_level, "[stack reference]");
-                break;
-        case STACK_ELEM_SUBSTACK:
-                log_stack_backwards(log_level, stack_elem->substack, itype_list);
-                break;
-        default:
-                LOG(log_level, "[invalid stack element]");
-        }
-        }
-
-        log_n_times(log_level, g_indirection_ch, stack_elem->indirection_level);
-}
-
-void log_stack_backwards(int log_level, const struct Stack * stack, const struct List * itype_list)
-{
-        if (!LOGGABLE(log_level)) {
-                return;
-        }
-
-        LOG(log_level, "%c", g_stack_open_ch);
-        for (int i = stack->size - 1; i >= 0; --i) {
-
-                const struct StackElem * curr_elem = &stack->contents[i];
-                log_stack_elem(log_level, curr_elem, itype_list);
-
-                if (i != 0) {
-                        LOG(log_level, " ");
-                }
-        }
-        LOG(log_level, "%c", g_stack_close_ch);
-}
+#include "stack.h"
+#include "../tools/mem_tools.h"
+#include "../settings.h"
+
+#define MIN_STACK_CAPACITY 2
+#define STACK_CAPACITY_MULTIPLIER 1.5
+
+// Where the memory of the stacks of this thread is counted, if anywhere.
+static _Thread_local struct StackMemory * s_memory = NULL;
+
+struct StackMemory create_stack_memory(size_t quota)
+{
+        struct StackMemory memory;
+        memory.in_use = 0;
+        memory.peak = 0;
+        memory.quota = quota;
+        memory.grow_count = 0;
+
+        return memory;
+}
+
+void set_thread_stack_memory(struct StackMemory * memory)
+{
+        s_memory = memory;
+}
+
+struct StackMemory * get_thread_stack_memory(void)
+{
+        return s_memory;
+}
+
+static size_t get_stack_bytes(size_t capacity)
+{
+        return sizeof(struct Stack) + sizeof(struct StackElem) * capacity;
+}
+
+// Returns "false" if "byte_count" more bytes would go beyond the quota.
+static bool fits_in_quota(size_t byte_count)
+{
+        if (!s_memory || s_memory->quota == 0) {
+                return true;
+        }
+
+        // Stacks that can't fail to be created may have gone beyond it.
+        return s_memory->in_use <= s_memory->quota &&
+               byte_count <= s_memory->quota - s_memory->in_use;
+}
+
+static void take_memory(size_t byte_count)
+{
+        if (s_memory) {
+                s_memory->in_use += byte_count;
+                if (s_memory->in_use > s_memory->peak) {
+                        s_memory->peak = s_memory->in_use;
+                }
+        }
+}
+
+static void give_back_memory(size_t byte_count)
+{
+        if (s_memory) {
+                s_memory->in_use -= byte_count;
+        }
+}
+
+struct Stack * create_stack(void)
+{
+        return create_stack_with_capacity(MIN_STACK_CAPACITY);
+}
+
+struct Stack * create_stack_with_capacity(size_t capacity)
+{
+        struct Stack * stack = ALLOC(struct Stack, 1);
+        stack->capacity = capacity > MIN_STACK_CAPACITY ? capacity : MIN_STACK_CAPACITY;
+        stack->contents = ALLOC(struct StackElem, stack->capacity);
+        stack->size = 0;
+        stack->reference_count = 1;
+
+        take_memory(get_stack_bytes(stack->capacity));
+
+        return stack;
+}
+
+struct Stack * create_invalid_stack(void)
+{
+        // As per the time of writing this comment, "is_stack_valid" simply
+        // checks if the capacity is too little for the size or for
+        // "MIN_STACK_CAPACITY". Yet, all the variables are initialized
+        // with values as bad as possible to make sure that even if
+        // "is_stack_valid" for some magical reason changes, it'll still
+        // return "false" for stacks created by this function.
+        struct Stack * stack = ALLOC(struct Stack, 1);
+        stack->capacity = 0;
+        stack->contents = NULL;
+        stack->size = 1;
+        stack->reference_count = -1;
+
+        take_memory(get_stack_bytes(0));
+
+        return stack;
+}
+
+// Do not change this function without making sure it will still return
+// "false" for values created using "create_invalid_stack".
+bool is_stack_valid(const struct Stack * stack)
+{
+        return stack->capacity >= stack->size && stack->capacity >= MIN_STACK_CAPACITY;
+}
+
+void add_stack_reference(struct Stack * stack)
+{
+        ++stack->reference_count;
+}
+
+void remove_stack_reference(struct Stack * stack)
+{
+        --stack->reference_count;
+        if (stack->reference_count == 0) {
+                destroy_stack(stack);
+        }
+}
+
+void destroy_stack_elem(struct StackElem * stack_elem)
+{
+        if (stack_elem->type == STACK_ELEM_SUBSTACK) {
+                remove_stack_reference(stack_elem->substack);
+        } else if (stack_elem->type == STACK_ELEM_STACK_REF) {
+                remove_stack_reference(stack_elem->stack_ref);
+        }
+}
+
+void destroy_stack(struct Stack * stack)
+{
+        for (size_t i = 0; i < stack->size; ++i) {
+                destroy_stack_elem(&stack->contents[i]);
+        }
+
+        free_stack(stack);
+}
+
+void free_stack(struct Stack * stack)
+{
+        give_back_memory(get_stack_bytes(stack->capacity));
+
+        FREE(stack->contents);
+        FREE(stack);
+}
+
+void destroy_stack_void_ptr(void * stack)
+{
+        destroy_stack(stack);
+}
+
+// Returns "false", leaving "stack" as it was, if growing it to
+// "new_capacity" would go beyond the quota.
+static bool grow_stack(struct Stack * stack, size_t new_capacity)
+{
+        size_t byte_count = sizeof(struct StackElem) * (new_capacity - stack->capacity);
+        if (!fits_in_quota(byte_count)) {
+                return false;
+        }
+        take_memory(byte_count);
+
+        stack->capacity = new_capacity;
+        REALLOC(&stack->contents, struct StackElem, stack->capacity);
+
+        return true;
+}
+
+// Stacks never shrink, so only growing can fail, if it would go beyond the
+// quota. Returns "false" then, leaving "stack" as it was.
+static bool resize_stack(struct Stack * stack, size_t new_size)
+{
+        if (new_size > stack->capacity) {
+                size_t new_capacity = stack->capacity;
+                while (new_size > new_capacity) {
+                        new_capacity *= STACK_CAPACITY_MULTIPLIER;
+                }
+
+                if (!grow_stack(stack, new_capacity)) {
+                        return false;
+                }
+
+                if (s_memory) {
+                        ++s_memory->grow_count;
+                }
+        }
+
+        stack->size = new_size;
+        return true;
+}
+
+bool reserve_stack(struct Stack * stack, size_t capacity)
+{
+        return capacity <= stack->capacity || grow_stack(stack, capacity);
+}
+
+bool stack_push(struct Stack * stack, const struct StackElem * stack_elem)
+{
+        if (!resize_stack(stack, stack->size + 1)) {
+                return false;
+        }
+
+        stack->contents[stack->size - 1] = *stack_elem;
+        return true;
+}
+
+void stack_pop(struct Stack * stack)
+{
+        destroy_stack_elem(&stack->contents[stack->size - 1]);
+        (void) resize_stack(stack, stack->size - 1);
+}
+
+struct StackElem * stack_peek(struct Stack * stack, int idx)
+{
+        return &stack->contents[stack->size - idx - 1];
+}
+
+struct Stack * deepcopy_stack(const struct Stack * stack)
+{
+        size_t byte_count = get_stack_bytes(stack->capacity);
+        if (!fits_in_quota(byte_count)) {
+                return NULL;
+        }
+        take_memory(byte_count);
+
+        struct Stack * clone = ALLOC(struct Stack, 1);
+        clone->reference_count = 1;
+        clone->capacity = stack->capacity;
+        clone->size = stack->size;
+
+        clone->contents = ALLOC(struct StackElem, clone->capacity);
+        COPY_MEMORY(clone->contents, stack->contents, struct StackElem, clone->capacity);
+
+        // Clone all the sub-stacks.
+        for (size_t i = 0; i < clone->size; ++i) {
+                struct StackElem * clone_elem = &clone->contents[i];
+                const struct StackElem * original_elem = &stack->contents[i];
+
+                if (clone_elem->type == STACK_ELEM_SUBSTACK) {
+                        clone_elem->substack = deepcopy_stack(original_elem->substack);
+
+                        // The elements from "i" on hold no references yet.
+                        if (!clone_elem->substack) {
+                                clone->size = i;
+                                destroy_stack(clone);
+                                return NULL;
+                        }
+                } else if (clone_elem->type == STACK_ELEM_STACK_REF) {
+                        add_stack_reference(clone_elem->stack_ref);
+                }
+        }
+
+        return clone;
+}
+
+void reverse_stack(struct Stack * stack)
+{
+        int lower_idx = 0;
+        int upper_idx = stack->size - 1;
+
+        while (lower_idx < upper_idx) {
+
+                struct StackElem temp = stack->contents[lower_idx];
+                stack->contents[lower_idx] = stack->contents[upper_idx];
+                stack->contents[upper_idx] = temp;
+
+                ++lower_idx;
+                --upper_idx;
+        }
+}
+
+struct StackElem instr_to_stack_elem(instr_id_t instr, int indirection_level)
+{
+        struct StackElem stack_elem;
+        stack_elem.type = STACK_ELEM_INSTR;
+        stack_elem.instr = instr;
+        stack_elem.indirection_level = indirection_level;
+        stack_elem.is_verified = false;
+
+        return stack_elem;
+}
+
+struct StackElem create_stack_ref(struct Stack * stack, int indirection_level)
+{
+        struct StackElem stack_elem;
+        stack_elem.type = STACK_ELEM_STACK_REF;
+        stack_elem.indirection_level = indirection_level;
+        stack_elem.is_verified = false;
+
+        stack_elem.stack_ref = stack;
+
+        return stack_elem;
+}
+
+struct StackElem create_substack(struct Stack * substack, int indirection_level)
+{
+        struct StackElem stack_elem;
+        stack_elem.type = STACK_ELEM_SUBSTACK;
+        stack_elem.indirection_level = indirection_level;
+        stack_elem.is_verified = false;
+
+        stack_elem.substack = substack;
+
+        return stack_elem;
+}
+
+struct StackElem copy_stack_elem(const struct StackElem * stack_elem)
+{
+        if (stack_elem->type == STACK_ELEM_SUBSTACK) {
+                add_stack_reference(stack_elem->substack);
+        } else if (stack_elem->type == STACK_ELEM_STACK_REF) {
+                add_stack_reference(stack_elem->stack_ref);
+        }
+
+        return *stack_elem;
+}
+
+struct StackElem create_invalid_stack_elem(void)
+{
+        struct StackElem stack_elem;
+        stack_elem.type = STACK_ELEM_INVALID;
+        return stack_elem;
+}
+
+bool is_stack_elem_valid(const struct StackElem * stack_elem)
+{
+        return stack_elem->type != STACK_ELEM_INVALID;
+}
+
+static void log_n_times(int log_level, char ch, int count)
+{
+        for (int i = 0; i < count; ++i) {
+                LOG(log_level, "%c", ch);
+        }
+}
+
+static void log_stack_elem(int log_level,
+                           const struct StackElem * stack_elem,
+                           const struct ITypeList * itype_list)
+{
+        switch (stack_elem->type) {
+        case STACK_ELEM_INSTR: {
+                if (is_builtin(stack_elem->instr)) {
+                        enum Builtin builtin = id_to_builtin(stack_elem->instr);
+                        LOG(log_level, "[%s]", g_builtin_names[builtin]);
+                } else {
+                        const struct IType * itype;
+                        itype = id_to_itype_const(itype_list, stack_elem->instr);
+
+                        LOG(log_level, "%s", itype->name);
+                }
+                break;
+        case STACK_ELEM_STACK_REF:
+                LOG(log_level, "[stack reference]");
+                break;
+        case STACK_ELEM_SUBSTACK:
+                log_stack_backwards(log_level, stack_elem->substack, itype_list);
+                break;
+        default:
+                LOG(log_level, "[invalid stack element]");
+        }
+        }
+
+        log_n_times(log_level, g_indirection_ch, stack_elem->indirection_level);
+}
+
+void log_stack_backwards(int log_level, const struct Stack * stack, const struct ITypeList * itype_list)
+{
+        if (!LOGGABLE(log_level)) {
+                return;
+        }
+
+        LOG(log_level, "%c", g_stack_open_ch);
+        for (int i = stack->size - 1; i >= 0; --i) {
+
+                const struct StackElem * curr_elem = &stack->contents[i];
+                log_stack_elem(log_level, curr_elem, itype_list);
+
+                if (i != 0) {
+                        LOG(log_level, " ");
+                }
+        }
+        LOG(log_level, "%c", g_stack_close_ch);
+}
@@ -1,100 +1,159 @@
-// "There should be no more than one class per file, and max 7 functions."
-// - someone smart
-
-#ifndef STACK_H
-#define STACK_H
-
-#include <stdlib.h>
-#include <stdbool.h>
-#include "itype.h"
-
-enum StackElemType {
-        STACK_ELEM_INVALID,
-        STACK_ELEM_INSTR,
-        STACK_ELEM_STACK_REF,
-
-        // Napping in a sack
-        // Rapping tacky tracks
-        // Spitting bars, spitting facts
-        // But sud'nly happ'ning happs:
-        // The minmod program lacks
-        // Stack-elem-sub-stacks
-        // So using complex hacks
-        // I smartly add them back
-        STACK_ELEM_SUBSTACK
-};
-
-struct StackElem {
-        enum StackElemType type;
-        union {
-                instr_id_t instr;
-
-                struct Stack * stack_ref;
-
-                // While variable stacks are passed by reference, literal stacks
-                // are always copied by value.
-                // It's still a pointer, though, to save some space.
-                struct Stack * substack;
-        };
-        int indirection_level;
-};
-
-struct Stack {
-        struct StackElem * contents;
-        size_t capacity;
-        size_t size;
-        int reference_count;
-};
-
-// Create a new stack without any elements.
-// Assumes one variable or stack is referencing the stack at creation.
-struct Stack * create_stack(void);
-
-// Create an invalid and unusable stack.
-struct Stack * create_invalid_stack(void);
-
-// Returns "true" if "stack" was created using "create_stack" rather than
-// "create_invalid_stack".
-bool is_stack_valid(const struct Stack * stack);
-
-
-void add_stack_reference(struct Stack * stack);
-
-void remove_stack_reference(struct Stack * stack);
-
-void destroy_stack(struct Stack * stack);
-
-void destroy_stack_void_ptr(void * stack);
-
-void stack_push(struct Stack * stack, const struct StackElem * stack_elem);
-
-void stack_pop(struct Stack * stack);
-
-struct StackElem * stack_peek(struct Stack * stack, int idx);
-
-// Creates a duplicate of "stack", including deeply copying the sub-stacks.
-// It's completely independent, in other words. Like the U. S.
-struct Stack * deepcopy_stack(const struct Stack * stack);
-
-// Reverses the contents of "stack". Sub-stacks won't be reversed.
-void reverse_stack(struct Stack * stack);
-
-// The three routines below create stack elements from different types of
-// data, ready to be sealed and shipped (id est, added to a stack).
-
-struct StackElem instr_to_stack_elem(instr_id_t instr, int indirection_level);
-
-struct StackElem create_stack_ref(struct Stack * stack, int indirection_level);
-
-struct StackElem create_substack(struct Stack * substack, int indirection_level);
-
-struct StackElem create_invalid_stack_elem(void);
-
-// Returns "true" if "stack_elem" wasn't created by "create_invalid_stack_elem".
-bool is_stack_elem_valid(const struct StackElem * stack_elem);
-
-// Logging stacks backwards is quite useful since instruction
-// stacks are reversed before execution
-void log_stack_backwards(int log_level, const struct Stack * stack, const struct List * itype_list);
-
-#endif
+// "There should be no more than one class per file, and max 7 functions."
+// - someone smart
+
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "itype.h"
+
+enum StackElemType {
+        STACK_ELEM_INVALID,
+        STACK_ELEM_INSTR,
+        STACK_ELEM_STACK_REF,
+
+        // Napping in a sack
+        // Rapping tacky tracks
+        // Spitting bars, spitting facts
+        // But sud'nly happ'ning happs:
+        // The minmod program lacks
+        // Stack-elem-sub-stacks
+        // So using complex hacks
+        // I smartly add them back
+        STACK_ELEM_SUBSTACK
+};
+
+struct StackElem {
+        enum StackElemType type;
+        union {
+                instr_id_t instr;
+
+                struct Stack * stack_ref;
+
+                // While variable stacks are passed by reference, literal stacks
+                // are always copied by value.
+                // It's still a pointer, though, to save some space.
+                struct Stack * substack;
+        };
+        int indirection_level;
+
+        // Whether the element is a call of a built-in proved to pass the
+        // checks the built-in makes of its arguments, so that they can be
+        // skipped. Set by "verify", and kept as elements are copied.
+        bool is_verified;
+};
+
+struct Stack {
+        struct StackElem * contents;
+        size_t capacity;
+        size_t size;
+        int reference_count;
+};
+
+// The memory taken by the stacks of a program, in bytes, counting the
+// elements stacks have room for rather than the ones they have.
+struct StackMemory {
+        size_t in_use;
+        size_t peak;
+
+        // The most the stacks may take, or 0 if there's no limit. Pushing
+        // and copying fail rather than go beyond it, while stacks created
+        // any other way are counted even if they go beyond it.
+        size_t quota;
+
+        // How many times stacks have grown as elements were pushed onto
+        // them, each time moving their elements.
+        size_t grow_count;
+};
+
+struct StackMemory create_stack_memory(size_t quota);
+
+// Counts the memory of every stack the calling thread creates, grows or
+// frees towards "memory", until it's called again. "NULL" stops counting.
+// Stacks must be freed by the thread counting the program they belong to,
+// or by one that doesn't count at all.
+void set_thread_stack_memory(struct StackMemory * memory);
+
+struct StackMemory * get_thread_stack_memory(void);
+
+// Create a new stack without any elements.
+// Assumes one variable or stack is referencing the stack at creation.
+struct Stack * create_stack(void);
+
+// Like "create_stack", but with room for "capacity" elements before the
+// stack has to grow.
+struct Stack * create_stack_with_capacity(size_t capacity);
+
+// Create an invalid and unusable stack.
+struct Stack * create_invalid_stack(void);
+
+// Returns "true" if "stack" was created using "create_stack" rather than
+// "create_invalid_stack".
+bool is_stack_valid(const struct Stack * stack);
+
+// Every stack element and instruction type referring to a stack holds one
+// reference to it, and the stack is destroyed along with the last one.
+void add_stack_reference(struct Stack * stack);
+
+void remove_stack_reference(struct Stack * stack);
+
+void destroy_stack(struct Stack * stack);
+
+// Frees "stack" without removing the references its elements hold, for
+// when every stack of a program is freed at once.
+void free_stack(struct Stack * stack);
+
+void destroy_stack_void_ptr(void * stack);
+
+// Removes the reference "stack_elem" holds, if any.
+void destroy_stack_elem(struct StackElem * stack_elem);
+
+// Moves "stack_elem" onto "stack", along with the reference it holds, if
+// any.
+// Returns "false", leaving both as they were, if "stack" would have to grow
+// beyond the quota of the memory of the thread.
+bool stack_push(struct Stack * stack, const struct StackElem * stack_elem);
+
+void stack_pop(struct Stack * stack);
+
+// Makes room for at least "capacity" elements on "stack", so that it doesn't
+// have to grow until it has more. Returns "false", leaving "stack" as it
+// was, if that would go beyond the quota of the memory of the thread.
+bool reserve_stack(struct Stack * stack, size_t capacity);
+
+struct StackElem * stack_peek(struct Stack * stack, int idx);
+
+// Creates a duplicate of "stack", including deeply copying the sub-stacks.
+// It's completely independent, in other words. Like the U. S.
+// Stack references still refer to the same stacks, with a reference each.
+// Returns "NULL", having copied nothing, if the copy would go beyond the
+// quota of the memory of the thread.
+struct Stack * deepcopy_stack(const struct Stack * stack);
+
+// Reverses the contents of "stack". Sub-stacks won't be reversed.
+void reverse_stack(struct Stack * stack);
+
+// The three routines below create stack elements from different types of
+// data, ready to be sealed and shipped (id est, added to a stack).
+// Elements referring to a stack take over a reference the caller holds.
+
+struct StackElem instr_to_stack_elem(instr_id_t instr, int indirection_level);
+
+struct StackElem create_stack_ref(struct Stack * stack, int indirection_level);
+
+struct StackElem create_substack(struct Stack * substack, int indirection_level);
+
+// Returns a copy of "stack_elem" holding a reference of its own.
+struct StackElem copy_stack_elem(const struct StackElem * stack_elem);
+
+struct StackElem create_invalid_stack_elem(void);
+
+// Returns "true" if "stack_elem" wasn't created by "create_invalid_stack_elem".
+bool is_stack_elem_valid(const struct StackElem * stack_elem);
+
+// Logging stacks backwards is quite useful since instruction
+// stacks are reversed before execution
+void log_stack_backwards(int log_level, const struct Stack * stack, const struct ITypeList * itype_list);
+
+#endif
@@ -0,0 +1,364 @@
+#include "minmod.h"
+#include <string.h>
+#include "../data_types/itype.h"
+#include "../data_types/stack.h"
+#include "../preprocessing/lexing.h"
+#include "../preprocessing/optimizing.h"
+#include "../preprocessing/parsing.h"
+#include "../preprocessing/presizing.h"
+#include "../preprocessing/source.h"
+#include "../running/running.h"
+#include "../tools/list.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/platform.h"
+
+struct MinmodContext {
+        struct ITypeList itype_list;
+
+        // The files the program was loaded from. Error messages refer to
+        // their paths, so they're kept until the context is destroyed.
+        struct List sources;
+
+        bool is_loaded;
+        enum MinmodStatus status;
+        uint64_t step_count;
+
+        struct RunLimits limits;
+
+        // How long the program has run for so far.
+        uint64_t run_time_ns;
+
+        // The stacks of the program are only counted while the context is
+        // used, since contexts can move between threads. Whatever the thread
+        // counted before is counted again after.
+        struct StackMemory memory;
+
+        // How deep the stacks were estimated to get when the program was
+        // loaded. They're presized for it before its first step.
+        struct DepthEstimate estimate;
+
+        // "memory.grow_count" as it was before the first step.
+        size_t grow_count;
+
+        // The characters logged by the last call using the context,
+        // null-terminated.
+        struct List log;
+};
+
+static void append_chars(void * chars, const char * str, size_t length)
+{
+        struct List * list = chars;
+
+        // Overwrite the null terminator.
+        list_pop(list);
+        for (size_t i = 0; i < length; ++i) {
+                list_append(list, &str[i]);
+        }
+
+        char terminator = '\0';
+        list_append(list, &terminator);
+}
+
+static struct List create_chars(void)
+{
+        struct List chars = create_list(sizeof(char), NULL);
+
+        char terminator = '\0';
+        list_append(&chars, &terminator);
+
+        return chars;
+}
+
+// The sink the thread logged to before a call, set again after it, so that
+// applications can have sinks of their own.
+struct PrevSink {
+        log_sink_t sink;
+        void * arg;
+};
+
+// Makes the thread log to "chars" until "stop_logging".
+static struct PrevSink start_logging_to(struct List * chars)
+{
+        struct PrevSink prev;
+        get_thread_log_sink(&prev.sink, &prev.arg);
+        set_thread_log_sink(append_chars, chars);
+
+        return prev;
+}
+
+// Every call using a context logs to the log of the context, and the log
+// only holds what the last call logged.
+static struct PrevSink start_logging(struct MinmodContext * context)
+{
+        list_truncate(&context->log, 0);
+
+        char terminator = '\0';
+        list_append(&context->log, &terminator);
+
+        return start_logging_to(&context->log);
+}
+
+static void stop_logging(const struct PrevSink * prev)
+{
+        set_thread_log_sink(prev->sink, prev->arg);
+}
+
+static enum MinmodStatus err_state_to_status(enum ErrState err_state)
+{
+        switch (err_state) {
+        case ERR_UNFINISHED:
+                return MINMOD_RUNNING;
+        case ERR_SUCCESS:
+                return MINMOD_FINISHED;
+        case ERR_LIMIT_EXCEEDED:
+                return MINMOD_LIMIT_EXCEEDED;
+        case ERR_OUT_OF_MEMORY:
+                return MINMOD_OUT_OF_MEMORY;
+        default:
+                return MINMOD_FAILED;
+        }
+}
+
+struct MinmodContext * create_minmod_context(void)
+{
+        struct MinmodContext * context = ALLOC(struct MinmodContext, 1);
+        context->itype_list = create_itype_list();
+        context->sources = create_source_file_list();
+        context->is_loaded = false;
+        context->status = MINMOD_FAILED;
+        context->step_count = 0;
+        context->limits.max_steps = 0;
+        context->limits.time_limit_ms = 0;
+        context->run_time_ns = 0;
+        context->memory = create_stack_memory(0);
+        context->estimate.is_known = false;
+        context->estimate.data_stack_depth = 0;
+        context->estimate.instr_stack_depth = 0;
+        context->grow_count = 0;
+        context->log = create_chars();
+
+        return context;
+}
+
+void destroy_minmod_context(struct MinmodContext * context)
+{
+        struct StackMemory * thread_memory = get_thread_stack_memory();
+        set_thread_stack_memory(&context->memory);
+        destroy_itype_list(&context->itype_list);
+        set_thread_stack_memory(thread_memory);
+
+        destroy_list(&context->sources);
+        destroy_list(&context->log);
+        FREE(context);
+}
+
+// Parses the program "tokens" produce into "context".
+static bool load_tokens(struct MinmodContext * context, struct TokenIter * tokens)
+{
+        bool is_parsed = false;
+        if (is_token_iter_valid(tokens)) {
+                struct StackMemory * thread_memory = get_thread_stack_memory();
+                set_thread_stack_memory(&context->memory);
+                is_parsed = parse(tokens, &context->itype_list);
+
+                // Optimizing frees the code it leaves out.
+                if (is_parsed) {
+                        context->estimate = optimize(&context->itype_list);
+                }
+                set_thread_stack_memory(thread_memory);
+
+                destroy_token_iter(tokens);
+        }
+
+        context->status = is_parsed ? MINMOD_RUNNING : MINMOD_FAILED;
+
+        return is_parsed;
+}
+
+bool load_minmod_file(struct MinmodContext * context, const char * file_path)
+{
+        struct PrevSink prev_sink = start_logging(context);
+
+        bool is_loaded = false;
+        if (context->is_loaded) {
+                LOG_ERROR("A program is loaded already.\n");
+        } else {
+                context->is_loaded = true;
+
+                struct TokenIter tokens = lex(file_path, &context->itype_list.names,
+                                              &context->sources, NULL);
+                is_loaded = load_tokens(context, &tokens);
+        }
+
+        stop_logging(&prev_sink);
+
+        return is_loaded;
+}
+
+bool load_minmod_buffer(struct MinmodContext * context,
+                        const char * file_path,
+                        const char * contents,
+                        size_t length)
+{
+        struct PrevSink prev_sink = start_logging(context);
+
+        bool is_loaded = false;
+        if (context->is_loaded) {
+                LOG_ERROR("A program is loaded already.\n");
+        } else {
+                context->is_loaded = true;
+
+                struct TokenIter tokens = lex_buffer(file_path, contents, length,
+                                                     &context->itype_list.names,
+                                                     &context->sources);
+                is_loaded = load_tokens(context, &tokens);
+        }
+
+        stop_logging(&prev_sink);
+
+        return is_loaded;
+}
+
+void set_minmod_limits(struct MinmodContext * context, uint64_t max_steps, uint64_t time_limit_ms)
+{
+        context->limits.max_steps = max_steps;
+        context->limits.time_limit_ms = time_limit_ms;
+}
+
+void set_minmod_memory_quota(struct MinmodContext * context, size_t quota)
+{
+        context->memory.quota = quota;
+}
+
+size_t get_minmod_peak_memory(const struct MinmodContext * context)
+{
+        return context->memory.peak;
+}
+
+bool get_minmod_depth_estimate(const struct MinmodContext * context,
+                               size_t * data_stack_depth,
+                               size_t * instr_stack_depth)
+{
+        *data_stack_depth = context->estimate.data_stack_depth;
+        *instr_stack_depth = context->estimate.instr_stack_depth;
+
+        return context->estimate.is_known;
+}
+
+size_t get_minmod_grow_count(const struct MinmodContext * context)
+{
+        return context->memory.grow_count - context->grow_count;
+}
+
+enum MinmodStatus run_minmod_steps(struct MinmodContext * context, uint64_t max_steps)
+{
+        if (context->status != MINMOD_RUNNING || max_steps == 0) {
+                return context->status;
+        }
+
+        struct PrevSink prev_sink = start_logging(context);
+
+        // Runs are timed as if they were one, starting before the first.
+        uint64_t start_ns = get_monotonic_ns() - context->run_time_ns;
+
+        struct StackMemory * thread_memory = get_thread_stack_memory();
+        set_thread_stack_memory(&context->memory);
+
+        // Presized once the quota is known, which it isn't while loading.
+        if (context->step_count == 0) {
+                presize_stacks(&context->itype_list, &context->estimate);
+                context->grow_count = context->memory.grow_count;
+        }
+
+        // The limits are only checked in between runs of "run_steps".
+        enum ErrState err_state = ERR_UNFINISHED;
+        while (max_steps > 0 && err_state == ERR_UNFINISHED) {
+                uint64_t next_check = get_next_limit_check(&context->limits, context->step_count);
+                // The step limit may have been lowered below the step count.
+                uint64_t steps_to_check = next_check > context->step_count
+                                          ? next_check - context->step_count : 0;
+
+                uint64_t step_count;
+                err_state = run_steps(&context->itype_list,
+                                      steps_to_check < max_steps ? steps_to_check : max_steps,
+                                      &step_count);
+
+                context->step_count += step_count;
+                max_steps -= step_count;
+
+                if (err_state == ERR_UNFINISHED) {
+                        err_state = check_run_limits(&context->limits, context->step_count,
+                                                     start_ns);
+                }
+        }
+
+        set_thread_stack_memory(thread_memory);
+
+        context->run_time_ns = get_monotonic_ns() - start_ns;
+        context->status = err_state_to_status(err_state);
+
+        stop_logging(&prev_sink);
+
+        return context->status;
+}
+
+enum MinmodStatus get_minmod_status(const struct MinmodContext * context)
+{
+        return context->status;
+}
+
+uint64_t get_minmod_step_count(const struct MinmodContext * context)
+{
+        return context->step_count;
+}
+
+size_t get_minmod_stack_count(const struct MinmodContext * context)
+{
+        return context->itype_list.itypes.length;
+}
+
+const char * get_minmod_stack_name(const struct MinmodContext * context, size_t index)
+{
+        if (index >= context->itype_list.itypes.length) {
+                return NULL;
+        }
+
+        return id_to_itype_const(&context->itype_list, index)->name;
+}
+
+char * format_minmod_stack(const struct MinmodContext * context, const char * name)
+{
+        if (!itype_in_list(&context->itype_list, name)) {
+                return NULL;
+        }
+
+        instr_id_t id = find_instr_id(&context->itype_list, name);
+        const struct IType * itype = id_to_itype_const(&context->itype_list, id);
+        if (!itype->value) {
+                return NULL;
+        }
+
+        // Stacks are written by logging them, so the log is caught and
+        // turned into the string.
+        struct List chars = create_chars();
+        struct PrevSink prev_sink = start_logging_to(&chars);
+        log_stack_backwards(LOG_LVL_CONSOLE, itype->value, &context->itype_list);
+        stop_logging(&prev_sink);
+
+        char * str = ALLOC(char, chars.length);
+        COPY_MEMORY(str, chars.contents, char, chars.length);
+        destroy_list(&chars);
+
+        return str;
+}
+
+void free_minmod_str(char * str)
+{
+        FREE(str);
+}
+
+const char * get_minmod_log(const struct MinmodContext * context)
+{
+        return context->log.contents;
+}
@@ -0,0 +1,111 @@
+// (min)mod as a library, for running programs from within other programs
+// without starting a new process for each of them.
+// Each program runs in a context of its own, and contexts share nothing, so
+// different threads can use different contexts at the same time. A single
+// context can only be used by one thread at a time.
+// Nothing here exits or waits for input. What would otherwise be logged to
+// the console is kept in the log of the context instead. That only holds
+// for builds with "NDEBUG", though, since failed assertions exit in debug
+// builds.
+
+#ifndef MINMOD_H
+#define MINMOD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct MinmodContext;
+
+enum MinmodStatus {
+        // The program couldn't be loaded, or failed while running.
+        MINMOD_FAILED,
+
+        // The program is loaded, and can run more steps.
+        MINMOD_RUNNING,
+
+        MINMOD_FINISHED,
+
+        // The program ran into a limit set by "set_minmod_limits", and was
+        // stopped where it was. Its stacks can still be looked at.
+        MINMOD_LIMIT_EXCEEDED,
+
+        // The stacks of the program were about to take more memory than
+        // "set_minmod_memory_quota" allows, and the program was stopped in
+        // the middle of a step.
+        MINMOD_OUT_OF_MEMORY
+};
+
+struct MinmodContext * create_minmod_context(void);
+
+// Destroys "context" along with the program in it, running or not.
+void destroy_minmod_context(struct MinmodContext * context);
+
+// Loads the program at "file_path" into "context", which holds a single
+// program, so it can't have loaded one before.
+// Returns "false" if the program can't be lexed or parsed.
+bool load_minmod_file(struct MinmodContext * context, const char * file_path);
+
+// Like "load_minmod_file", but the program is the "length" bytes at
+// "contents", which are copied. "file_path" is where the program is
+// reported to be, and where its imports are loaded from.
+bool load_minmod_buffer(struct MinmodContext * context,
+                        const char * file_path,
+                        const char * contents,
+                        size_t length);
+
+// Limits how many steps the program may run, and for how many
+// milliseconds, over all calls to "run_minmod_steps". 0 means no limit,
+// which is the default. The time limit is checked every few thousand
+// steps, so it may be overrun a little.
+void set_minmod_limits(struct MinmodContext * context, uint64_t max_steps, uint64_t time_limit_ms);
+
+// Limits the memory the stacks of the program may take to "quota" bytes.
+// 0 means no limit, which is the default. The stacks of the program as it's
+// loaded count towards it too.
+void set_minmod_memory_quota(struct MinmodContext * context, size_t quota);
+
+// The most memory the stacks of the program have taken at once, in bytes.
+size_t get_minmod_peak_memory(const struct MinmodContext * context);
+
+// Gets the most elements the data stack and the instruction stack were
+// estimated to have as the program runs, when it was loaded. Returns
+// "false", with both being 0, if the program couldn't be analyzed.
+bool get_minmod_depth_estimate(const struct MinmodContext * context,
+                               size_t * data_stack_depth,
+                               size_t * instr_stack_depth);
+
+// The number of times stacks had to grow as the program ran, which is 0
+// when the estimate of how deep they get held and the quota left room to
+// presize them for it.
+size_t get_minmod_grow_count(const struct MinmodContext * context);
+
+// Runs at most "max_steps" more steps of the program, and returns the
+// status of the program after them.
+enum MinmodStatus run_minmod_steps(struct MinmodContext * context, uint64_t max_steps);
+
+enum MinmodStatus get_minmod_status(const struct MinmodContext * context);
+
+// The number of steps the program has run since it was loaded.
+uint64_t get_minmod_step_count(const struct MinmodContext * context);
+
+// The stacks of a program are the values of its instruction types, the
+// instruction stack and the data stack among them. They're indexed in the
+// order they're first found in the program. Instruction types the program
+// never uses are left out when it's loaded, unless they're logged.
+size_t get_minmod_stack_count(const struct MinmodContext * context);
+
+const char * get_minmod_stack_name(const struct MinmodContext * context, size_t index);
+
+// Returns the stack named "name" written as (min)mod code, top last, or
+// "NULL" if there's no such stack or it's uninitialized. The returned
+// string must be freed using "free_minmod_str".
+char * format_minmod_stack(const struct MinmodContext * context, const char * name);
+
+void free_minmod_str(char * str);
+
+// Everything logged while using "context", such as the errors of the
+// program. Valid until "context" is used again.
+const char * get_minmod_log(const struct MinmodContext * context);
+
+#endif
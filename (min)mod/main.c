@@ -1,46 +1,410 @@
-#include <string.h>
-#include "tools/log.h"
-#include "tools/list.h"
-#include "preprocessing/lexing.h"
-#include "preprocessing/parsing.h"
-#include "running/running.h"
-#include "data_types/itype.h"
-
-#include "tools/debug.h"
-
-int main(int argc, char ** argv)
-{
-        if (argc < 2 || argc > 3) {
-                LOG_FATAL_ERROR("Expected 2-3 arguments "
-                       "(file path to (min)mod.exe, file path to .(min)mod program, debug state), "
-                       "got %d.\n", argc);
-                proper_exit(EXIT_FAILURE);
-        }
-
-        const char * file_path = argv[1];
-
-        struct List token_list = lex(file_path);
-        if (!list_is_valid(&token_list)) {
-                LOG_FATAL_ERROR("Failed to lex \"%s\".\n", file_path);
-                proper_exit(EXIT_FAILURE);
-        }
-
-        struct List itype_list = parse(&token_list);
-
-        bool debug = false;
-        if (argc == 3 && strcmp(argv[2], "-d") == 0) {
-                debug = true;
-        }
-
-        enum ErrState ret_val = run(&itype_list, debug);
-
-        LOG(LOG_LVL_CONSOLE, "Final stacks:\n");
-        log_itype_list(LOG_LVL_CONSOLE, &itype_list);
-        LOG(LOG_LVL_CONSOLE, "\n");
-
-        if (ret_val == ERR_FAILURE) {
-                proper_exit(EXIT_FAILURE);
-        } else {
-                proper_exit(EXIT_SUCCESS);
-        }
-}
+#include "options.h"
+#include "batch.h"
+#include "server.h"
+#include "settings.h"
+#include "tools/log.h"
+#include "tools/list.h"
+#include "tools/thread_pool.h"
+#include "tools/platform.h"
+#include "tools/mem_tools.h"
+#include "preprocessing/lexing.h"
+#include "preprocessing/parsing.h"
+#include "preprocessing/image.h"
+#include "preprocessing/optimizing.h"
+#include "preprocessing/presizing.h"
+#include "running/running.h"
+#include "running/result_cache.h"
+#include "data_types/itype.h"
+#include "data_types/stack.h"
+
+#include "tools/debug.h"
+
+// How often files are checked for changes in watch mode, in milliseconds,
+// if the operating system doesn't tell when they change sooner.
+#define WATCH_INTERVAL_MS 250
+
+// Lexes and parses the program at "options->file_path" into "itype_list",
+// exiting if it can't. The files are lexed from "token_cache", unless it's
+// "NULL".
+static void lex_and_parse(const struct Options * options,
+                          struct ITypeList * itype_list,
+                          struct List * sources,
+                          struct TokenCache * token_cache)
+{
+        const char * file_path = options->file_path;
+
+        // Files are lexed on the main thread only, unless asked otherwise.
+        struct ThreadPool * lex_pool = NULL;
+        if (!token_cache && options->lex_thread_count > 0) {
+                lex_pool = create_thread_pool(options->lex_thread_count);
+        }
+
+        struct TokenIter tokens;
+        if (token_cache) {
+                tokens = lex_cached(file_path, &itype_list->names, sources, token_cache);
+        } else {
+                tokens = lex(file_path, &itype_list->names, sources, lex_pool);
+        }
+        if (!is_token_iter_valid(&tokens)) {
+                LOG_FATAL_ERROR("Failed to lex \"%s\".\n", file_path);
+                proper_exit(EXIT_FAILURE);
+        }
+
+        if (!parse(&tokens, itype_list)) {
+                LOG_FATAL_ERROR("Failed to parse \"%s\".\n", file_path);
+                proper_exit(EXIT_FAILURE);
+        }
+
+        destroy_token_iter(&tokens);
+
+        if (lex_pool) {
+                destroy_thread_pool(lex_pool);
+        }
+}
+
+// Lexes every file of the program at "options->file_path" into
+// "token_cache", and then logs the result of the program and exits if it's
+// in the result cache already.
+// Otherwise, returns the path the result should be saved to, and stores
+// the files of the program in "closure". Returns "NULL" if the files can't
+// all be loaded, leaving it to lexing to report why.
+static char * find_result(const struct Options * options,
+                          struct TokenCache * token_cache,
+                          struct List * closure)
+{
+        update_token_cache(token_cache, options->file_path);
+
+        *closure = create_list(sizeof(struct SourceFile *), NULL);
+
+        size_t file_count = get_token_cache_length(token_cache);
+        for (size_t i = 0; i < file_count; ++i) {
+                const struct SourceFile * source = get_cached_source(token_cache, i);
+                if (!source) {
+                        return NULL;
+                }
+                list_append(closure, &source);
+        }
+        if (file_count == 0) {
+                return NULL;
+        }
+
+        char * result_path = get_result_path(closure, options->result_cache_dir);
+
+        char * result = load_result(result_path, closure);
+        if (result) {
+                LOG(LOG_LVL_CONSOLE, "%s", result);
+                FREE(result);
+                FREE(result_path);
+                proper_exit(EXIT_SUCCESS);
+        }
+
+        return result_path;
+}
+
+static struct RunOptions get_run_options(const struct Options * options)
+{
+        struct RunOptions run_options;
+        run_options.debug = options->debug;
+        run_options.checkpoint_path = options->checkpoint_path;
+        run_options.checkpoint_interval = options->checkpoint_interval;
+        run_options.limits.max_steps = options->max_steps;
+        run_options.limits.time_limit_ms = options->time_limit_ms;
+
+        return run_options;
+}
+
+static int get_exit_code(enum ErrState err_state)
+{
+        switch (err_state) {
+        case ERR_FAILURE:
+                return EXIT_FAILURE;
+        case ERR_LIMIT_EXCEEDED:
+                return EXIT_LIMIT_EXCEEDED;
+        case ERR_OUT_OF_MEMORY:
+                return EXIT_OUT_OF_MEMORY;
+        default:
+                return EXIT_SUCCESS;
+        }
+}
+
+// Logs the most memory the stacks of the program took, if it was limited,
+// next to how deep they were estimated to get and how many times they grew
+// anyway as the program ran.
+static void log_peak_memory(const struct Options * options, const struct DepthEstimate * estimate)
+{
+        if (options->max_memory == 0) {
+                return;
+        }
+
+        const struct StackMemory * memory = get_thread_stack_memory();
+
+        if (estimate->is_known) {
+                LOG(LOG_LVL_CONSOLE, "The stacks took at most %zu of %zu bytes, were estimated "
+                    "to get %zu (%s) and %zu (%s) elements deep and grew %zu times.\n",
+                    memory->peak, options->max_memory,
+                    estimate->data_stack_depth, g_data_stack_str,
+                    estimate->instr_stack_depth, g_instr_stack_str, memory->grow_count);
+        } else {
+                LOG(LOG_LVL_CONSOLE, "The stacks took at most %zu of %zu bytes, couldn't be "
+                    "estimated and grew %zu times.\n",
+                    memory->peak, options->max_memory, memory->grow_count);
+        }
+}
+
+static void log_final_stacks(const struct ITypeList * itype_list)
+{
+        LOG(LOG_LVL_CONSOLE, "Final stacks:\n");
+        log_itype_list(LOG_LVL_CONSOLE, itype_list);
+        LOG(LOG_LVL_CONSOLE, "\n");
+}
+
+static void append_chars(void * chars, const char * str, size_t length)
+{
+        for (size_t i = 0; i < length; ++i) {
+                list_append(chars, &str[i]);
+        }
+}
+
+// Returns what "log_final_stacks" logs, null-terminated and "ALLOC"ed.
+static char * format_final_stacks(const struct ITypeList * itype_list)
+{
+        struct List chars = create_list(sizeof(char), NULL);
+
+        set_thread_log_sink(append_chars, &chars);
+        log_final_stacks(itype_list);
+        set_thread_log_sink(NULL, NULL);
+
+        char * str = ALLOC(char, chars.length + 1);
+        COPY_MEMORY(str, chars.contents, char, chars.length);
+        str[chars.length] = '\0';
+        destroy_list(&chars);
+
+        return str;
+}
+
+// What "run_watched_program" needs.
+struct WatchedRun {
+        const struct Options * options;
+        struct TokenCache * cache;
+};
+
+// Lexes the program from the cache of "arg", a "struct WatchedRun", and
+// parses and runs it. Returns the exit code of the program.
+// The program is destroyed before returning, so that runs which aren't in a
+// child process don't add up either.
+static int run_watched_program(void * arg)
+{
+        const struct WatchedRun * watched_run = arg;
+        const char * file_path = watched_run->options->file_path;
+
+        struct ITypeList itype_list = create_itype_list();
+
+        // The source files are owned by the cache.
+        struct List sources = create_list(sizeof(struct SourceFile *), NULL);
+
+        struct TokenIter tokens = lex_cached(file_path, &itype_list.names, &sources,
+                                             watched_run->cache);
+        if (!is_token_iter_valid(&tokens)) {
+                LOG_FATAL_ERROR("Failed to lex \"%s\".\n", file_path);
+                destroy_list(&sources);
+                destroy_itype_list(&itype_list);
+                return EXIT_FAILURE;
+        }
+
+        bool is_parsed = parse(&tokens, &itype_list);
+
+        destroy_token_iter(&tokens);
+        destroy_list(&sources);
+
+        if (!is_parsed) {
+                LOG_FATAL_ERROR("Failed to parse \"%s\".\n", file_path);
+                destroy_itype_list(&itype_list);
+                return EXIT_FAILURE;
+        }
+
+        struct DepthEstimate estimate = optimize(&itype_list);
+        presize_stacks(&itype_list, &estimate);
+
+        // Stacks only count as growing once the program runs.
+        get_thread_stack_memory()->grow_count = 0;
+
+        struct RunOptions run_options = get_run_options(watched_run->options);
+        enum ErrState ret_val = run(&itype_list, &run_options);
+        if (ret_val == ERR_INTERRUPTED) {
+                destroy_itype_list(&itype_list);
+                return EXIT_FAILURE;
+        }
+
+        log_final_stacks(&itype_list);
+        log_peak_memory(watched_run->options, &estimate);
+
+        destroy_itype_list(&itype_list);
+
+        return get_exit_code(ret_val);
+}
+
+// Runs the program, and then runs it again every time one of its files
+// changes, until the process is killed. Each run happens in a child process
+// where possible, so that the memory of one run never adds up with the
+// next, and the files are cached by the parent process in between.
+static void watch(const struct Options * options)
+{
+        struct TokenCache * cache = create_token_cache();
+
+        struct FileWatcher watcher;
+        create_file_watcher(&watcher);
+
+        struct WatchedRun watched_run;
+        watched_run.options = options;
+        watched_run.cache = cache;
+
+        while (true) {
+                update_token_cache(cache, options->file_path);
+
+                size_t file_count = get_token_cache_length(cache);
+                for (size_t i = 0; i < file_count; ++i) {
+                        watch_file(&watcher, get_cached_file_path(cache, i));
+                }
+
+                int exit_code;
+                if (!run_in_child_process(run_watched_program, &watched_run, &exit_code)) {
+                        exit_code = run_watched_program(&watched_run);
+                }
+
+                LOG(LOG_LVL_CONSOLE, "\nProcess returned %d (0x%x).\n", exit_code, exit_code);
+                LOG(LOG_LVL_CONSOLE, "Watching %zu files for changes ...\n", file_count);
+
+                while (!is_token_cache_stale(cache)) {
+                        wait_for_file_events(&watcher, WATCH_INTERVAL_MS);
+                }
+        }
+}
+
+int main(int argc, char ** argv)
+{
+        struct Options options;
+        if (!parse_options(argc, argv, &options)) {
+                log_usage(LOG_LVL_CONSOLE, argv[0]);
+                proper_exit(EXIT_FAILURE);
+        }
+
+        // Stacks can't fail to be parsed or loaded, only to grow while the
+        // program runs, so the quota applies from the start.
+        struct StackMemory memory = create_stack_memory(options.max_memory);
+        set_thread_stack_memory(&memory);
+
+        if (options.watch) {
+                watch(&options);
+        }
+
+        // Records are read by other programs, so batch mode exits without
+        // waiting for anyone.
+        if (options.batch_path) {
+                struct BatchOptions batch_options;
+                batch_options.manifest_path = options.batch_path;
+                batch_options.thread_count = options.thread_count > 0 ? options.thread_count
+                                                                      : get_cpu_count();
+                batch_options.max_steps = options.max_steps;
+                batch_options.time_limit_ms = options.time_limit_ms;
+                batch_options.max_memory = options.max_memory;
+
+                bool is_successful = run_batch(&batch_options, stdout);
+                exit(is_successful ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        // Servers run in the background, so there's nobody to wait for
+        // either.
+        if (options.serve_path) {
+                struct ServerOptions server_options;
+                server_options.manifest_path = options.serve_path;
+                server_options.socket_path = options.socket_path;
+                server_options.worker_count = options.thread_count > 0 ? options.thread_count
+                                                                       : get_cpu_count();
+                server_options.timeout_ms = options.request_timeout_ms;
+                server_options.max_steps = options.max_steps;
+                server_options.max_memory = options.max_memory;
+
+                bool is_started = run_server(&server_options);
+                exit(is_started ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        struct ITypeList itype_list = create_itype_list();
+
+        // With a result cache, every file of the program is lexed before
+        // it's parsed, so that its result can be looked up first.
+        struct TokenCache * token_cache = NULL;
+        struct List closure;
+        char * result_path = NULL;
+        if (options.result_cache_dir) {
+                token_cache = create_token_cache();
+                result_path = find_result(&options, token_cache, &closure);
+        }
+
+        // Kept alive for the rest of the program, since tokens and error
+        // messages refer to the contents and paths of the source files.
+        // The source files belong to the token cache if there is one.
+        struct List sources = token_cache ? create_list(sizeof(struct SourceFile *), NULL)
+                                          : create_source_file_list();
+
+        if (options.restore_path) {
+                if (!load_checkpoint(options.restore_path, &itype_list)) {
+                        LOG_FATAL_ERROR("Failed to restore \"%s\".\n", options.restore_path);
+                        proper_exit(EXIT_FAILURE);
+                }
+        } else {
+                char * image_path = NULL;
+                if (options.use_image) {
+                        image_path = get_image_path(options.file_path, options.image_cache_dir);
+                }
+
+                if (!image_path || !load_image(image_path, options.file_path, &itype_list)) {
+                        lex_and_parse(&options, &itype_list, &sources, token_cache);
+
+                        // Must be saved before the program runs and changes.
+                        if (image_path) {
+                                (void) save_image(image_path, &itype_list, &sources);
+                        }
+                }
+
+                FREE(image_path);
+        }
+
+        // Images and checkpoints have programs as they were before they
+        // were optimized.
+        struct DepthEstimate estimate = optimize(&itype_list);
+        presize_stacks(&itype_list, &estimate);
+
+        // Stacks only count as growing once the program runs.
+        get_thread_stack_memory()->grow_count = 0;
+
+        struct RunOptions run_options = get_run_options(&options);
+        enum ErrState ret_val = run(&itype_list, &run_options);
+
+        if (ret_val == ERR_INTERRUPTED) {
+                LOG(LOG_LVL_CONSOLE, "Interrupted. Run \"%s --restore %s\" to resume.\n",
+                    argv[0], options.checkpoint_path);
+                proper_exit(EXIT_FAILURE);
+        }
+
+        // Programs stopped by a limit get their stacks logged as well, as
+        // they were when it was exceeded.
+        // Only the results of programs that finished are cached, since the
+        // errors of the others aren't part of them.
+        if (ret_val == ERR_SUCCESS && result_path) {
+                char * result = format_final_stacks(&itype_list);
+                LOG(LOG_LVL_CONSOLE, "%s", result);
+                (void) save_result(result_path, &closure, result);
+                FREE(result);
+        } else {
+                log_final_stacks(&itype_list);
+        }
+
+        log_peak_memory(&options, &estimate);
+
+        if (ret_val == ERR_LIMIT_EXCEEDED && options.checkpoint_path) {
+                LOG(LOG_LVL_CONSOLE, "Run \"%s --restore %s\" to resume.\n",
+                    argv[0], options.checkpoint_path);
+        }
+
+        proper_exit(get_exit_code(ret_val));
+}
@@ -0,0 +1,327 @@
+#include "options.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tools/log.h"
+#include "tools/platform.h"
+
+// How long the server may take to serve a request by default, in
+// milliseconds.
+#define DEFAULT_REQUEST_TIMEOUT_MS 10000
+
+static struct Options create_default_options(void)
+{
+        struct Options options;
+        options.file_path = NULL;
+        options.debug = false;
+        options.lex_thread_count = 0;
+        options.thread_count = 0;
+        options.use_image = false;
+        options.image_cache_dir = NULL;
+        options.result_cache_dir = NULL;
+        options.watch = false;
+        options.checkpoint_path = NULL;
+        options.checkpoint_interval = 0;
+        options.max_steps = 0;
+        options.time_limit_ms = 0;
+        options.max_memory = 0;
+        options.restore_path = NULL;
+        options.batch_path = NULL;
+        options.serve_path = NULL;
+        options.socket_path = NULL;
+        options.request_timeout_ms = DEFAULT_REQUEST_TIMEOUT_MS;
+
+        return options;
+}
+
+// Returns "false" if "str" isn't a whole non-negative number.
+static bool parse_count(const char * str, int * count)
+{
+        char * str_end;
+        long value = strtol(str, &str_end, 10);
+        if (str_end == str || *str_end != '\0' || value < 0 || value > 4096) {
+                return false;
+        }
+
+        *count = value;
+        return true;
+}
+
+// Returns "false" if "str" isn't a whole positive number.
+static bool parse_step_count(const char * str, uint64_t * count)
+{
+        // "strtoull" would accept a minus sign.
+        if (*str < '0' || *str > '9') {
+                return false;
+        }
+
+        char * str_end;
+        errno = 0;
+        unsigned long long value = strtoull(str, &str_end, 10);
+        if (*str_end != '\0' || errno == ERANGE || value == 0) {
+                return false;
+        }
+
+        *count = value;
+        return true;
+}
+
+// Returns "false" if "str" isn't a whole positive number of bytes that
+// fits in a "size_t".
+static bool parse_byte_count(const char * str, size_t * byte_count)
+{
+        uint64_t value;
+        if (!parse_step_count(str, &value) || value > SIZE_MAX) {
+                return false;
+        }
+
+        *byte_count = value;
+        return true;
+}
+
+// Returns "false" if "str" isn't a whole positive number of milliseconds
+// that fits in an "int".
+static bool parse_timeout(const char * str, int * timeout_ms)
+{
+        uint64_t value;
+        if (!parse_step_count(str, &value) || value > INT_MAX) {
+                return false;
+        }
+
+        *timeout_ms = value;
+        return true;
+}
+
+// Returns the argument following the option at "*arg_index", making
+// "*arg_index" skip past it, or "NULL" if there's none.
+static const char * get_option_value(int argc, char ** argv, int * arg_index)
+{
+        ASSERT_OR_HANDLE(*arg_index + 1 < argc, NULL,
+                         "Option \"%s\" expects a value.", argv[*arg_index]);
+
+        ++*arg_index;
+        return argv[*arg_index];
+}
+
+bool parse_options(int argc, char ** argv, struct Options * options)
+{
+        *options = create_default_options();
+
+        bool is_timeout_given = false;
+
+        for (int i = 1; i < argc; ++i) {
+                const char * arg = argv[i];
+
+                if (strcmp(arg, "-d") == 0) {
+                        options->debug = true;
+
+                } else if (strcmp(arg, "-j") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        int job_count = 0;
+                        ASSERT_OR_HANDLE(parse_count(value, &job_count), false,
+                                         "Invalid job count \"%s\".", value);
+
+                        // "-j 0" uses every CPU. The main thread is one of the jobs.
+                        if (job_count == 0) {
+                                job_count = get_cpu_count();
+                        }
+                        options->lex_thread_count = job_count > 1 ? job_count - 1 : 0;
+                        options->thread_count = job_count;
+
+                } else if (strcmp(arg, "-c") == 0) {
+                        options->use_image = true;
+
+                } else if (strcmp(arg, "--cache-dir") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        options->use_image = true;
+                        options->image_cache_dir = value;
+
+                } else if (strcmp(arg, "--result-cache") == 0) {
+                        options->result_cache_dir = get_option_value(argc, argv, &i);
+                        if (!options->result_cache_dir) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--watch") == 0) {
+                        options->watch = true;
+
+                } else if (strcmp(arg, "--checkpoint") == 0) {
+                        options->checkpoint_path = get_option_value(argc, argv, &i);
+                        if (!options->checkpoint_path) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--checkpoint-every") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        ASSERT_OR_HANDLE(parse_step_count(value, &options->checkpoint_interval),
+                                         false, "Invalid step count \"%s\".", value);
+
+                } else if (strcmp(arg, "--max-steps") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        ASSERT_OR_HANDLE(parse_step_count(value, &options->max_steps),
+                                         false, "Invalid step count \"%s\".", value);
+
+                } else if (strcmp(arg, "--time-limit") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        // Any number of milliseconds fits, being a step count.
+                        ASSERT_OR_HANDLE(parse_step_count(value, &options->time_limit_ms),
+                                         false, "Invalid time limit \"%s\".", value);
+
+                } else if (strcmp(arg, "--max-memory") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        ASSERT_OR_HANDLE(parse_byte_count(value, &options->max_memory),
+                                         false, "Invalid byte count \"%s\".", value);
+
+                } else if (strcmp(arg, "--restore") == 0) {
+                        options->restore_path = get_option_value(argc, argv, &i);
+                        if (!options->restore_path) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--batch") == 0) {
+                        options->batch_path = get_option_value(argc, argv, &i);
+                        if (!options->batch_path) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--serve") == 0) {
+                        options->serve_path = get_option_value(argc, argv, &i);
+                        if (!options->serve_path) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--socket") == 0) {
+                        options->socket_path = get_option_value(argc, argv, &i);
+                        if (!options->socket_path) {
+                                return false;
+                        }
+
+                } else if (strcmp(arg, "--timeout") == 0) {
+                        const char * value = get_option_value(argc, argv, &i);
+                        if (!value) {
+                                return false;
+                        }
+
+                        ASSERT_OR_HANDLE(parse_timeout(value, &options->request_timeout_ms), false,
+                                         "Invalid timeout \"%s\".", value);
+                        is_timeout_given = true;
+
+                } else if (arg[0] == '-' && arg[1] != '\0') {
+                        ASSERT_OR_HANDLE(false, false, "Unknown option \"%s\".", arg);
+
+                } else {
+                        ASSERT_OR_HANDLE(!options->file_path, false,
+                                         "Expected a single program, got \"%s\" and \"%s\".",
+                                         options->file_path, arg);
+                        options->file_path = arg;
+                }
+        }
+
+        if (options->serve_path) {
+                ASSERT_OR_HANDLE(options->socket_path, false,
+                                 "Server mode requires \"--socket\".");
+                ASSERT_OR_HANDLE(!options->file_path && !options->restore_path
+                                 && !options->batch_path, false,
+                                 "Server mode serves the programs of its manifest only.");
+                ASSERT_OR_HANDLE(!options->debug && !options->watch && !options->use_image
+                                 && !options->result_cache_dir && !options->checkpoint_path
+                                 && options->time_limit_ms == 0, false,
+                                 "Server mode only supports \"-j\", \"--timeout\", \"--max-steps\" and "
+                                 "\"--max-memory\".");
+        } else if (options->batch_path) {
+                ASSERT_OR_HANDLE(!options->file_path && !options->restore_path, false,
+                                 "Batch mode runs the programs of its manifest only.");
+                ASSERT_OR_HANDLE(!options->debug && !options->watch && !options->use_image
+                                 && !options->result_cache_dir && !options->checkpoint_path, false,
+                                 "Batch mode only supports \"-j\", \"--max-steps\", \"--time-limit\" and "
+                                 "\"--max-memory\".");
+        } else if (options->restore_path) {
+                ASSERT_OR_HANDLE(!options->file_path, false,
+                                 "Expected either a program or a checkpoint to restore, got both.");
+                ASSERT_OR_HANDLE(!options->watch, false,
+                                 "Programs restored from checkpoints can't be watched.");
+                ASSERT_OR_HANDLE(!options->result_cache_dir, false,
+                                 "Results of programs restored from checkpoints aren't cached.");
+        } else {
+                ASSERT_OR_HANDLE(options->file_path, false, "Expected a program to run.");
+        }
+
+        ASSERT_OR_HANDLE(options->checkpoint_path || options->checkpoint_interval == 0, false,
+                         "\"--checkpoint-every\" requires \"--checkpoint\".");
+        ASSERT_OR_HANDLE(!options->debug || options->time_limit_ms == 0, false,
+                         "Programs run with \"-d\" can't have a time limit.");
+        ASSERT_OR_HANDLE(!options->result_cache_dir || (!options->debug && !options->watch), false,
+                         "Results of programs run with \"-d\" or \"--watch\" aren't cached.");
+        ASSERT_OR_HANDLE(options->serve_path || (!options->socket_path && !is_timeout_given), false,
+                         "\"--socket\" and \"--timeout\" require \"--serve\".");
+
+        return true;
+}
+
+void log_usage(int log_level, const char * program_name)
+{
+        LOG_HIDE_LEVEL(log_level, "Usage: %s <program> [options]\n", program_name);
+        LOG_HIDE_LEVEL(log_level, "       %s --restore <file> [options]\n", program_name);
+        LOG_HIDE_LEVEL(log_level, "       %s --batch <manifest> [-j <n>] [--max-steps <n>] [--time-limit <ms>]\n",
+                       program_name);
+        LOG_HIDE_LEVEL(log_level, "                [--max-memory <bytes>]\n");
+        LOG_HIDE_LEVEL(log_level, "       %s --serve <manifest> --socket <path> [-j <n>] [--timeout <ms>]\n",
+                       program_name);
+        LOG_HIDE_LEVEL(log_level, "                [--max-steps <n>] [--max-memory <bytes>]\n");
+        LOG_HIDE_LEVEL(log_level, "  -d                 Step through the program one instruction at a time.\n");
+        LOG_HIDE_LEVEL(log_level, "  -j <n>             Lex source files using <n> threads. 0 uses every CPU.\n");
+        LOG_HIDE_LEVEL(log_level, "  -c                 Cache the parsed program in an image next to it.\n");
+        LOG_HIDE_LEVEL(log_level, "  --cache-dir <dir>  Cache the parsed program in an image in <dir>.\n");
+        LOG_HIDE_LEVEL(log_level, "  --result-cache <dir>\n");
+        LOG_HIDE_LEVEL(log_level, "                     Cache the final stacks of the program in <dir>, and\n");
+        LOG_HIDE_LEVEL(log_level, "                     skip parsing and running it while its files don't\n");
+        LOG_HIDE_LEVEL(log_level, "                     change.\n");
+        LOG_HIDE_LEVEL(log_level, "  --watch            Run the program again whenever its files change.\n");
+        LOG_HIDE_LEVEL(log_level, "  --checkpoint <file>\n");
+        LOG_HIDE_LEVEL(log_level, "                     Save the running program to <file> on SIGTERM, and\n");
+        LOG_HIDE_LEVEL(log_level, "                     when it's stopped by a limit.\n");
+        LOG_HIDE_LEVEL(log_level, "  --checkpoint-every <n>\n");
+        LOG_HIDE_LEVEL(log_level, "                     Also save it every <n> steps.\n");
+        LOG_HIDE_LEVEL(log_level, "  --max-steps <n>    Stop the program after <n> steps, logging its stacks\n");
+        LOG_HIDE_LEVEL(log_level, "                     and exiting with 2.\n");
+        LOG_HIDE_LEVEL(log_level, "  --time-limit <ms>  Stop the program after <ms> milliseconds the same way.\n");
+        LOG_HIDE_LEVEL(log_level, "  --max-memory <bytes>\n");
+        LOG_HIDE_LEVEL(log_level, "                     Stop the program before its stacks take more than\n");
+        LOG_HIDE_LEVEL(log_level, "                     <bytes> the same way, exiting with 3. The most they\n");
+        LOG_HIDE_LEVEL(log_level, "                     took is logged at the end.\n");
+        LOG_HIDE_LEVEL(log_level, "  --restore <file>   Resume a program from a checkpoint.\n");
+        LOG_HIDE_LEVEL(log_level, "  --batch <manifest> Run every program listed in <manifest> using <n>\n");
+        LOG_HIDE_LEVEL(log_level, "                     threads, every CPU by default, and write a JSON\n");
+        LOG_HIDE_LEVEL(log_level, "                     record of each run per line.\n");
+        LOG_HIDE_LEVEL(log_level, "  --serve <manifest> Parse every program listed in <manifest> once, and\n");
+        LOG_HIDE_LEVEL(log_level, "                     run them on request using <n> worker processes,\n");
+        LOG_HIDE_LEVEL(log_level, "                     one per CPU by default.\n");
+        LOG_HIDE_LEVEL(log_level, "  --socket <path>    Listen for requests on the Unix domain socket <path>.\n");
+        LOG_HIDE_LEVEL(log_level, "  --timeout <ms>     Stop serving a request after <ms> milliseconds.\n");
+        LOG_HIDE_LEVEL(log_level, "                     Defaults to 10000.\n");
+}
@@ -0,0 +1,82 @@
+// The command line options of (min)mod.
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct Options {
+        // "NULL" if the program is restored from a checkpoint, or in batch
+        // or server mode.
+        const char * file_path;
+
+        // Step through the program one instruction at a time.
+        bool debug;
+
+        // The number of threads lexing source files, in addition to the main
+        // thread. 0 means everything is lexed by the main thread.
+        int lex_thread_count;
+
+        // The number of threads given by "-j", or 0 if it's not given.
+        int thread_count;
+
+        // Load the program from its image if it's up to date, and save the
+        // image after parsing the program otherwise.
+        bool use_image;
+
+        // Where images are kept. "NULL" means next to the programs.
+        const char * image_cache_dir;
+
+        // Where results of programs are cached, or "NULL" if they aren't.
+        const char * result_cache_dir;
+
+        // Run the program again whenever one of its files changes, lexing
+        // only the files that changed. Images and lexing threads aren't used
+        // then.
+        bool watch;
+
+        // Where checkpoints of the running program are saved, or "NULL".
+        const char * checkpoint_path;
+
+        // The number of steps between checkpoints. 0 means checkpoints are
+        // only saved when (min)mod is asked to terminate.
+        uint64_t checkpoint_interval;
+
+        // How many steps the program may run, 0 meaning no limit. In batch
+        // and server mode, it's the limit of each program.
+        uint64_t max_steps;
+
+        // How long the program may run, in milliseconds, 0 meaning no limit.
+        // Server mode uses "request_timeout_ms" instead.
+        uint64_t time_limit_ms;
+
+        // The most memory the stacks of the program may take, in bytes, 0
+        // meaning no limit.
+        size_t max_memory;
+
+        // The checkpoint to resume a program from, or "NULL".
+        const char * restore_path;
+
+        // The manifest of the programs to run in batch mode, or "NULL".
+        const char * batch_path;
+
+        // The manifest of the programs to serve in server mode, or "NULL".
+        const char * serve_path;
+
+        // The socket the server listens on.
+        const char * socket_path;
+
+        // How long the server may take to serve a request, in milliseconds.
+        int request_timeout_ms;
+};
+
+// Reads the options from the arguments of "main".
+// Returns "false" if the arguments are invalid, after logging why.
+bool parse_options(int argc, char ** argv, struct Options * options);
+
+// Logs how (min)mod should be run.
+void log_usage(int log_level, const char * program_name);
+
+#endif
@@ -0,0 +1,376 @@
+#include "char_class.h"
+#include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include "../settings.h"
+#include "../tools/byte.h"
+#include "../tools/log.h"
+#include "../tools/platform.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_SIMD
+#include <immintrin.h>
+#endif
+
+#define CH_CLASS_OTHER 0
+#define CH_CLASS_WHITESPACE 1
+#define CH_CLASS_INSTR 2
+
+// The SIMD kernels hard-code which characters are whitespace and which are
+// printable, so they're only used if the table agrees with them.
+#define SIMD_MIN_INSTR_CH 0x21
+#define SIMD_MAX_INSTR_CH 0x7E
+
+// At most this many characters can be excluded from instruction names
+// within the SIMD range. That's far more than "settings.c" needs.
+#define MAX_SPECIAL_CHS 16
+
+struct CharClassKernels {
+        const char * name;
+        const char * (*skip_whitespace)(const char * begin, const char * end, int * newlines);
+        const char * (*skip_instr_chs)(const char * begin, const char * end);
+        const char * (*find_line_end)(const char * begin, const char * end);
+};
+
+static byte_t s_classes[256];
+static bool s_initialized = false;
+static struct Mutex s_init_mutex = MUTEX_INITIALIZER;
+
+// Characters that would be valid in instruction names if they weren't used
+// for something else, like parentheses.
+static char s_special_chs[MAX_SPECIAL_CHS];
+static int s_special_ch_count = 0;
+
+static struct CharClassKernels s_kernels;
+
+bool is_whitespace_ch(char ch)
+{
+        return s_classes[(byte_t) ch] == CH_CLASS_WHITESPACE;
+}
+
+bool is_instr_ch(char ch)
+{
+        return s_classes[(byte_t) ch] == CH_CLASS_INSTR;
+}
+
+static const char * skip_whitespace_scalar(const char * begin, const char * end, int * newlines)
+{
+        const char * iterator = begin;
+        while (iterator < end && is_whitespace_ch(*iterator)) {
+                if (*iterator == '\n') {
+                        ++*newlines;
+                }
+                ++iterator;
+        }
+        return iterator;
+}
+
+static const char * skip_instr_chs_scalar(const char * begin, const char * end)
+{
+        const char * iterator = begin;
+        while (iterator < end && is_instr_ch(*iterator)) {
+                ++iterator;
+        }
+        return iterator;
+}
+
+static const char * find_line_end_scalar(const char * begin, const char * end)
+{
+        const char * newline = memchr(begin, '\n', end - begin);
+        return newline ? newline : end;
+}
+
+static const struct CharClassKernels s_scalar_kernels = {
+        "scalar",
+        skip_whitespace_scalar,
+        skip_instr_chs_scalar,
+        find_line_end_scalar
+};
+
+#ifdef X86_SIMD
+
+// The kernels below work on blocks of 16 (SSE2) or 32 (AVX2) bytes, turning
+// the result of comparing every byte into a bitmask with one bit per byte.
+// The scalar kernels take care of whatever is left at the end.
+
+__attribute__((target("sse2")))
+static __m128i whitespace_mask_sse2(__m128i block)
+{
+        // '\t', '\n', '\v', '\f' and '\r' are 9 to 13.
+        __m128i is_control_space = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('\t' - 1)),
+                                                 _mm_cmplt_epi8(block, _mm_set1_epi8('\r' + 1)));
+        __m128i is_space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+        return _mm_or_si128(is_control_space, is_space);
+}
+
+__attribute__((target("sse2")))
+static const char * skip_whitespace_sse2(const char * begin, const char * end, int * newlines)
+{
+        const char * iterator = begin;
+        const __m128i newline = _mm_set1_epi8('\n');
+
+        while (end - iterator >= 16) {
+                __m128i block = _mm_loadu_si128((const __m128i *) iterator);
+                uint32_t whitespace = _mm_movemask_epi8(whitespace_mask_sse2(block));
+                uint32_t newline_bits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+                if (whitespace != 0xFFFF) {
+                        int run_length = __builtin_ctz(~whitespace);
+                        *newlines += __builtin_popcount(newline_bits & ((1u << run_length) - 1));
+                        return iterator + run_length;
+                }
+
+                *newlines += __builtin_popcount(newline_bits);
+                iterator += 16;
+        }
+
+        return skip_whitespace_scalar(iterator, end, newlines);
+}
+
+__attribute__((target("sse2")))
+static const char * skip_instr_chs_sse2(const char * begin, const char * end)
+{
+        const char * iterator = begin;
+
+        // Bytes from 0x80 are negative when compared as signed, so they fail
+        // the first comparison.
+        const __m128i below_min = _mm_set1_epi8(SIMD_MIN_INSTR_CH - 1);
+        const __m128i above_max = _mm_set1_epi8(SIMD_MAX_INSTR_CH + 1);
+
+        while (end - iterator >= 16) {
+                __m128i block = _mm_loadu_si128((const __m128i *) iterator);
+                __m128i is_instr = _mm_and_si128(_mm_cmpgt_epi8(block, below_min),
+                                                 _mm_cmplt_epi8(block, above_max));
+
+                for (int i = 0; i < s_special_ch_count; ++i) {
+                        __m128i is_special = _mm_cmpeq_epi8(block, _mm_set1_epi8(s_special_chs[i]));
+                        is_instr = _mm_andnot_si128(is_special, is_instr);
+                }
+
+                uint32_t instr_bits = _mm_movemask_epi8(is_instr);
+                if (instr_bits != 0xFFFF) {
+                        return iterator + __builtin_ctz(~instr_bits);
+                }
+
+                iterator += 16;
+        }
+
+        return skip_instr_chs_scalar(iterator, end);
+}
+
+__attribute__((target("sse2")))
+static const char * find_line_end_sse2(const char * begin, const char * end)
+{
+        const char * iterator = begin;
+        const __m128i newline = _mm_set1_epi8('\n');
+
+        while (end - iterator >= 16) {
+                __m128i block = _mm_loadu_si128((const __m128i *) iterator);
+                uint32_t newline_bits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+                if (newline_bits) {
+                        return iterator + __builtin_ctz(newline_bits);
+                }
+
+                iterator += 16;
+        }
+
+        return find_line_end_scalar(iterator, end);
+}
+
+static const struct CharClassKernels s_sse2_kernels = {
+        "SSE2",
+        skip_whitespace_sse2,
+        skip_instr_chs_sse2,
+        find_line_end_sse2
+};
+
+__attribute__((target("avx2")))
+static __m256i whitespace_mask_avx2(__m256i block)
+{
+        __m256i is_control_space = _mm256_and_si256(
+                _mm256_cmpgt_epi8(block, _mm256_set1_epi8('\t' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), block));
+        __m256i is_space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+        return _mm256_or_si256(is_control_space, is_space);
+}
+
+__attribute__((target("avx2,popcnt,bmi")))
+static const char * skip_whitespace_avx2(const char * begin, const char * end, int * newlines)
+{
+        const char * iterator = begin;
+        const __m256i newline = _mm256_set1_epi8('\n');
+
+        while (end - iterator >= 32) {
+                __m256i block = _mm256_loadu_si256((const __m256i *) iterator);
+                uint32_t whitespace = _mm256_movemask_epi8(whitespace_mask_avx2(block));
+                uint32_t newline_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+
+                if (whitespace != 0xFFFFFFFF) {
+                        int run_length = __builtin_ctz(~whitespace);
+                        uint32_t run_bits = run_length == 0 ? 0 : (0xFFFFFFFF >> (32 - run_length));
+                        *newlines += __builtin_popcount(newline_bits & run_bits);
+                        return iterator + run_length;
+                }
+
+                *newlines += __builtin_popcount(newline_bits);
+                iterator += 32;
+        }
+
+        return skip_whitespace_sse2(iterator, end, newlines);
+}
+
+__attribute__((target("avx2,bmi")))
+static const char * skip_instr_chs_avx2(const char * begin, const char * end)
+{
+        const char * iterator = begin;
+        const __m256i below_min = _mm256_set1_epi8(SIMD_MIN_INSTR_CH - 1);
+        const __m256i above_max = _mm256_set1_epi8(SIMD_MAX_INSTR_CH + 1);
+
+        while (end - iterator >= 32) {
+                __m256i block = _mm256_loadu_si256((const __m256i *) iterator);
+                __m256i is_instr = _mm256_and_si256(_mm256_cmpgt_epi8(block, below_min),
+                                                    _mm256_cmpgt_epi8(above_max, block));
+
+                for (int i = 0; i < s_special_ch_count; ++i) {
+                        __m256i special = _mm256_set1_epi8(s_special_chs[i]);
+                        is_instr = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, special), is_instr);
+                }
+
+                uint32_t instr_bits = _mm256_movemask_epi8(is_instr);
+                if (instr_bits != 0xFFFFFFFF) {
+                        return iterator + __builtin_ctz(~instr_bits);
+                }
+
+                iterator += 32;
+        }
+
+        return skip_instr_chs_sse2(iterator, end);
+}
+
+__attribute__((target("avx2,bmi")))
+static const char * find_line_end_avx2(const char * begin, const char * end)
+{
+        const char * iterator = begin;
+        const __m256i newline = _mm256_set1_epi8('\n');
+
+        while (end - iterator >= 32) {
+                __m256i block = _mm256_loadu_si256((const __m256i *) iterator);
+                uint32_t newline_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+
+                if (newline_bits) {
+                        return iterator + __builtin_ctz(newline_bits);
+                }
+
+                iterator += 32;
+        }
+
+        return find_line_end_sse2(iterator, end);
+}
+
+static const struct CharClassKernels s_avx2_kernels = {
+        "AVX2",
+        skip_whitespace_avx2,
+        skip_instr_chs_avx2,
+        find_line_end_avx2
+};
+
+#endif
+
+// Returns "true" iff the table classifies characters the way the SIMD
+// kernels assume, which also fills in "s_special_chs".
+static bool table_matches_simd_kernels(void)
+{
+        s_special_ch_count = 0;
+
+        for (int ch = 0; ch < 256; ++ch) {
+                bool is_simd_whitespace = (ch >= '\t' && ch <= '\r') || ch == ' ';
+                bool is_in_instr_range = ch >= SIMD_MIN_INSTR_CH && ch <= SIMD_MAX_INSTR_CH;
+
+                if ((s_classes[ch] == CH_CLASS_WHITESPACE) != is_simd_whitespace) {
+                        return false;
+                }
+
+                if (s_classes[ch] == CH_CLASS_INSTR && !is_in_instr_range) {
+                        return false;
+                }
+
+                if (s_classes[ch] != CH_CLASS_INSTR && is_in_instr_range) {
+                        if (s_special_ch_count == MAX_SPECIAL_CHS) {
+                                return false;
+                        }
+                        s_special_chs[s_special_ch_count] = ch;
+                        ++s_special_ch_count;
+                }
+        }
+
+        return true;
+}
+
+static struct CharClassKernels choose_kernels(void)
+{
+        if (!table_matches_simd_kernels()) {
+                return s_scalar_kernels;
+        }
+
+        #ifdef X86_SIMD
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+                    __builtin_cpu_supports("bmi")) {
+                        return s_avx2_kernels;
+                }
+                if (__builtin_cpu_supports("sse2")) {
+                        return s_sse2_kernels;
+                }
+        #endif
+
+        return s_scalar_kernels;
+}
+
+void init_char_classes(void)
+{
+        // Programs can be lexed on several threads at once when (min)mod is
+        // embedded, and each of them initializes the classes first.
+        lock_mutex(&s_init_mutex);
+        if (s_initialized) {
+                unlock_mutex(&s_init_mutex);
+                return;
+        }
+
+        for (int ch = 0; ch < 256; ++ch) {
+                // "isspace" takes the value of an "unsigned char".
+                if (isspace(ch)) {
+                        s_classes[ch] = CH_CLASS_WHITESPACE;
+                } else if (is_valid_instr_ch((char) ch)) {
+                        s_classes[ch] = CH_CLASS_INSTR;
+                } else {
+                        s_classes[ch] = CH_CLASS_OTHER;
+                }
+        }
+
+        s_kernels = choose_kernels();
+        s_initialized = true;
+        unlock_mutex(&s_init_mutex);
+
+        LOG_INFO("Classifying characters using %s kernels.\n", s_kernels.name);
+}
+
+const char * skip_whitespace(const char * begin, const char * end, int * newlines)
+{
+        return s_kernels.skip_whitespace(begin, end, newlines);
+}
+
+const char * skip_instr_chs(const char * begin, const char * end)
+{
+        return s_kernels.skip_instr_chs(begin, end);
+}
+
+const char * find_line_end(const char * begin, const char * end)
+{
+        return s_kernels.find_line_end(begin, end);
+}
+
+const char * get_char_class_kernel_name(void)
+{
+        return s_kernels.name;
+}
@@ -0,0 +1,35 @@
+// Classification of source characters, used by the lexer.
+// Runs of whitespace, instruction names and comments are skipped using
+// SIMD instructions when the CPU has them, falling back to table lookups
+// otherwise.
+
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <stdbool.h>
+
+// Must be called before any of the functions below. Calling it more than
+// once does nothing.
+void init_char_classes(void);
+
+bool is_whitespace_ch(char ch);
+
+// Same as "is_valid_instr_ch" in "settings.h", but faster.
+bool is_instr_ch(char ch);
+
+// Returns the first character in ["begin", "end") that isn't whitespace, or
+// "end" if there's none. The number of newlines skipped is added to
+// "*newlines".
+const char * skip_whitespace(const char * begin, const char * end, int * newlines);
+
+// Returns the first character in ["begin", "end") that can't be part of an
+// instruction name, or "end" if there's none.
+const char * skip_instr_chs(const char * begin, const char * end);
+
+// Returns the first newline in ["begin", "end"), or "end" if there's none.
+const char * find_line_end(const char * begin, const char * end);
+
+// The name of the kernels chosen by "init_char_classes", for logging.
+const char * get_char_class_kernel_name(void);
+
+#endif
@@ -0,0 +1,815 @@
+#include "image.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include "source.h"
+#include "../data_types/stack.h"
+#include "../settings.h"
+#include "../tools/hash.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/os.h"
+#include "../tools/platform.h"
+#include "../tools/ptr_map.h"
+#include "../tools/str_map.h"
+
+// Must be increased whenever the layout of images changes, or the meaning
+// of their contents does (such as the IDs of the built-ins).
+#define IMAGE_VERSION 2
+
+// Images are written in the byte order of the machine writing them, so the
+// mark reads differently on machines with another byte order.
+#define IMAGE_BYTE_ORDER_MARK 0x01020304u
+
+static const char s_image_magic[8] = "(m)mimg";
+
+// An image is a header followed by sections of fixed-size records, in the
+// order of the counts in the header, and then the strings the records
+// refer to. Every record is a multiple of 8 bytes, so records are aligned
+// in mapped images.
+struct ImageHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order_mark;
+
+        // A hash of the contents of the files, one after the other.
+        uint64_t closure_hash;
+
+        uint64_t file_count;
+        uint64_t name_count;
+        uint64_t itype_count;
+        uint64_t stack_count;
+        uint64_t elem_count;
+        uint64_t strings_size;
+};
+
+// A file the program was parsed from.
+struct ImageFile {
+        uint64_t path_offset;
+        uint64_t path_length;
+        uint64_t content_length;
+};
+
+// The name interned with the ID equal to the index of the record.
+struct ImageName {
+        uint64_t offset;
+        uint64_t length;
+};
+
+struct ImageIType {
+        // The index of the value of the instruction type, or -1 if it's
+        // uninitialized.
+        int64_t value;
+};
+
+// The elements of a stack are the records from "first_elem" onward,
+// top last, as in "struct Stack".
+struct ImageStack {
+        uint64_t first_elem;
+        uint64_t size;
+        int64_t reference_count;
+};
+
+struct ImageElem {
+        int32_t type;
+        int32_t indirection_level;
+
+        // The instruction ID for "STACK_ELEM_INSTR"s, and the index of the
+        // stack otherwise.
+        int64_t value;
+};
+
+// Where the sections of an image start.
+struct ImageSections {
+        const char * files;
+        const char * names;
+        const char * itypes;
+        const char * stacks;
+        const char * elems;
+        const char * strings;
+};
+
+// Copies record "index" of "section" into "record", since records of
+// memory-mapped images can't be accessed in place without breaking the
+// aliasing rules of C.
+static void read_record(const char * section, size_t index, void * record, size_t record_size)
+{
+        memcpy(record, section + index * record_size, record_size);
+}
+
+char * get_image_path(const char * file_path, const char * cache_dir)
+{
+        if (!cache_dir) {
+                // "program.(m)m" has the image "program.(m)mi".
+                size_t base_length = strlen(file_path);
+                const char * last_dot = strrchr(file_path, '.');
+                if (last_dot && strcmp(last_dot + 1, g_minmod_file_ext) == 0) {
+                        base_length = last_dot - file_path;
+                }
+
+                size_t path_length = base_length + 1 + strlen(g_image_file_ext);
+                char * image_path = ALLOC(char, path_length + 1);
+                snprintf(image_path, path_length + 1, "%.*s.%s",
+                         (int) base_length, file_path, g_image_file_ext);
+                return image_path;
+        }
+
+        // Programs in different directories can have the same name, so
+        // images in the cache directory are named after the whole path.
+        char sep = OS == OS_WINDOWS ? '\\' : '/';
+        unsigned long long path_hash = hash_bytes(file_path, strlen(file_path), HASH_SEED);
+
+        size_t path_length = strlen(cache_dir) + 1 + 16 + 1 + strlen(g_image_file_ext);
+        char * image_path = ALLOC(char, path_length + 1);
+        snprintf(image_path, path_length + 1, "%s%c%016llx.%s",
+                 cache_dir, sep, path_hash, g_image_file_ext);
+        return image_path;
+}
+
+// Gives each stack of a program an index, in the order they're found.
+struct StackIndexer {
+        // "const struct Stack *"s, indexed by their indices.
+        struct List stacks;
+
+        // Maps stacks to their indices.
+        struct PtrMap indices;
+};
+
+static struct StackIndexer create_stack_indexer(void)
+{
+        struct StackIndexer indexer;
+        indexer.stacks = create_list(sizeof(const struct Stack *), NULL);
+        indexer.indices = create_ptr_map();
+
+        return indexer;
+}
+
+static void destroy_stack_indexer(struct StackIndexer * indexer)
+{
+        destroy_ptr_map(&indexer->indices);
+        destroy_list(&indexer->stacks);
+}
+
+static int64_t index_stack(struct StackIndexer * indexer, const struct Stack * stack)
+{
+        size_t index;
+        if (!ptr_map_find(&indexer->indices, stack, &index)) {
+                index = indexer->stacks.length;
+                list_append(&indexer->stacks, &stack);
+                ptr_map_insert(&indexer->indices, stack, index);
+        }
+
+        return (int64_t) index;
+}
+
+static bool write_records(FILE * file, const void * records, size_t record_size, size_t count)
+{
+        return fwrite(records, record_size, count, file) == count;
+}
+
+// Indexes every stack reachable from the instruction types of
+// "itype_list", and returns how many elements the stacks have in total.
+static uint64_t index_stacks(struct StackIndexer * indexer, const struct ITypeList * itype_list)
+{
+        for (size_t i = 0; i < itype_list->itypes.length; ++i) {
+                const struct IType * itype = id_to_itype_const(itype_list, i);
+                if (itype->value) {
+                        (void) index_stack(indexer, itype->value);
+                }
+        }
+
+        // The stacks are indexed as they're found, so walking through them
+        // in order of their indices reaches every stack of the program,
+        // however deeply they're nested.
+        uint64_t elem_count = 0;
+        for (size_t i = 0; i < indexer->stacks.length; ++i) {
+                const struct Stack * stack;
+                stack = *(const struct Stack **) get_list_elem(&indexer->stacks, i);
+
+                elem_count += stack->size;
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_STACK_REF) {
+                                (void) index_stack(indexer, elem->stack_ref);
+                        } else if (elem->type == STACK_ELEM_SUBSTACK) {
+                                (void) index_stack(indexer, elem->substack);
+                        }
+                }
+        }
+
+        return elem_count;
+}
+
+static struct ImageElem stack_elem_to_image_elem(const struct StackElem * elem,
+                                                 struct StackIndexer * indexer)
+{
+        struct ImageElem image_elem;
+        image_elem.type = elem->type;
+        image_elem.indirection_level = elem->indirection_level;
+
+        switch (elem->type) {
+        case STACK_ELEM_INSTR:
+                image_elem.value = elem->instr;
+                break;
+        case STACK_ELEM_STACK_REF:
+                image_elem.value = index_stack(indexer, elem->stack_ref);
+                break;
+        case STACK_ELEM_SUBSTACK:
+                image_elem.value = index_stack(indexer, elem->substack);
+                break;
+        default:
+                ASSERT(false, "Invalid stack element type %d.", (int) elem->type);
+        }
+
+        return image_elem;
+}
+
+// Writes the image of "itype_list" and "sources", which may be "NULL", to
+// "file".
+// Records are written as they're made rather than gathered first, so the
+// only memory needed on top of the program's is the index of its stacks,
+// which is smaller than the stacks themselves. That way, even a program
+// that fills up the memory can be written.
+static bool write_image(FILE * file, const struct ITypeList * itype_list, const struct List * sources)
+{
+        size_t file_count = sources ? sources->length : 0;
+        size_t name_count = str_table_length(&itype_list->names);
+
+        struct ImageHeader header;
+        SET_MEMORY(&header, 0, struct ImageHeader, 1);
+        memcpy(header.magic, s_image_magic, sizeof(header.magic));
+        header.version = IMAGE_VERSION;
+        header.byte_order_mark = IMAGE_BYTE_ORDER_MARK;
+        header.closure_hash = HASH_SEED;
+        header.file_count = file_count;
+        header.name_count = name_count;
+        header.itype_count = itype_list->itypes.length;
+
+        for (size_t i = 0; i < file_count; ++i) {
+                const struct SourceFile * source;
+                source = *(struct SourceFile * const *) get_list_elem_const(sources, i);
+
+                header.strings_size += strlen(source->path);
+                header.closure_hash = hash_bytes(source->contents.data, source->contents.length,
+                                                 header.closure_hash);
+        }
+
+        for (size_t i = 0; i < name_count; ++i) {
+                header.strings_size += strlen(str_table_get(&itype_list->names, i));
+        }
+
+        struct StackIndexer indexer = create_stack_indexer();
+        header.elem_count = index_stacks(&indexer, itype_list);
+        header.stack_count = indexer.stacks.length;
+
+        bool is_written = write_records(file, &header, sizeof(header), 1);
+
+        uint64_t strings_size = 0;
+
+        for (size_t i = 0; i < file_count && is_written; ++i) {
+                const struct SourceFile * source;
+                source = *(struct SourceFile * const *) get_list_elem_const(sources, i);
+
+                struct ImageFile image_file;
+                image_file.path_offset = strings_size;
+                image_file.path_length = strlen(source->path);
+                image_file.content_length = source->contents.length;
+                is_written = write_records(file, &image_file, sizeof(image_file), 1);
+
+                strings_size += image_file.path_length;
+        }
+
+        for (size_t i = 0; i < name_count && is_written; ++i) {
+                struct ImageName name;
+                name.offset = strings_size;
+                name.length = strlen(str_table_get(&itype_list->names, i));
+                is_written = write_records(file, &name, sizeof(name), 1);
+
+                strings_size += name.length;
+        }
+
+        for (size_t i = 0; i < itype_list->itypes.length && is_written; ++i) {
+                const struct IType * itype = id_to_itype_const(itype_list, i);
+
+                struct ImageIType image_itype;
+                image_itype.value = itype->value ? index_stack(&indexer, itype->value) : -1;
+                is_written = write_records(file, &image_itype, sizeof(image_itype), 1);
+        }
+
+        uint64_t first_elem = 0;
+        for (size_t i = 0; i < indexer.stacks.length && is_written; ++i) {
+                const struct Stack * stack;
+                stack = *(const struct Stack **) get_list_elem(&indexer.stacks, i);
+
+                struct ImageStack image_stack;
+                image_stack.first_elem = first_elem;
+                image_stack.size = stack->size;
+                image_stack.reference_count = stack->reference_count;
+                is_written = write_records(file, &image_stack, sizeof(image_stack), 1);
+
+                first_elem += stack->size;
+        }
+
+        for (size_t i = 0; i < indexer.stacks.length && is_written; ++i) {
+                const struct Stack * stack;
+                stack = *(const struct Stack **) get_list_elem(&indexer.stacks, i);
+
+                for (size_t j = 0; j < stack->size && is_written; ++j) {
+                        struct ImageElem image_elem;
+                        image_elem = stack_elem_to_image_elem(&stack->contents[j], &indexer);
+                        is_written = write_records(file, &image_elem, sizeof(image_elem), 1);
+                }
+        }
+
+        destroy_stack_indexer(&indexer);
+
+        for (size_t i = 0; i < file_count && is_written; ++i) {
+                const struct SourceFile * source;
+                source = *(struct SourceFile * const *) get_list_elem_const(sources, i);
+                is_written = write_records(file, source->path, 1, strlen(source->path));
+        }
+
+        for (size_t i = 0; i < name_count && is_written; ++i) {
+                const char * name = str_table_get(&itype_list->names, i);
+                is_written = write_records(file, name, 1, strlen(name));
+        }
+
+        return is_written;
+}
+
+// Writes the image to a temporary file first, so that a program being run
+// at the same time never reads half an image, and a checkpoint interrupted
+// halfway never replaces the last one.
+static bool replace_image_file(const char * image_path,
+                               const struct ITypeList * itype_list,
+                               const struct List * sources)
+{
+        size_t tmp_path_length = strlen(image_path) + strlen(".tmp");
+        char * tmp_path = ALLOC(char, tmp_path_length + 1);
+        snprintf(tmp_path, tmp_path_length + 1, "%s.tmp", image_path);
+
+        bool is_replaced = false;
+
+        FILE * file = fopen(tmp_path, "wb");
+        if (file) {
+                is_replaced = write_image(file, itype_list, sources);
+
+                // Closing the file may be what writes it.
+                if (fclose(file) != 0) {
+                        is_replaced = false;
+                }
+        }
+
+        // Unlike on POSIX systems, files can't be renamed to the names of
+        // existing files on Windows.
+        if (is_replaced && OS == OS_WINDOWS) {
+                (void) remove(image_path);
+        }
+
+        if (is_replaced) {
+                is_replaced = rename(tmp_path, image_path) == 0;
+        }
+
+        if (!is_replaced) {
+                (void) remove(tmp_path);
+        }
+
+        FREE(tmp_path);
+
+        return is_replaced;
+}
+
+bool save_image(const char * image_path,
+                const struct ITypeList * itype_list,
+                const struct List * sources)
+{
+        LOG_INFO("Saving the image \"%s\" ...\n", image_path);
+
+        bool is_saved = replace_image_file(image_path, itype_list, sources);
+        if (!is_saved) {
+                LOG_WARNING("Couldn't save the image \"%s\".\n", image_path);
+        }
+
+        return is_saved;
+}
+
+bool save_checkpoint(const char * checkpoint_path, const struct ITypeList * itype_list)
+{
+        LOG_INFO("Saving the checkpoint \"%s\" ...\n", checkpoint_path);
+
+        bool is_saved = replace_image_file(checkpoint_path, itype_list, NULL);
+        if (!is_saved) {
+                LOG_WARNING("Couldn't save the checkpoint \"%s\".\n", checkpoint_path);
+        }
+
+        return is_saved;
+}
+
+// Moves "*section_end" past a section of "count" records of "record_size"
+// bytes. Returns "false" if the section doesn't end before "limit".
+static bool skip_section(uint64_t count, size_t record_size, uint64_t * section_end, uint64_t limit)
+{
+        if (count > (limit - *section_end) / record_size) {
+                return false;
+        }
+
+        *section_end += count * record_size;
+        return true;
+}
+
+// Reads the header of the image in "contents", and finds its sections.
+// Returns "false" if the image isn't one (min)mod can read.
+static bool read_image_header(const struct FileView * contents,
+                              struct ImageHeader * header,
+                              struct ImageSections * sections)
+{
+        if (contents->length < sizeof(*header)) {
+                return false;
+        }
+        read_record(contents->data, 0, header, sizeof(*header));
+
+        if (memcmp(header->magic, s_image_magic, sizeof(header->magic)) != 0) {
+                return false;
+        }
+        if (header->version != IMAGE_VERSION) {
+                return false;
+        }
+        if (header->byte_order_mark != IMAGE_BYTE_ORDER_MARK) {
+                return false;
+        }
+
+        uint64_t offsets[6];
+        uint64_t section_end = sizeof(*header);
+
+        offsets[0] = section_end;
+        if (!skip_section(header->file_count, sizeof(struct ImageFile), &section_end,
+                          contents->length)) {
+                return false;
+        }
+        offsets[1] = section_end;
+        if (!skip_section(header->name_count, sizeof(struct ImageName), &section_end,
+                          contents->length)) {
+                return false;
+        }
+        offsets[2] = section_end;
+        if (!skip_section(header->itype_count, sizeof(struct ImageIType), &section_end,
+                          contents->length)) {
+                return false;
+        }
+        offsets[3] = section_end;
+        if (!skip_section(header->stack_count, sizeof(struct ImageStack), &section_end,
+                          contents->length)) {
+                return false;
+        }
+        offsets[4] = section_end;
+        if (!skip_section(header->elem_count, sizeof(struct ImageElem), &section_end,
+                          contents->length)) {
+                return false;
+        }
+        offsets[5] = section_end;
+        if (!skip_section(header->strings_size, 1, &section_end, contents->length)) {
+                return false;
+        }
+
+        if (section_end != contents->length) {
+                return false;
+        }
+
+        sections->files = contents->data + offsets[0];
+        sections->names = contents->data + offsets[1];
+        sections->itypes = contents->data + offsets[2];
+        sections->stacks = contents->data + offsets[3];
+        sections->elems = contents->data + offsets[4];
+        sections->strings = contents->data + offsets[5];
+
+        return true;
+}
+
+static bool is_string_in_image(const struct ImageHeader * header, uint64_t offset, uint64_t length)
+{
+        return offset <= header->strings_size && length <= header->strings_size - offset;
+}
+
+// Returns "true" iff the files of the image are the files of the program
+// at "file_path", and they haven't changed since the image was saved.
+static bool is_image_up_to_date(const struct ImageHeader * header,
+                                const struct ImageSections * sections,
+                                const char * file_path)
+{
+        if (header->file_count == 0) {
+                return false;
+        }
+
+        uint64_t closure_hash = HASH_SEED;
+
+        for (size_t i = 0; i < header->file_count; ++i) {
+                struct ImageFile file;
+                read_record(sections->files, i, &file, sizeof(file));
+
+                if (!is_string_in_image(header, file.path_offset, file.path_length)) {
+                        return false;
+                }
+
+                char * path = ALLOC(char, file.path_length + 1);
+                memcpy(path, sections->strings + file.path_offset, file.path_length);
+                path[file.path_length] = '\0';
+
+                // The image could belong to another program with a path
+                // that hashes the same.
+                if (i == 0 && strcmp(path, file_path) != 0) {
+                        FREE(path);
+                        return false;
+                }
+
+                struct FileView contents = try_open_file_view(path);
+                FREE(path);
+
+                if (!is_file_view_valid(&contents)) {
+                        return false;
+                }
+
+                bool is_same_length = contents.length == file.content_length;
+                if (is_same_length) {
+                        closure_hash = hash_bytes(contents.data, contents.length, closure_hash);
+                }
+
+                close_file_view(&contents);
+
+                if (!is_same_length) {
+                        return false;
+                }
+        }
+
+        return closure_hash == header->closure_hash;
+}
+
+// Returns "true" iff interning the names of the image into "names", in
+// order, gives each name the ID equal to its index.
+static bool are_image_names_valid(const struct ImageHeader * header,
+                                  const struct ImageSections * sections,
+                                  const struct StrTable * names)
+{
+        size_t interned_count = str_table_length(names);
+        if (header->name_count < interned_count) {
+                return false;
+        }
+
+        // The names that aren't interned yet, to find duplicates among them.
+        struct StrMap new_names = create_str_map();
+        bool are_valid = true;
+
+        for (size_t i = 0; i < header->name_count && are_valid; ++i) {
+                struct ImageName name;
+                read_record(sections->names, i, &name, sizeof(name));
+
+                if (!is_string_in_image(header, name.offset, name.length)) {
+                        are_valid = false;
+                        break;
+                }
+
+                const char * str = sections->strings + name.offset;
+                if (memchr(str, '\0', name.length)) {
+                        are_valid = false;
+                        break;
+                }
+
+                str_id_t id;
+                size_t new_id;
+                if (i < interned_count) {
+                        const char * interned = str_table_get(names, i);
+                        are_valid = strlen(interned) == name.length &&
+                                    memcmp(interned, str, name.length) == 0;
+                } else if (str_table_find(names, str, name.length, &id) ||
+                           str_map_find(&new_names, str, name.length, &new_id)) {
+                        are_valid = false;
+                } else {
+                        str_map_insert(&new_names, str, name.length, i);
+                }
+        }
+
+        destroy_str_map(&new_names);
+
+        return are_valid;
+}
+
+static bool is_stack_index_valid(const struct ImageHeader * header, int64_t index)
+{
+        return index >= 0 && (uint64_t) index < header->stack_count;
+}
+
+// Returns "true" iff every instruction type, stack and stack element of
+// the image refers to something in the image.
+static bool are_image_stacks_valid(const struct ImageHeader * header,
+                                   const struct ImageSections * sections)
+{
+        // Every name has an instruction type once a program is parsed.
+        if (header->itype_count != header->name_count) {
+                return false;
+        }
+
+        for (size_t i = 0; i < header->itype_count; ++i) {
+                struct ImageIType itype;
+                read_record(sections->itypes, i, &itype, sizeof(itype));
+
+                if (itype.value != -1 && !is_stack_index_valid(header, itype.value)) {
+                        return false;
+                }
+        }
+
+        for (size_t i = 0; i < header->stack_count; ++i) {
+                struct ImageStack stack;
+                read_record(sections->stacks, i, &stack, sizeof(stack));
+
+                if (stack.first_elem > header->elem_count ||
+                    stack.size > header->elem_count - stack.first_elem) {
+                        return false;
+                }
+                if (stack.reference_count < 1 || stack.reference_count > INT_MAX) {
+                        return false;
+                }
+        }
+
+        for (size_t i = 0; i < header->elem_count; ++i) {
+                struct ImageElem elem;
+                read_record(sections->elems, i, &elem, sizeof(elem));
+
+                if (elem.indirection_level < 0) {
+                        return false;
+                }
+
+                switch (elem.type) {
+                case STACK_ELEM_INSTR: {
+                        bool is_builtin_id = elem.value < 0 && elem.value >= -BUILTINS_COUNT;
+                        bool is_itype_id = elem.value >= 0 &&
+                                           (uint64_t) elem.value < header->itype_count;
+                        if (!is_builtin_id && !is_itype_id) {
+                                return false;
+                        }
+                        break;
+                } case STACK_ELEM_STACK_REF:
+                case STACK_ELEM_SUBSTACK: {
+                        if (!is_stack_index_valid(header, elem.value)) {
+                                return false;
+                        }
+                        break;
+                } default: {
+                        return false;
+                }
+                }
+        }
+
+        return true;
+}
+
+// Creates the stacks of the image, turning the indices they refer to each
+// other by back into pointers. The image must be valid.
+static struct List create_image_stacks(const struct ImageHeader * header,
+                                       const struct ImageSections * sections)
+{
+        struct List stacks = create_list(sizeof(struct Stack *), NULL);
+
+        for (size_t i = 0; i < header->stack_count; ++i) {
+                struct ImageStack image_stack;
+                read_record(sections->stacks, i, &image_stack, sizeof(image_stack));
+
+                struct Stack * stack = create_stack_with_capacity(image_stack.size);
+                stack->size = image_stack.size;
+                stack->reference_count = image_stack.reference_count;
+                list_append(&stacks, &stack);
+        }
+
+        // The reference counts are restored as they were, so the elements
+        // are filled in directly rather than pushed.
+        for (size_t i = 0; i < header->stack_count; ++i) {
+                struct ImageStack image_stack;
+                read_record(sections->stacks, i, &image_stack, sizeof(image_stack));
+
+                struct Stack * stack = *(struct Stack **) get_list_elem(&stacks, i);
+
+                for (size_t j = 0; j < image_stack.size; ++j) {
+                        struct ImageElem image_elem;
+                        read_record(sections->elems, image_stack.first_elem + j,
+                                    &image_elem, sizeof(image_elem));
+
+                        struct StackElem * elem = &stack->contents[j];
+                        elem->type = image_elem.type;
+                        elem->indirection_level = image_elem.indirection_level;
+                        elem->is_verified = false;
+
+                        if (image_elem.type == STACK_ELEM_INSTR) {
+                                elem->instr = (instr_id_t) image_elem.value;
+                        } else {
+                                struct Stack * target;
+                                target = *(struct Stack **) get_list_elem(&stacks,
+                                                                          image_elem.value);
+                                if (image_elem.type == STACK_ELEM_SUBSTACK) {
+                                        elem->substack = target;
+                                } else {
+                                        elem->stack_ref = target;
+                                }
+                        }
+                }
+        }
+
+        return stacks;
+}
+
+// Reads the program of the image into "itype_list". The image must be
+// valid.
+static void read_image_program(const struct ImageHeader * header,
+                               const struct ImageSections * sections,
+                               struct ITypeList * itype_list)
+{
+        for (size_t i = 0; i < header->name_count; ++i) {
+                struct ImageName name;
+                read_record(sections->names, i, &name, sizeof(name));
+                intern_str(&itype_list->names, sections->strings + name.offset, name.length);
+        }
+        add_interned_itypes(itype_list);
+
+        struct List stacks = create_image_stacks(header, sections);
+
+        for (size_t i = 0; i < header->itype_count; ++i) {
+                struct ImageIType image_itype;
+                read_record(sections->itypes, i, &image_itype, sizeof(image_itype));
+
+                if (image_itype.value != -1) {
+                        struct IType * itype = id_to_itype(itype_list, i);
+                        itype->value = *(struct Stack **) get_list_elem(&stacks,
+                                                                        image_itype.value);
+                }
+        }
+
+        destroy_list(&stacks);
+}
+
+bool load_image(const char * image_path, const char * file_path, struct ITypeList * itype_list)
+{
+        ASSERT(itype_list->itypes.length == str_table_length(&itype_list->names),
+               "Images can only be loaded into new instruction type lists.");
+
+        struct FileView contents = try_open_file_view(image_path);
+        if (!is_file_view_valid(&contents)) {
+                LOG_INFO("There's no image \"%s\".\n", image_path);
+                return false;
+        }
+
+        LOG_INFO("Loading the image \"%s\" ...\n", image_path);
+
+        struct ImageHeader header;
+        struct ImageSections sections;
+
+        // Everything is checked before "itype_list" is changed, so that the
+        // program can still be lexed and parsed into it if anything's wrong.
+        if (!read_image_header(&contents, &header, &sections) ||
+            !are_image_names_valid(&header, &sections, &itype_list->names) ||
+            !are_image_stacks_valid(&header, &sections)) {
+                LOG_INFO("\"%s\" isn't a valid image.\n", image_path);
+                close_file_view(&contents);
+                return false;
+        }
+
+        if (!is_image_up_to_date(&header, &sections, file_path)) {
+                LOG_INFO("\"%s\" is out of date.\n", image_path);
+                close_file_view(&contents);
+                return false;
+        }
+
+        read_image_program(&header, &sections, itype_list);
+        close_file_view(&contents);
+
+        return true;
+}
+
+bool load_checkpoint(const char * checkpoint_path, struct ITypeList * itype_list)
+{
+        ASSERT(itype_list->itypes.length == str_table_length(&itype_list->names),
+               "Checkpoints can only be loaded into new instruction type lists.");
+
+        struct FileView contents = open_file_view(checkpoint_path);
+        if (!is_file_view_valid(&contents)) {
+                return false;
+        }
+
+        LOG_INFO("Loading the checkpoint \"%s\" ...\n", checkpoint_path);
+
+        struct ImageHeader header;
+        struct ImageSections sections;
+
+        // Whether the files of the program changed since doesn't matter, as
+        // the program is resumed as it was rather than parsed again.
+        if (!read_image_header(&contents, &header, &sections) ||
+            !are_image_names_valid(&header, &sections, &itype_list->names) ||
+            !are_image_stacks_valid(&header, &sections)) {
+                LOG_ERROR("\"%s\" isn't a valid checkpoint.\n", checkpoint_path);
+                close_file_view(&contents);
+                return false;
+        }
+
+        read_image_program(&header, &sections, itype_list);
+        close_file_view(&contents);
+
+        return true;
+}
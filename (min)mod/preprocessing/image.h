@@ -0,0 +1,49 @@
+// Images of parsed programs, cached on disk so that a program doesn't have
+// to be lexed and parsed again until one of its files changes.
+// An image contains the instruction types and the stacks of a program, with
+// stacks referring to each other by index rather than by pointer, and the
+// path and a hash of the contents of every file the program was parsed from.
+// Checkpoints of running programs are images too, of the instruction types
+// and stacks as they are at some step, without any files.
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include "../tools/list.h"
+#include "../data_types/itype.h"
+
+// Returns the path of the image of the program at "file_path". The image is
+// next to the program if "cache_dir" is "NULL", and in "cache_dir"
+// otherwise. The returned path is "ALLOC"ed.
+char * get_image_path(const char * file_path, const char * cache_dir);
+
+// Writes the parsed program in "itype_list" to "image_path". "sources" are
+// the "struct SourceFile *"s the program was parsed from, the first one
+// being the program itself.
+// Returns "false" if the image can't be written, in which case nothing is
+// written at all.
+bool save_image(const char * image_path,
+                const struct ITypeList * itype_list,
+                const struct List * sources);
+
+// Reads the program at "file_path" into "itype_list" from the image at
+// "image_path". "itype_list" must come straight from "create_itype_list".
+// Returns "false" without changing "itype_list" if there's no image, or if
+// it's out of date, corrupted or from another version of (min)mod.
+bool load_image(const char * image_path, const char * file_path, struct ITypeList * itype_list);
+
+// Writes the program in "itype_list", as it is between two steps, to
+// "checkpoint_path", keeping how stacks are shared and their reference
+// counts, so that it can be resumed exactly where it was.
+// Returns "false" if the checkpoint can't be written, in which case the
+// previous checkpoint at "checkpoint_path", if any, is kept.
+bool save_checkpoint(const char * checkpoint_path, const struct ITypeList * itype_list);
+
+// Reads the program saved at "checkpoint_path" into "itype_list", which
+// must come straight from "create_itype_list". Images of parsed programs
+// can be loaded as well, resuming the program from its first step.
+// Returns "false", after logging why, if the checkpoint can't be read.
+bool load_checkpoint(const char * checkpoint_path, struct ITypeList * itype_list);
+
+#endif
@@ -1,341 +1,1255 @@
-#include <ctype.h>
-#include <string.h>
-#include "../tools/debug.h"
-#include "../settings.h"
-#include "../tools/file_operations.h"
-#include "../tools/list.h"
-#include "token.h"
-#include "../tools/mem_tools.h"
-#include "../data_types/itype.h"
-
-static char * str_between_ptrs(const char * start, const char * end)
-{
-        // + 1 since the range is inclusive.
-        int len = end - start + 1;
-
-        char * new_str = ALLOC(char, len + 1);
-        strncpy(new_str, start, len);
-        new_str[len] = '\0';
-
-        return new_str;
-}
-
-// Not beautiful, but it gets the job done :D
-// Makes "*iterator" skip past the current token, incrementing "*line"
-// if newlines are found.
-// Returns the current token (the one "*iterator" skips past).
-static struct Token scan_token(const char ** iterator, const char * file, int * line)
-{
-        // Match **iterator against a bunch of different tokens ...
-        if (**iterator == g_import_open_ch) {
-
-                const char * import_open = *iterator;
-
-                do {
-                        ++*iterator;
-
-                        ASSERT_OR_HANDLE(**iterator && **iterator != '\n', create_invalid_token(),
-                                         "Unclosed \"%c\" in line %d.",
-                                         *import_open, *line);
-                } while (**iterator != g_import_close_ch);
-                ++*iterator;
-
-                const char * import_close = *iterator - 1;
-
-                char * fname = str_between_ptrs(import_open + 1, import_close - 1);
-
-                struct Token token = create_token(TOK_IMPORT, file, *line);
-                token.import_file = fname;
-
-                return token;
-
-        } else if (**iterator == g_stack_open_ch) {
-                ++*iterator;
-                return create_token(TOK_STACK_OPEN, file, *line);
-
-        } else if (**iterator == g_stack_close_ch) {
-                ++*iterator;
-                return create_token(TOK_STACK_CLOSE, file, *line);
-
-        } else if (**iterator == g_indirection_ch) {
-                int indirection_level = 0;
-                while (**iterator == g_indirection_ch) {
-                        ++*iterator;
-                        ++indirection_level;
-                }
-
-                struct Token token = create_token(TOK_INDIRECTION, file, *line);
-                token.indirection_level = indirection_level;
-
-                return token;
-
-        } else if (isspace(**iterator)) {
-                while (isspace(**iterator)) {
-                        if (**iterator == '\n') {
-                                ++*line;
-                        }
-                        ++*iterator;
-                }
-                return create_token(TOK_WHITESPACE, file, *line);
-
-        } else if (strncmp(*iterator, g_comment_str, strlen(g_comment_str)) == 0) {
-                while (**iterator && **iterator != '\n') {
-                        ++*iterator;
-                }
-                return create_token(TOK_COMMENT, file, *line);
-        }
-
-        // If this point is reached, "iterator" has been matched against all
-        // the fun tokens, and the only possibility left is plain, boring
-        // "TOK_INSTR".
-
-        ASSERT_OR_HANDLE(is_valid_instr_ch(**iterator), create_invalid_token(),
-                         "Invalid character \"%c\" in line %d.", **iterator, *line);
-
-        const char * instr_start = *iterator;
-
-        while (is_valid_instr_ch(**iterator)) {
-                ++*iterator;
-        }
-        int instr_length = *iterator - instr_start;
-
-        char * instr_name = ALLOC(char, instr_length + 1);
-        strncpy(instr_name, instr_start, instr_length);
-        instr_name[instr_length] = '\0';
-
-        struct Token token = create_token(TOK_INSTR, file, *line);
-        token.instr_name = instr_name;
-
-        return token;
-}
-
-// Remove all tokens in "token_list" of type "type".
-static void remove_tokens_of_type(struct List * token_list, enum TokenType type)
-{
-        LOG_INFO("Removing all %s tokens from " LIST_FS " ...\n",
-                 token_type_as_string(type),
-                 LIST_FA(*token_list));
-
-        for (size_t i = 0; i < token_list->length; ++i) {
-
-                const struct Token * curr_tok = get_list_elem_const(token_list, i);
-                if (curr_tok->type == type) {
-                        list_remove(token_list, i);
-                        --i;
-                }
-        }
-}
-
-// Lexes "string".
-static struct List string_to_tokens(const char * string, const char * fname)
-{
-        LOG_INFO("Converting string to list of tokens ...\n");
-
-        struct List token_list = create_list(sizeof(struct Token), destroy_token_void_ptr);
-        const char * iterator = string;
-        int line = 1;
-
-        while (*iterator) {
-                struct Token curr_tok = scan_token(&iterator, fname, &line);
-                if (curr_tok.type == TOK_INVALID) {
-                        return create_invalid_list();
-                }
-                list_append(&token_list, &curr_tok);
-        }
-
-        return token_list;
-};
-
-// Returns "true" iff the "TOK_STACK_OPEN"s and "TOK_STACK_CLOSE"s are balanced.
-// Assumes all tokens in "tokens" belong to the same file.
-static bool are_parens_balanced(const struct List * tokens)
-{
-        int nesting_level = 0;
-        for (int i = 0; i < tokens->length; ++i) {
-                const struct Token * curr_tok = get_list_elem_const(tokens, i);
-
-                if (curr_tok->type == TOK_STACK_OPEN) {
-                        ++nesting_level;
-                } else if (curr_tok->type == TOK_STACK_CLOSE) {
-                        --nesting_level;
-                }
-
-                ASSERT_OR_HANDLE(nesting_level >= 0,
-                                "Unexpected %s in \"%s\", line %d.", false,
-                                token_type_as_string(curr_tok->type),
-                                curr_tok->file, curr_tok->line);
-        }
-        ASSERT_OR_HANDLE(nesting_level == 0, false,
-                         "Unclosed %s.", token_type_as_string(TOK_STACK_OPEN));
-
-        return true;
-}
-
-static bool str_in_list(const struct List * str_list, const char * str)
-{
-        for (int i = 0; i < str_list->length; ++i) {
-                const char * curr_elem = get_list_elem_const(str_list, i);
-                if (strcmp(str, curr_elem) == 0) {
-                        return true;
-                }
-        }
-        return false;
-}
-
-static struct List tokenize_file(char * file_path, struct List * tokenized_files);
-
-// Like "strdup", but it uses the "ALLOC" macro rather than "malloc".
-static char * duplicate_str(const char * str)
-{
-        char * new_str = ALLOC(char, strlen(str) + 1);
-        strcpy(new_str, str);
-        return new_str;
-}
-
-static char * get_nth_parent_dir(const char * fpath, int parent_count)
-{
-        char * curr_parent = duplicate_str(fpath);
-        for (int i = 0; i < parent_count; ++i) {
-                char * next_parent = get_parent_dir(curr_parent);
-
-                ASSERT_OR_HANDLE(next_parent, NULL,
-                                 "\"%s\" has no parent directory.", curr_parent);
-
-                FREE(curr_parent);
-                curr_parent = next_parent;
-        }
-
-        return curr_parent;
-}
-
-static char * get_abs_import_path(const char * fpath, const char * import)
-{
-        if (import[0] != '.') {
-                return duplicate_str(import);
-        }
-
-        int parent_count = 0;
-        for (int i = 0; import[i] == '.'; ++i) {
-                ++parent_count;
-        }
-
-        const char * child_path = import + parent_count;
-        char * parent_path = get_nth_parent_dir(fpath, parent_count);
-
-        char * abs_path = ALLOC(char, strlen(parent_path) + strlen(child_path) + 1);
-        abs_path[0] = '\0';
-
-        strcat(abs_path, parent_path);
-        strcat(abs_path, child_path);
-
-        FREE(parent_path);
-
-        return abs_path;
-}
-
-// Returns "true" iff there's no errors.
-static bool evaluate_imports(struct List * tokens, struct List * tokenized_files)
-{
-        for (int i = 0; i < tokens->length; ++i) {
-                const struct Token * curr_tok = get_list_elem_const(tokens, i);
-                if (curr_tok->type != TOK_IMPORT) {
-                        continue;
-                }
-
-                char * abs_import_path = get_abs_import_path(curr_tok->file, curr_tok->import_file);
-
-                if (str_in_list(tokenized_files, abs_import_path)) {
-                        continue;
-                }
-
-                struct List import_tokens = tokenize_file(abs_import_path, tokenized_files);
-
-                ASSERT_OR_HANDLE(list_is_valid(&import_tokens), false,
-                                 "Unable to tokenize \"%s\".", abs_import_path);
-
-                list_remove(tokens, i);
-                list_insert_list(tokens, i, &import_tokens);
-
-                // Since the import token is now removed, we must stay at the same
-                // index one more iteration to start form the beginning of the
-                // new tokens. Therefore, we decrement "i" before incrementing it
-                // when we start the next iteration.
-                // One's not really supposed to mess with the loop index, but making
-                // this a while loop only seemed to add more clutter since "i"
-                // wouldn't be incremented when using "continue".
-                --i;
-        }
-
-        return true;
-}
-
-// Converts "file_path" to a list of tokens. Additionally, it recursively
-// tokenizes any file included by "file_path" and pastes them into wherever
-// the files were included.
-static struct List tokenize_file(char * file_path, struct List * tokenized_files)
-{
-        LOG_INFO("Tokenizing \"%s\" ...\n", file_path);
-
-        list_append(tokenized_files, &file_path);
-
-        const char * file_ext = get_file_ext(file_path);
-
-        ASSERT_OR_HANDLE(file_ext, create_invalid_list(),
-                         "Cannot lex file \"%s\", as it has no extension.", file_path);
-
-        ASSERT_OR_HANDLE(strcmp(file_ext, g_minmod_file_ext) == 0, create_invalid_list(),
-                         "(min)mod files must have extension \"%s\", "
-                         "but \"%s\" has extension \"%s\".",
-                         g_minmod_file_ext, file_path, file_ext);
-
-        const char * file_contents = file_to_string(file_path);
-
-        ASSERT_OR_HANDLE(file_contents, create_invalid_list(),
-                         "Unable to extract the contents of \"%s\".", file_path);
-
-        LOG_DEBUG("\"%s\":\n\"%s\"\n\n", file_path, file_contents);
-
-        struct List token_list = string_to_tokens(file_contents, file_path);
-        if (!list_is_valid(&token_list)) {
-                return create_invalid_list();
-        }
-
-        remove_tokens_of_type(&token_list, TOK_WHITESPACE);
-        remove_tokens_of_type(&token_list, TOK_COMMENT);
-
-        ASSERT_OR_HANDLE(are_parens_balanced(&token_list), create_invalid_list(),
-                         "Unbalanced parentheses in \"%s\".", file_path);
-
-        bool imports_ok = evaluate_imports(&token_list, tokenized_files);
-
-        ASSERT_OR_HANDLE(imports_ok, create_invalid_list(),
-                         "Unable to evaluate the imports of \"%s\".", file_path);
-
-        LOG_DEBUG("Tokens in \"%s\":\n", file_path);
-        log_token_list(LOG_LVL_DEBUG, &token_list);
-        LOG_DEBUG("\n\n");
-
-        return token_list;
-}
-
-static void free_str(void * str)
-{
-        FREE(*(char **) str);
-}
-
-struct List lex(const char * file_path)
-{
-        LOG_INFO("Lexing \"%s\" ...\n", file_path);
-
-        struct List tokenized_files = create_list(sizeof(char *), free_str);
-
-        // "tokenize_file" expects an "ALLOC"ed file path that will be freed
-        // when "destroy_list" is called, and we want "lex" to be polite enough
-        // to not "FREE" its argument. Therefore, we copy the argument.
-        char * file_path_cpy = duplicate_str(file_path);
-        struct List token_list = tokenize_file(file_path_cpy, &tokenized_files);
-
-        destroy_list(&tokenized_files);
-
-        return token_list;
-}
+#include <string.h>
+#include "lexing.h"
+#include "char_class.h"
+#include "../tools/debug.h"
+#include "../settings.h"
+#include "../tools/file_operations.h"
+#include "../tools/list.h"
+#include "token.h"
+#include "../tools/mem_tools.h"
+#include "../data_types/itype.h"
+
+// Files smaller than this are lexed on the main thread even if there's a
+// thread pool, since splitting them up isn't worth it.
+#define MIN_PARALLEL_LEX_SIZE (2 * LEX_CHUNK_SIZE)
+
+// The approximate size of the parts large files are split into, in bytes.
+// Chunks end at the first newline after this many bytes.
+#define LEX_CHUNK_SIZE (1 << 20)
+
+// The number of chunks being lexed ahead of the parser for each thread in
+// the pool. Memory use is limited to that many chunks of tokens per file.
+#define LEX_CHUNKS_PER_THREAD 2
+
+// A part of a source file lexed by a thread pool. No token can span a
+// newline, so the chunks can be lexed independently as long as they're
+// split at newlines.
+struct LexedChunk {
+        struct Task task;
+
+        const struct SourceFile * source;
+        const char * begin;
+        const char * end;
+
+        // The "line" of each token counts the newlines from "begin" to the
+        // token, and the names of "TOK_INSTR"s are in "name" rather than
+        // interned.
+        struct TokenBuffer tokens;
+
+        // Where lexing stopped. It's "end" unless there's a token that can't
+        // be lexed without reporting an error, in which case it's the
+        // beginning of that token.
+        const char * stop;
+
+        // The number of newlines from "begin" to "stop".
+        int newline_count;
+
+        // Starts loading the files imported in the chunk, unless it's "NULL".
+        struct Prefetcher * prefetcher;
+
+        // Whether the chunk is a whole file kept by a "struct TokenCache",
+        // lexed by the calling thread. Lexers only read such chunks, rather
+        // than waiting for them and destroying them.
+        bool is_cached;
+};
+
+// A file imported somewhere, loaded and lexed by the thread pool before the
+// main thread gets to the import.
+struct PrefetchedFile {
+        // Loads the file, then submits another task lexing it.
+        struct Task task;
+        struct Prefetcher * prefetcher;
+
+        // Owned by "source" once it's loaded.
+        char * path;
+
+        // "NULL" if the file can't be loaded, in which case the main thread
+        // tries again, so that the error is reported.
+        struct SourceFile * source;
+
+        // The whole file. "NULL" if the file is large enough to be split into
+        // chunks when it's spliced in, like any other large file.
+        struct LexedChunk * chunk;
+
+        // Whether "source" and "chunk" are handed over to a "struct TokenIter".
+        bool is_spliced;
+};
+
+// Keeps track of every file imported by the files being lexed, so that they
+// can be loaded concurrently, each file only once.
+struct Prefetcher {
+        struct ThreadPool * pool;
+
+        // Must be locked to use "files" and "indices".
+        struct Mutex mutex;
+
+        // "struct PrefetchedFile *"s, in the order their imports were found.
+        // That order depends on the threads, but it's only used to find files,
+        // never to decide the order they're spliced in.
+        struct List files;
+
+        // Maps the paths of "files" to their indices.
+        struct StrMap indices;
+};
+
+// A file kept lexed by a "struct TokenCache" until it changes.
+struct CachedFile {
+        char * path;
+
+        // What the file was like when it was loaded. Only valid if
+        // "has_stamp", which it isn't if the file doesn't exist.
+        struct FileStamp stamp;
+        bool has_stamp;
+
+        // "NULL" if the file can't be loaded. The file is still cached, so that
+        // it's noticed once it can be.
+        struct SourceFile * source;
+        struct LexedChunk * chunk;
+
+        // The paths ("char *"s) of the files imported by the file, as far as
+        // they can be found without reporting errors. These are the edges of
+        // the import graph.
+        struct List imports;
+};
+
+struct TokenCache {
+        // "struct CachedFile *"s, in the order they're imported in.
+        struct List files;
+
+        // Maps the paths of "files" to their indices.
+        struct StrMap indices;
+};
+
+static struct Lexer create_lexer(const struct SourceFile * source)
+{
+        struct Lexer lexer;
+        lexer.source = source;
+        lexer.iterator = source->contents.data;
+        lexer.end = lexer.iterator + source->contents.length;
+        lexer.line = 1;
+        lexer.nesting_level = 0;
+        lexer.pool = NULL;
+        lexer.prefetcher = NULL;
+        lexer.chunks = create_invalid_list();
+        lexer.chunk_reader = create_token_buffer_reader();
+
+        return lexer;
+}
+
+// Makes "*iterator" skip past any whitespace and comments, incrementing
+// "*line" if newlines are found.
+static void skip_whitespace_and_comments(const char ** iterator, const char * end, int * line)
+{
+        size_t comment_str_len = strlen(g_comment_str);
+
+        while (*iterator < end) {
+                if (is_whitespace_ch(**iterator)) {
+                        *iterator = skip_whitespace(*iterator, end, line);
+
+                } else if ((size_t) (end - *iterator) >= comment_str_len &&
+                           strncmp(*iterator, g_comment_str, comment_str_len) == 0) {
+                        // The newline ending the comment is skipped as whitespace.
+                        *iterator = find_line_end(*iterator, end);
+
+                } else {
+                        return;
+                }
+        }
+}
+
+// Not beautiful, but it gets the job done :D
+// Makes "*iterator", which must be at the beginning of a token, skip past
+// the token and stores it in "token".
+// Nothing is copied out of the source file; the token refers to its
+// contents instead. That includes instruction names, which are stored in
+// "token->name" rather than interned.
+// Returns "false" if the token is invalid, without reporting any errors or
+// moving "*iterator", so that it's safe to call from any thread.
+static bool scan_raw_token(const struct SourceFile * source, const char ** iterator,
+                           const char * end, int line, struct Token * token)
+{
+        // Match **iterator against a bunch of different tokens ...
+        if (**iterator == g_import_open_ch) {
+
+                const char * import_open = *iterator;
+                const char * import_close = import_open + 1;
+
+                while (import_close < end && *import_close != g_import_close_ch) {
+                        if (*import_close == '\n') {
+                                return false;
+                        }
+                        ++import_close;
+                }
+                if (import_close == end) {
+                        return false;
+                }
+                *iterator = import_close + 1;
+
+                *token = create_token(TOK_IMPORT, source, line);
+                token->import_path.offset = import_open + 1 - source->contents.data;
+                token->import_path.length = import_close - (import_open + 1);
+
+                return true;
+
+        } else if (**iterator == g_stack_open_ch) {
+                ++*iterator;
+                *token = create_token(TOK_STACK_OPEN, source, line);
+                return true;
+
+        } else if (**iterator == g_stack_close_ch) {
+                ++*iterator;
+                *token = create_token(TOK_STACK_CLOSE, source, line);
+                return true;
+
+        } else if (**iterator == g_indirection_ch) {
+                int indirection_level = 0;
+                while (*iterator < end && **iterator == g_indirection_ch) {
+                        ++*iterator;
+                        ++indirection_level;
+                }
+
+                *token = create_token(TOK_INDIRECTION, source, line);
+                token->indirection_level = indirection_level;
+
+                return true;
+        }
+
+        // If this point is reached, "iterator" has been matched against all
+        // the fun tokens, and the only possibility left is plain, boring
+        // "TOK_INSTR".
+
+        if (!is_instr_ch(**iterator)) {
+                return false;
+        }
+
+        const char * instr_start = *iterator;
+        *iterator = skip_instr_chs(*iterator, end);
+
+        *token = create_token(TOK_INSTR, source, line);
+        token->name.offset = instr_start - source->contents.data;
+        token->name.length = *iterator - instr_start;
+
+        return true;
+}
+
+// Does what "scan_raw_token" can't do for a token in the file read by
+// "lexer": interning instruction names in "names" and making sure
+// parentheses are balanced.
+// Returns "token", or an invalid token if it's unbalanced.
+static struct Token finish_token(struct Lexer * lexer, struct Token token, struct StrTable * names)
+{
+        switch (token.type) {
+        case TOK_INSTR: {
+                struct SourceSlice name = token.name;
+                token.name_id = intern_str(names, get_slice_start(token.source, name), name.length);
+                break;
+
+        } case TOK_STACK_OPEN: {
+                ++lexer->nesting_level;
+                break;
+
+        } case TOK_STACK_CLOSE: {
+                --lexer->nesting_level;
+
+                ASSERT_OR_HANDLE(lexer->nesting_level >= 0, create_invalid_token(),
+                                 "Unexpected %s in \"%s\", line %d.",
+                                 token_type_as_string(TOK_STACK_CLOSE),
+                                 lexer->source->path, token.line);
+                break;
+
+        } default: {
+                break;
+        }
+        }
+
+        return token;
+}
+
+// Like "strdup", but it uses the "ALLOC" macro rather than "malloc".
+static char * duplicate_str(const char * str)
+{
+        char * new_str = ALLOC(char, strlen(str) + 1);
+        strcpy(new_str, str);
+        return new_str;
+}
+
+static char * get_nth_parent_dir(const char * fpath, int parent_count)
+{
+        char * curr_parent = duplicate_str(fpath);
+        for (int i = 0; i < parent_count; ++i) {
+                char * next_parent = get_parent_dir(curr_parent);
+
+                ASSERT_OR_HANDLE(next_parent, NULL,
+                                 "\"%s\" has no parent directory.", curr_parent);
+
+                FREE(curr_parent);
+                curr_parent = next_parent;
+        }
+
+        return curr_parent;
+}
+
+// "import" is the first "import_length" characters of an import path, as
+// written in "fpath". It doesn't have to be null-terminated.
+static char * get_abs_import_path(const char * fpath, const char * import, size_t import_length)
+{
+        size_t parent_count = 0;
+        while (parent_count < import_length && import[parent_count] == '.') {
+                ++parent_count;
+        }
+
+        const char * child_path = import + parent_count;
+        size_t child_length = import_length - parent_count;
+
+        char * parent_path = NULL;
+        size_t parent_length = 0;
+        if (parent_count > 0) {
+                parent_path = get_nth_parent_dir(fpath, parent_count);
+                if (!parent_path) {
+                        return NULL;
+                }
+                parent_length = strlen(parent_path);
+        }
+
+        // Paths without parents have nothing to copy, which "memcpy" can't
+        // be told with "NULL".
+        char * abs_path = ALLOC(char, parent_length + child_length + 1);
+        if (parent_path) {
+                memcpy(abs_path, parent_path, parent_length);
+        }
+        memcpy(abs_path + parent_length, child_path, child_length);
+        abs_path[parent_length + child_length] = '\0';
+
+        FREE(parent_path);
+
+        return abs_path;
+}
+
+static bool has_minmod_file_ext(const char * path)
+{
+        const char * last_dot = strrchr(path, '.');
+        return last_dot && strcmp(last_dot + 1, g_minmod_file_ext) == 0;
+}
+
+static struct LexedChunk * create_lexed_chunk(const struct SourceFile * source,
+                                              const char * begin, const char * end,
+                                              struct Prefetcher * prefetcher);
+
+static void lex_prefetched_file(void * arg)
+{
+        struct PrefetchedFile * file = arg;
+
+        file->source = try_load_source_file(file->path);
+        if (!file->source) {
+                return;
+        }
+
+        const struct FileView * contents = &file->source->contents;
+        if (contents->length < MIN_PARALLEL_LEX_SIZE) {
+                file->chunk = create_lexed_chunk(file->source, contents->data,
+                                                 contents->data + contents->length,
+                                                 file->prefetcher);
+                submit_task(file->prefetcher->pool, &file->chunk->task);
+        }
+}
+
+// Makes the thread pool load and lex the file at "path", unless it's done
+// already. "path" must be "ALLOC"ed, and is owned by the prefetcher.
+static void prefetch_file(struct Prefetcher * prefetcher, char * path)
+{
+        lock_mutex(&prefetcher->mutex);
+
+        size_t index;
+        if (str_map_find(&prefetcher->indices, path, strlen(path), &index)) {
+                unlock_mutex(&prefetcher->mutex);
+                FREE(path);
+                return;
+        }
+
+        struct PrefetchedFile * file = ALLOC(struct PrefetchedFile, 1);
+        file->task = create_task(lex_prefetched_file, file);
+        file->prefetcher = prefetcher;
+        file->path = path;
+        file->source = NULL;
+        file->chunk = NULL;
+        file->is_spliced = false;
+
+        str_map_insert(&prefetcher->indices, path, strlen(path), prefetcher->files.length);
+        list_append(&prefetcher->files, &file);
+
+        submit_task(prefetcher->pool, &file->task);
+
+        unlock_mutex(&prefetcher->mutex);
+}
+
+// Returns the path of the file imported by "import_tok", or "NULL" if it
+// can't be found without reporting errors. The path is "ALLOC"ed.
+static char * try_get_import_path(const struct Token * import_tok)
+{
+        const char * import = get_slice_start(import_tok->source, import_tok->import_path);
+        size_t import_length = import_tok->import_path.length;
+
+        size_t parent_count = 0;
+        while (parent_count < import_length && import[parent_count] == '.') {
+                ++parent_count;
+        }
+        if (parent_count > (size_t) count_parent_dirs(import_tok->source->path)) {
+                return NULL;
+        }
+
+        char * path = get_abs_import_path(import_tok->source->path, import, import_length);
+        if (!has_minmod_file_ext(path)) {
+                FREE(path);
+                return NULL;
+        }
+
+        return path;
+}
+
+// Prefetches the file imported by "import_tok", if that can be done
+// without reporting errors. Otherwise, the main thread reports them once it
+// gets to the import.
+static void prefetch_import(struct Prefetcher * prefetcher, const struct Token * import_tok)
+{
+        char * path = try_get_import_path(import_tok);
+        if (path) {
+                prefetch_file(prefetcher, path);
+        }
+}
+
+// Returns the prefetched file at "path" once it's loaded and its chunk, if
+// any, is submitted, or "NULL" if it's not prefetched.
+static struct PrefetchedFile * wait_for_prefetched_file(struct Prefetcher * prefetcher,
+                                                        const char * path)
+{
+        lock_mutex(&prefetcher->mutex);
+
+        struct PrefetchedFile * file = NULL;
+        size_t index;
+        if (str_map_find(&prefetcher->indices, path, strlen(path), &index)) {
+                file = *(struct PrefetchedFile **) get_list_elem(&prefetcher->files, index);
+        }
+
+        unlock_mutex(&prefetcher->mutex);
+
+        if (file) {
+                wait_for_task(prefetcher->pool, &file->task);
+        }
+        return file;
+}
+
+static struct Prefetcher * create_prefetcher(struct ThreadPool * pool)
+{
+        struct Prefetcher * prefetcher = ALLOC(struct Prefetcher, 1);
+        prefetcher->pool = pool;
+        create_mutex(&prefetcher->mutex);
+        prefetcher->files = create_list(sizeof(struct PrefetchedFile *), NULL);
+        prefetcher->indices = create_str_map();
+
+        return prefetcher;
+}
+
+static void destroy_lexed_chunk(struct LexedChunk * chunk);
+
+// Waits for the thread pool to finish prefetching, and destroys the files
+// that aren't spliced in.
+static void destroy_prefetcher(struct Prefetcher * prefetcher)
+{
+        // Lexing a file might prefetch more files, so the length is checked
+        // after every file.
+        for (size_t i = 0; true; ++i) {
+                lock_mutex(&prefetcher->mutex);
+                bool is_done = i == prefetcher->files.length;
+                struct PrefetchedFile * file = NULL;
+                if (!is_done) {
+                        file = *(struct PrefetchedFile **) get_list_elem(&prefetcher->files, i);
+                }
+                unlock_mutex(&prefetcher->mutex);
+
+                if (is_done) {
+                        break;
+                }
+
+                wait_for_task(prefetcher->pool, &file->task);
+
+                // The chunks of spliced files are waited for by their lexers.
+                if (!file->is_spliced && file->chunk) {
+                        wait_for_task(prefetcher->pool, &file->chunk->task);
+                }
+        }
+
+        // Nothing is prefetched anymore, so the paths (the keys of "indices")
+        // can be freed.
+        for (size_t i = 0; i < prefetcher->files.length; ++i) {
+                struct PrefetchedFile * file;
+                file = *(struct PrefetchedFile **) get_list_elem(&prefetcher->files, i);
+
+                if (!file->is_spliced) {
+                        if (file->chunk) {
+                                destroy_lexed_chunk(file->chunk);
+                        }
+                        if (file->source) {
+                                destroy_source_file(file->source);
+                        } else {
+                                FREE(file->path);
+                        }
+                }
+                FREE(file);
+        }
+
+        destroy_str_map(&prefetcher->indices);
+        destroy_list(&prefetcher->files);
+        destroy_mutex(&prefetcher->mutex);
+        FREE(prefetcher);
+}
+
+static void lex_chunk(void * arg)
+{
+        struct LexedChunk * chunk = arg;
+
+        const char * iterator = chunk->begin;
+        int line = 0;
+
+        while (true) {
+                skip_whitespace_and_comments(&iterator, chunk->end, &line);
+                if (iterator == chunk->end) {
+                        break;
+                }
+
+                struct Token token;
+                if (!scan_raw_token(chunk->source, &iterator, chunk->end, line, &token)) {
+                        break;
+                }
+                token_buffer_append(&chunk->tokens, &token);
+
+                // Start loading imported files right away, so that they're ready
+                // by the time the parser gets to them.
+                if (token.type == TOK_IMPORT && chunk->prefetcher) {
+                        prefetch_import(chunk->prefetcher, &token);
+                }
+        }
+
+        chunk->stop = iterator;
+        chunk->newline_count = line;
+}
+
+static struct LexedChunk * create_lexed_chunk(const struct SourceFile * source,
+                                              const char * begin, const char * end,
+                                              struct Prefetcher * prefetcher)
+{
+        struct LexedChunk * chunk = ALLOC(struct LexedChunk, 1);
+        chunk->task = create_task(lex_chunk, chunk);
+        chunk->source = source;
+        chunk->begin = begin;
+        chunk->end = end;
+        chunk->tokens = create_token_buffer(source);
+        chunk->stop = begin;
+        chunk->newline_count = 0;
+        chunk->prefetcher = prefetcher;
+        chunk->is_cached = false;
+
+        return chunk;
+}
+
+static void destroy_lexed_chunk(struct LexedChunk * chunk)
+{
+        destroy_token_buffer(&chunk->tokens);
+        FREE(chunk);
+}
+
+static void free_path(void * path)
+{
+        FREE(*(char **) path);
+}
+
+// Loads "file->path" into "file", and lexes it on the calling thread.
+// Errors loading the file are only reported if "report_errors".
+static void load_cached_file(struct CachedFile * file, bool report_errors)
+{
+        // Stamped before loading, so that changes made while loading are
+        // noticed later on.
+        file->has_stamp = get_file_stamp(file->path, &file->stamp);
+
+        char * source_path = duplicate_str(file->path);
+        if (report_errors) {
+                file->source = load_source_file(source_path);
+        } else {
+                file->source = try_load_source_file(source_path);
+                if (!file->source) {
+                        FREE(source_path);
+                }
+        }
+
+        if (!file->source) {
+                return;
+        }
+
+        const struct FileView * contents = &file->source->contents;
+        file->chunk = create_lexed_chunk(file->source, contents->data,
+                                         contents->data + contents->length, NULL);
+        file->chunk->is_cached = true;
+        lex_chunk(file->chunk);
+
+        struct TokenBufferReader reader = create_token_buffer_reader();
+        while (reader.token_index < get_token_buffer_length(&file->chunk->tokens)) {
+                struct Token token = read_token_buffer(&file->chunk->tokens, &reader);
+                if (token.type != TOK_IMPORT) {
+                        continue;
+                }
+
+                char * import_path = try_get_import_path(&token);
+                if (import_path) {
+                        list_append(&file->imports, &import_path);
+                }
+        }
+}
+
+// Forgets what "file" contained, so that it can be loaded again.
+static void unload_cached_file(struct CachedFile * file)
+{
+        if (file->chunk) {
+                destroy_lexed_chunk(file->chunk);
+                file->chunk = NULL;
+        }
+        if (file->source) {
+                destroy_source_file(file->source);
+                file->source = NULL;
+        }
+        list_truncate(&file->imports, 0);
+}
+
+// "path" must be "ALLOC"ed, and is owned by the returned file.
+static struct CachedFile * create_cached_file(char * path, bool report_errors)
+{
+        struct CachedFile * file = ALLOC(struct CachedFile, 1);
+        file->path = path;
+        file->has_stamp = false;
+        file->source = NULL;
+        file->chunk = NULL;
+        file->imports = create_list(sizeof(char *), free_path);
+
+        load_cached_file(file, report_errors);
+
+        return file;
+}
+
+static void destroy_cached_file(struct CachedFile * file)
+{
+        unload_cached_file(file);
+        destroy_list(&file->imports);
+        FREE(file->path);
+        FREE(file);
+}
+
+static bool is_cached_file_stale(const struct CachedFile * file)
+{
+        struct FileStamp stamp;
+        bool has_stamp = get_file_stamp(file->path, &stamp);
+
+        if (has_stamp != file->has_stamp) {
+                return true;
+        }
+        return has_stamp && !are_file_stamps_equal(&stamp, &file->stamp);
+}
+
+static struct CachedFile * find_cached_file(const struct TokenCache * cache, const char * path)
+{
+        size_t index;
+        if (!str_map_find(&cache->indices, path, strlen(path), &index)) {
+                return NULL;
+        }
+        return *(struct CachedFile * const *) get_list_elem_const(&cache->files, index);
+}
+
+static void add_cached_file(struct TokenCache * cache, struct CachedFile * file)
+{
+        str_map_insert(&cache->indices, file->path, strlen(file->path), cache->files.length);
+        list_append(&cache->files, &file);
+}
+
+// Returns the file at "path" from "cache", loading it if it's not cached
+// or if it couldn't be loaded before, in which case errors are reported if
+// it still can't be. Unlike "update_token_cache", it doesn't check if
+// cached files have changed, so that a program is lexed from the files as
+// they were when the cache was updated.
+// "path" must be "ALLOC"ed, and is owned by the cache from then on.
+static struct CachedFile * get_cached_file(struct TokenCache * cache, char * path)
+{
+        struct CachedFile * file = find_cached_file(cache, path);
+        if (!file) {
+                file = create_cached_file(path, true);
+                add_cached_file(cache, file);
+                return file;
+        }
+
+        FREE(path);
+
+        if (!file->source) {
+                unload_cached_file(file);
+                load_cached_file(file, true);
+        }
+
+        return file;
+}
+
+struct TokenCache * create_token_cache(void)
+{
+        // Files are lexed by "update_token_cache" before anything calls "lex".
+        init_char_classes();
+
+        struct TokenCache * cache = ALLOC(struct TokenCache, 1);
+        cache->files = create_list(sizeof(struct CachedFile *), NULL);
+        cache->indices = create_str_map();
+
+        return cache;
+}
+
+void destroy_token_cache(struct TokenCache * cache)
+{
+        // The paths of the files are the keys of "indices".
+        destroy_str_map(&cache->indices);
+
+        for (size_t i = 0; i < cache->files.length; ++i) {
+                destroy_cached_file(*(struct CachedFile **) get_list_elem(&cache->files, i));
+        }
+        destroy_list(&cache->files);
+
+        FREE(cache);
+}
+
+void update_token_cache(struct TokenCache * cache, const char * file_path)
+{
+        // The files imported by "file_path", directly or indirectly, in the
+        // order they're found by following the import graph.
+        struct TokenCache * closure = create_token_cache();
+
+        if (has_minmod_file_ext(file_path)) {
+                char * path = duplicate_str(file_path);
+                struct CachedFile * file = find_cached_file(cache, path);
+                add_cached_file(closure, file ? file : create_cached_file(path, false));
+                if (file) {
+                        FREE(path);
+                }
+        }
+
+        for (size_t i = 0; i < closure->files.length; ++i) {
+                struct CachedFile * file = *(struct CachedFile **) get_list_elem(&closure->files, i);
+
+                // Only files that changed are lexed again, and the imports of
+                // the files that didn't are already known.
+                if (is_cached_file_stale(file)) {
+                        LOG_INFO("\"%s\" changed.\n", file->path);
+                        unload_cached_file(file);
+                        load_cached_file(file, false);
+                }
+
+                for (size_t j = 0; j < file->imports.length; ++j) {
+                        const char * import_path = *(char **) get_list_elem(&file->imports, j);
+                        if (find_cached_file(closure, import_path)) {
+                                continue;
+                        }
+
+                        struct CachedFile * imported = find_cached_file(cache, import_path);
+                        if (!imported) {
+                                imported = create_cached_file(duplicate_str(import_path), false);
+                        }
+                        add_cached_file(closure, imported);
+                }
+        }
+
+        // Files that aren't imported anymore are forgotten.
+        for (size_t i = 0; i < cache->files.length; ++i) {
+                struct CachedFile * file = *(struct CachedFile **) get_list_elem(&cache->files, i);
+                if (!find_cached_file(closure, file->path)) {
+                        destroy_cached_file(file);
+                }
+        }
+
+        destroy_str_map(&cache->indices);
+        destroy_list(&cache->files);
+        *cache = *closure;
+        FREE(closure);
+}
+
+bool is_token_cache_stale(const struct TokenCache * cache)
+{
+        for (size_t i = 0; i < cache->files.length; ++i) {
+                const struct CachedFile * file;
+                file = *(struct CachedFile * const *) get_list_elem_const(&cache->files, i);
+
+                if (is_cached_file_stale(file)) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+size_t get_token_cache_length(const struct TokenCache * cache)
+{
+        return cache->files.length;
+}
+
+const char * get_cached_file_path(const struct TokenCache * cache, size_t index)
+{
+        return (*(struct CachedFile * const *) get_list_elem_const(&cache->files, index))->path;
+}
+
+const struct SourceFile * get_cached_source(const struct TokenCache * cache, size_t index)
+{
+        return (*(struct CachedFile * const *) get_list_elem_const(&cache->files, index))->source;
+}
+
+static bool is_lexing_in_parallel(const struct Lexer * lexer)
+{
+        return list_is_valid(&lexer->chunks);
+}
+
+// Splits the next chunk off of the part of the file "lexer" hasn't split
+// up yet, and makes the thread pool lex it.
+// Returns "false" if the whole file is split up already.
+static bool submit_next_chunk(struct Lexer * lexer)
+{
+        if (lexer->iterator == lexer->end) {
+                return false;
+        }
+
+        const char * chunk_end = lexer->end;
+        if (lexer->end - lexer->iterator > LEX_CHUNK_SIZE) {
+                chunk_end = find_line_end(lexer->iterator + LEX_CHUNK_SIZE, lexer->end);
+                if (chunk_end < lexer->end) {
+                        // Include the newline.
+                        ++chunk_end;
+                }
+        }
+
+        struct LexedChunk * chunk = create_lexed_chunk(lexer->source, lexer->iterator, chunk_end,
+                                                       lexer->prefetcher);
+        list_append(&lexer->chunks, &chunk);
+        submit_task(lexer->pool, &chunk->task);
+
+        lexer->iterator = chunk_end;
+
+        return true;
+}
+
+// Makes "lexer" read its file from chunks lexed by "pool". The files
+// imported by the chunks are prefetched by "prefetcher", unless it's "NULL".
+static void start_lexing_in_parallel(struct Lexer * lexer, struct ThreadPool * pool,
+                                     struct Prefetcher * prefetcher)
+{
+        lexer->pool = pool;
+        lexer->prefetcher = prefetcher;
+        lexer->chunks = create_list(sizeof(struct LexedChunk *), NULL);
+        lexer->chunk_reader = create_token_buffer_reader();
+
+        int max_chunk_count = LEX_CHUNKS_PER_THREAD * (pool->thread_count + 1);
+        int chunk_count = 0;
+        while (chunk_count < max_chunk_count && submit_next_chunk(lexer)) {
+                ++chunk_count;
+        }
+}
+
+// Makes "lexer" scan the rest of its file itself, starting at
+// "lexer->iterator". Chunks that aren't read yet are thrown away.
+static void stop_lexing_in_parallel(struct Lexer * lexer)
+{
+        for (size_t i = 0; i < lexer->chunks.length; ++i) {
+                struct LexedChunk * chunk = *(struct LexedChunk **) get_list_elem(&lexer->chunks, i);
+                if (chunk->is_cached) {
+                        continue;
+                }
+
+                // The pool might be lexing it right now.
+                wait_for_task(lexer->pool, &chunk->task);
+                destroy_lexed_chunk(chunk);
+        }
+
+        destroy_list(&lexer->chunks);
+        lexer->chunks = create_invalid_list();
+}
+
+// Stores the next token lexed by the thread pool in "token".
+// Returns "false" if "lexer" should scan the rest of the file itself,
+// either because it's all read or because a chunk couldn't be lexed
+// entirely.
+static bool read_chunk_token(struct Lexer * lexer, struct Token * token)
+{
+        while (lexer->chunks.length > 0) {
+                struct LexedChunk * chunk = *(struct LexedChunk **) get_list_elem(&lexer->chunks, 0);
+                if (!chunk->is_cached) {
+                        wait_for_task(lexer->pool, &chunk->task);
+                }
+
+                if (lexer->chunk_reader.token_index < get_token_buffer_length(&chunk->tokens)) {
+                        *token = read_token_buffer(&chunk->tokens, &lexer->chunk_reader);
+
+                        // "lexer->line" is the line the chunk starts at.
+                        token->line += lexer->line;
+                        return true;
+                }
+
+                // The chunks are read in order, so summing up their newlines
+                // gives the line the next one starts at.
+                lexer->line += chunk->newline_count;
+
+                if (chunk->stop != chunk->end) {
+                        // Let "lexer" report the error, so that errors are reported
+                        // in the same order as when lexing on a single thread.
+                        lexer->iterator = chunk->stop;
+                        stop_lexing_in_parallel(lexer);
+                        return false;
+                }
+
+                if (!chunk->is_cached) {
+                        destroy_lexed_chunk(chunk);
+                }
+                list_remove(&lexer->chunks, 0);
+                lexer->chunk_reader = create_token_buffer_reader();
+
+                (void) submit_next_chunk(lexer);
+        }
+
+        // Every chunk is read, and "lexer->iterator" is at the end of the file.
+        stop_lexing_in_parallel(lexer);
+        return false;
+}
+
+// Makes "lexer" skip past the next token, incrementing "lexer->line" if
+// newlines are found.
+// Returns the token skipped past, or "TOK_END" if there are no tokens left
+// in the file.
+// Instruction names are interned in "names".
+static struct Token scan_token(struct Lexer * lexer, struct StrTable * names)
+{
+        struct Token token;
+
+        if (is_lexing_in_parallel(lexer) && read_chunk_token(lexer, &token)) {
+                return finish_token(lexer, token, names);
+        }
+
+        skip_whitespace_and_comments(&lexer->iterator, lexer->end, &lexer->line);
+
+        if (lexer->iterator == lexer->end) {
+                ASSERT_OR_HANDLE(lexer->nesting_level == 0, create_invalid_token(),
+                                 "Unclosed %s in \"%s\".",
+                                 token_type_as_string(TOK_STACK_OPEN), lexer->source->path);
+
+                return create_token(TOK_END, lexer->source, lexer->line);
+        }
+
+        if (!scan_raw_token(lexer->source, &lexer->iterator, lexer->end, lexer->line, &token)) {
+                ASSERT_OR_HANDLE(*lexer->iterator != g_import_open_ch, create_invalid_token(),
+                                 "Unclosed \"%c\" in line %d.", *lexer->iterator, lexer->line);
+
+                ASSERT_OR_HANDLE(false, create_invalid_token(),
+                                 "Invalid character \"%c\" in line %d.",
+                                 *lexer->iterator, lexer->line);
+        }
+
+        return finish_token(lexer, token, names);
+}
+
+static void destroy_lexer(void * lexer)
+{
+        if (is_lexing_in_parallel(lexer)) {
+                stop_lexing_in_parallel(lexer);
+        }
+}
+
+// Returns "true" if the file at "path" is loaded by "tokens", even if it's
+// loaded using a different path.
+static bool is_file_loaded(const struct TokenIter * tokens, const char * path)
+{
+        size_t value;
+
+        struct FileId id;
+        if (get_file_id(path, &id)) {
+                return str_map_find(&tokens->loaded_files, (const char *) &id, sizeof(id), &value);
+        }
+
+        return str_map_find(&tokens->loaded_files, path, strlen(path), &value);
+}
+
+// Appends "source" to the loaded sources.
+static void add_source_file(struct TokenIter * tokens, struct SourceFile * source)
+{
+        list_append(tokens->sources, &source);
+
+        size_t key_length;
+        const char * key = get_source_file_key(source, &key_length);
+
+        // "is_file_loaded" normally keeps files from being loaded twice, but
+        // the file at a path might be replaced in between.
+        size_t value;
+        if (!str_map_find(&tokens->loaded_files, key, key_length, &value)) {
+                str_map_insert(&tokens->loaded_files, key, key_length, tokens->sources->length - 1);
+        }
+}
+
+// Makes "tokens" read from "source" until its end is reached. "chunk" is
+// the whole file lexed ahead of time, or "NULL" if the file is lexed like
+// any other file.
+static void push_lexed_file(struct TokenIter * tokens, struct SourceFile * source,
+                            struct LexedChunk * chunk)
+{
+        add_source_file(tokens, source);
+
+        struct Lexer lexer = create_lexer(source);
+        if (chunk) {
+                // The whole file is a single chunk, and the lexer is done
+                // splitting it up.
+                lexer.pool = tokens->pool;
+                lexer.prefetcher = tokens->prefetcher;
+                lexer.chunks = create_list(sizeof(struct LexedChunk *), NULL);
+                list_append(&lexer.chunks, &chunk);
+                lexer.iterator = lexer.end;
+        } else {
+                start_lexing_in_parallel(&lexer, tokens->pool, tokens->prefetcher);
+        }
+        list_append(&tokens->lexers, &lexer);
+}
+
+// Makes "tokens" read from "file", which must be loaded, until its end is
+// reached.
+static void push_prefetched_file(struct TokenIter * tokens, struct PrefetchedFile * file)
+{
+        file->is_spliced = true;
+        push_lexed_file(tokens, file->source, file->chunk);
+}
+
+// Makes "tokens" read from "source", which is loaded but not lexed yet,
+// until its end is reached.
+static void push_loaded_file(struct TokenIter * tokens, struct SourceFile * source)
+{
+        // Must be added before lexing, so that the file can't import itself.
+        add_source_file(tokens, source);
+
+        LOG_DEBUG("\"%s\":\n\"%.*s\"\n\n", source->path,
+                  (int) source->contents.length, source->contents.data);
+
+        struct Lexer lexer = create_lexer(source);
+        if (tokens->pool && source->contents.length >= MIN_PARALLEL_LEX_SIZE) {
+                LOG_INFO("Lexing \"%s\" in chunks on %d threads ...\n",
+                         source->path, tokens->pool->thread_count);
+                start_lexing_in_parallel(&lexer, tokens->pool, tokens->prefetcher);
+        }
+        list_append(&tokens->lexers, &lexer);
+}
+
+// Loads "file_path" and makes "tokens" read from it until its end is
+// reached. "file_path" must be "ALLOC"ed, and is owned by the loaded source
+// file appended to "tokens->sources".
+// If the file is prefetched, the prefetched file is used instead.
+// Returns "true" iff there's no errors.
+static bool push_file(struct TokenIter * tokens, char * file_path)
+{
+        LOG_INFO("Tokenizing \"%s\" ...\n", file_path);
+
+        if (tokens->prefetcher) {
+                struct PrefetchedFile * file = wait_for_prefetched_file(tokens->prefetcher,
+                                                                        file_path);
+                // Files that couldn't be prefetched are loaded below, so that
+                // the errors are reported.
+                if (file && file->source) {
+                        FREE(file_path);
+                        push_prefetched_file(tokens, file);
+                        return true;
+                }
+        }
+
+        const char * file_ext = get_file_ext(file_path);
+
+        ASSERT_OR_HANDLE(file_ext, false,
+                         "Cannot lex file \"%s\", as it has no extension.", file_path);
+
+        ASSERT_OR_HANDLE(strcmp(file_ext, g_minmod_file_ext) == 0, false,
+                         "(min)mod files must have extension \"%s\", "
+                         "but \"%s\" has extension \"%s\".",
+                         g_minmod_file_ext, file_path, file_ext);
+
+        if (tokens->cache) {
+                struct CachedFile * file = get_cached_file(tokens->cache, file_path);
+
+                ASSERT_OR_HANDLE(file->source, false, "Unable to load a source file.");
+
+                push_lexed_file(tokens, file->source, file->chunk);
+                return true;
+        }
+
+        struct SourceFile * source = load_source_file(file_path);
+
+        ASSERT_OR_HANDLE(source, false, "Unable to load a source file.");
+
+        push_loaded_file(tokens, source);
+
+        return true;
+}
+
+// Makes "tokens" read from the file imported by "import_tok" until its end
+// is reached, unless the file is already loaded.
+// Returns "true" iff there's no errors.
+static bool evaluate_import(struct TokenIter * tokens, const struct Token * import_tok)
+{
+        char * abs_import_path = get_abs_import_path(import_tok->source->path,
+                                                     get_slice_start(import_tok->source,
+                                                                     import_tok->import_path),
+                                                     import_tok->import_path.length);
+        if (!abs_import_path) {
+                return false;
+        }
+
+        if (is_file_loaded(tokens, abs_import_path)) {
+                FREE(abs_import_path);
+                return true;
+        }
+
+        ASSERT_OR_HANDLE(push_file(tokens, abs_import_path), false,
+                         "Unable to tokenize \"%.*s\".",
+                         (int) import_tok->import_path.length,
+                         get_slice_start(import_tok->source, import_tok->import_path));
+
+        return true;
+}
+
+static struct TokenIter create_token_iter(struct StrTable * names,
+                                          struct List * sources,
+                                          struct ThreadPool * pool,
+                                          struct TokenCache * cache)
+{
+        init_char_classes();
+
+        struct TokenIter tokens;
+        tokens.lexers = create_list(sizeof(struct Lexer), destroy_lexer);
+        tokens.sources = sources;
+        tokens.names = names;
+        tokens.pool = pool;
+        tokens.prefetcher = NULL;
+        tokens.cache = cache;
+        tokens.loaded_files = create_str_map();
+        tokens.has_peeked = false;
+
+        return tokens;
+}
+
+static struct TokenIter start_lexing(const char * file_path,
+                                     struct StrTable * names,
+                                     struct List * sources,
+                                     struct ThreadPool * pool,
+                                     struct TokenCache * cache)
+{
+        LOG_INFO("Lexing \"%s\" ...\n", file_path);
+
+        struct TokenIter tokens = create_token_iter(names, sources, pool, cache);
+
+        // With a thread pool, every file imported directly or indirectly is
+        // loaded and lexed as soon as its import is found, rather than when
+        // the parser gets to it.
+        if (pool) {
+                tokens.prefetcher = create_prefetcher(pool);
+                if (has_minmod_file_ext(file_path)) {
+                        prefetch_file(tokens.prefetcher, duplicate_str(file_path));
+                }
+        }
+
+        // "push_file" expects an "ALLOC"ed file path that will be owned by
+        // its source file, and we want "lex" to be polite enough to not "FREE"
+        // its argument. Therefore, we copy the argument.
+        char * file_path_cpy = duplicate_str(file_path);
+        if (!push_file(&tokens, file_path_cpy)) {
+                destroy_token_iter(&tokens);
+                tokens.lexers = create_invalid_list();
+        }
+
+        return tokens;
+}
+
+struct TokenIter lex(const char * file_path, struct StrTable * names, struct List * sources,
+                     struct ThreadPool * pool)
+{
+        return start_lexing(file_path, names, sources, pool, NULL);
+}
+
+struct TokenIter lex_cached(const char * file_path, struct StrTable * names, struct List * sources,
+                            struct TokenCache * cache)
+{
+        return start_lexing(file_path, names, sources, NULL, cache);
+}
+
+struct TokenIter lex_buffer(const char * file_path, const char * contents, size_t length,
+                            struct StrTable * names, struct List * sources)
+{
+        LOG_INFO("Lexing \"%s\" from memory ...\n", file_path);
+
+        struct TokenIter tokens = create_token_iter(names, sources, NULL, NULL);
+
+        struct SourceFile * source = create_buffer_source_file(duplicate_str(file_path),
+                                                               contents, length);
+        if (!source) {
+                destroy_token_iter(&tokens);
+                tokens.lexers = create_invalid_list();
+                return tokens;
+        }
+
+        push_loaded_file(&tokens, source);
+
+        return tokens;
+}
+
+bool is_token_iter_valid(const struct TokenIter * tokens)
+{
+        return list_is_valid(&tokens->lexers);
+}
+
+void destroy_token_iter(struct TokenIter * tokens)
+{
+        // The lexers wait for the chunks they're reading, which might
+        // prefetch more files, so they must be destroyed first.
+        destroy_list(&tokens->lexers);
+
+        if (tokens->prefetcher) {
+                destroy_prefetcher(tokens->prefetcher);
+                tokens->prefetcher = NULL;
+        }
+
+        destroy_str_map(&tokens->loaded_files);
+}
+
+struct Token next_token(struct TokenIter * tokens)
+{
+        if (tokens->has_peeked) {
+                tokens->has_peeked = false;
+                return tokens->peeked;
+        }
+
+        while (tokens->lexers.length > 0) {
+                struct Lexer * lexer = get_list_elem(&tokens->lexers, tokens->lexers.length - 1);
+                struct Token token = scan_token(lexer, tokens->names);
+
+                switch (token.type) {
+                case TOK_END:
+                        // Continue where the file was imported.
+                        list_pop(&tokens->lexers);
+                        break;
+
+                case TOK_IMPORT:
+                        ASSERT_OR_HANDLE(evaluate_import(tokens, &token), create_invalid_token(),
+                                         "Unable to evaluate import in \"%s\", line %d.",
+                                         token.source->path, token.line);
+                        break;
+
+                default:
+                        return token;
+                }
+        }
+
+        return create_token(TOK_END, NULL, -1);
+}
+
+struct Token peek_token(struct TokenIter * tokens)
+{
+        if (!tokens->has_peeked) {
+                tokens->peeked = next_token(tokens);
+                tokens->has_peeked = true;
+        }
+        return tokens->peeked;
+}
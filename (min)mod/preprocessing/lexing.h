@@ -1,16 +1,147 @@
-#ifndef LEXING_H
-#define LEXING_H
-
-// Returns "true" iff "var_name" belongs to a variable belonging to the
-// global scope.
-bool is_global(const char * instr_name);
-
-// Assuming "global_instr" is a global variable and is marked as such,
-// this returns, without allocating any new data, the unmarked version.
-const char * get_unmarked_instr_name(const char * global_instr);
-
-// Lexically analyzes the contents of "file_path", returning a list of
-// "struct Token"s.
-struct List lex(const char * file_path);
-
-#endif
+#ifndef LEXING_H
+#define LEXING_H
+
+#include "../tools/list.h"
+#include "../tools/str_table.h"
+#include "source.h"
+#include "token.h"
+#include "token_buffer.h"
+#include "../tools/thread_pool.h"
+
+// Returns "true" iff "var_name" belongs to a variable belonging to the
+// global scope.
+bool is_global(const char * instr_name);
+
+// Assuming "global_instr" is a global variable and is marked as such,
+// this returns, without allocating any new data, the unmarked version.
+const char * get_unmarked_instr_name(const char * global_instr);
+
+// Loads imported files ahead of time. Defined in "lexing.c".
+struct Prefetcher;
+
+// Keeps files lexed until they change, so that a program can be lexed again
+// without lexing every file again. Defined in "lexing.c".
+struct TokenCache;
+
+// The state of lexing a single source file.
+struct Lexer {
+        const struct SourceFile * source;
+        const char * iterator;
+        const char * end;
+        int line;
+
+        // The number of "TOK_STACK_OPEN"s in the file that aren't closed yet.
+        // Parentheses must be balanced within every file.
+        int nesting_level;
+
+        // Large files are split into chunks lexed by "pool", if there is one,
+        // and prefetched files are lexed as a single chunk. "chunks" holds the
+        // "struct LexedChunk *"s being lexed or waiting to be read, in order,
+        // and is invalid unless the file is lexed that way. Then "iterator" is
+        // where the next chunk starts, and "line" is the line the first chunk
+        // starts at. Files imported by the chunks are prefetched by
+        // "prefetcher", unless it's "NULL".
+        struct ThreadPool * pool;
+        struct Prefetcher * prefetcher;
+        struct List chunks;
+        // Where the next token is read from in the first chunk.
+        struct TokenBufferReader chunk_reader;
+};
+
+// Produces the tokens of a file one at a time, as they're asked for, with
+// the tokens of imported files in place of the imports. Whitespace and
+// comments are skipped rather than turned into tokens, so the whole
+// program is never stored as tokens at once.
+struct TokenIter {
+        // The "struct Lexer"s of the files currently being lexed. The last one
+        // belongs to the most recently imported file, and is the one tokens
+        // are read from.
+        struct List lexers;
+
+        struct List * sources;
+        struct StrTable * names;
+
+        // A set of the files in "sources", so that no file is imported twice.
+        // Maps the keys returned by "get_source_file_key" to indices into
+        // "sources".
+        struct StrMap loaded_files;
+
+        // Used to lex large files in parallel and to load imported files
+        // concurrently. Both are "NULL" if everything is done on the calling
+        // thread.
+        struct ThreadPool * pool;
+        struct Prefetcher * prefetcher;
+
+        // Where files are lexed from, if they're not lexed on the spot. Only
+        // used by "lex_cached".
+        struct TokenCache * cache;
+
+        // The token returned by the last call to "peek_token", if it hasn't
+        // been returned by "next_token" yet.
+        struct Token peeked;
+        bool has_peeked;
+};
+
+// Starts lexing the contents of "file_path".
+// Instruction names are interned in "names", and the tokens refer to them
+// by their IDs.
+// Every file loaded (the file itself and its imports) is appended to
+// "sources", created using "create_source_file_list". The tokens refer to
+// the contents of the files, so "sources" must outlive them.
+// Unless "pool" is "NULL", large files are split into chunks lexed ahead of
+// time by "pool", and imported files are loaded and lexed by "pool" as soon
+// as their imports are found. The tokens are still returned in the same
+// order, and every file is still only imported once.
+// Returns an invalid iterator if "file_path" can't be loaded.
+struct TokenIter lex(const char * file_path, struct StrTable * names, struct List * sources,
+                     struct ThreadPool * pool);
+
+// Like "lex", but files are lexed from "cache" rather than on the spot,
+// and the cache lexes the files that aren't in it yet. The source files
+// appended to "sources" are owned by the cache, so "sources" must not
+// destroy them, and the cache must outlive the tokens.
+struct TokenIter lex_cached(const char * file_path, struct StrTable * names, struct List * sources,
+                            struct TokenCache * cache);
+
+// Like "lex", but the program is lexed from the "length" bytes at
+// "contents", copied into the source file appended to "sources", as if
+// they were the contents of "file_path". Files it imports are loaded from
+// the directory of "file_path" like any other imports.
+struct TokenIter lex_buffer(const char * file_path, const char * contents, size_t length,
+                            struct StrTable * names, struct List * sources);
+
+bool is_token_iter_valid(const struct TokenIter * tokens);
+
+void destroy_token_iter(struct TokenIter * tokens);
+
+// Returns the next token, "TOK_END" once every token is returned, or
+// "TOK_INVALID" if the source code has errors.
+struct Token next_token(struct TokenIter * tokens);
+
+// Returns the token the next call to "next_token" will return.
+struct Token peek_token(struct TokenIter * tokens);
+
+struct TokenCache * create_token_cache(void);
+
+void destroy_token_cache(struct TokenCache * cache);
+
+// Makes "cache" hold the files imported by "file_path", directly or
+// indirectly, along with "file_path" itself. Only the files that changed
+// since they were cached are lexed again, and files that aren't imported
+// anymore are forgotten. Nothing is reported if files can't be loaded or
+// lexed; that's up to "lex_cached".
+void update_token_cache(struct TokenCache * cache, const char * file_path);
+
+// Returns "true" if any of the files in "cache" changed since they were
+// cached, including files that were created or deleted since.
+bool is_token_cache_stale(const struct TokenCache * cache);
+
+size_t get_token_cache_length(const struct TokenCache * cache);
+
+const char * get_cached_file_path(const struct TokenCache * cache, size_t index);
+
+// The source file of the file at "index" in "cache", or "NULL" if it can't
+// be loaded.
+const struct SourceFile * get_cached_source(const struct TokenCache * cache, size_t index);
+
+#endif
@@ -0,0 +1,472 @@
+#include "optimizing.h"
+#include "verifying.h"
+#include "../settings.h"
+#include "../data_types/stack.h"
+#include "../tools/list.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/ptr_map.h"
+
+// Returns whether each instruction type of "itype_list" can be found with
+// indirection in "stacks", indexed by ID. The array is "ALLOC"ed.
+// Built-ins can't be set or run as anything else, so they're left out.
+static bool * find_indirect_itypes(const struct ITypeList * itype_list, const struct List * stacks)
+{
+        size_t itype_count = itype_list->itypes.length;
+        bool * is_indirect = ALLOC(bool, itype_count);
+        SET_MEMORY(is_indirect, false, bool, itype_count);
+
+        for (size_t i = 0; i < stacks->length; ++i) {
+                const struct Stack * stack = *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_INSTR && elem->indirection_level > 0 &&
+                            !is_builtin(elem->instr)) {
+                                is_indirect[elem->instr] = true;
+                        }
+                }
+        }
+
+        return is_indirect;
+}
+
+// Returns the built-in "stack" has on its own, without indirection, or
+// "BUILTINS_COUNT" if it has anything else.
+static enum Builtin get_only_builtin(const struct Stack * stack)
+{
+        if (stack->size != 1) {
+                return BUILTINS_COUNT;
+        }
+
+        const struct StackElem * elem = &stack->contents[0];
+        if (elem->type != STACK_ELEM_INSTR || elem->indirection_level > 0 ||
+            !is_builtin(elem->instr)) {
+                return BUILTINS_COUNT;
+        }
+
+        return id_to_builtin(elem->instr);
+}
+
+// Finds the instruction types that are a built-in, the ones named after
+// built-ins that is, and always will be.
+// Only "SET" changes the value of an instruction type, and its target can
+// only be an instruction pushed onto the data stack. That takes an element
+// with indirection, which keeps its instruction as elements are copied and
+// only loses indirection as it's pushed, so instruction types nowhere to be
+// found with indirection are never set. Neither is their value shared nor
+// run as the instruction stack, which would pop it, since getting a
+// reference to it takes "UNWRAP" with the instruction on the data stack too.
+// Running the built-in right away leaves out the sub-stack the value would
+// have been copied into, which the program could only tell by looking at
+// the instruction stack, so nothing is found if "are_stacks_exposed".
+// Nothing is found either if the data stack can be set, which makes any
+// instruction in a literal sub-stack one that's pushed onto it, since the
+// sub-stack becomes the data stack.
+static void find_constant_itypes(struct ITypeList * itype_list, const bool * is_indirect,
+                                 bool are_stacks_exposed)
+{
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+
+        for (size_t id = 0; id < itype_list->itypes.length; ++id) {
+                struct IType * itype = id_to_itype(itype_list, id);
+                itype->constant_builtin = BUILTINS_COUNT;
+
+                // The value of a checkpoint may be shared already, and the
+                // data stack and instruction stack change without "SET".
+                if (are_stacks_exposed || is_indirect[id] ||
+                    !itype->value || itype->value->reference_count != 1 ||
+                    (instr_id_t) id == instr_stack || (instr_id_t) id == data_stack) {
+                        continue;
+                }
+
+                itype->constant_builtin = get_only_builtin(itype->value);
+        }
+}
+
+// Folds the "IF"s of "stack", code on the instruction stack that nothing
+// else refers to, whose argument is a literal sub-stack pushed right before
+// it. Such an "IF" pops the argument, along with the element pushed before
+// it if the argument is empty, so all of them are left out. Sub-stacks run
+// from "stack" are folded as well.
+// Returns how many "IF"s were folded.
+static size_t fold_ifs(const struct ITypeList * itype_list, struct Stack * stack)
+{
+        size_t fold_count = 0;
+
+        // The elements kept are moved to the top of "stack" as it's gone
+        // through from the top, the one run last before "elem" being at
+        // "kept_idx".
+        size_t kept_idx = stack->size;
+
+        for (size_t i = stack->size; i-- > 0;) {
+                struct StackElem * elem = &stack->contents[i];
+
+                if (get_called_builtin(itype_list, elem) == BUILTIN_IF && kept_idx < stack->size) {
+                        const struct StackElem * arg = &stack->contents[kept_idx];
+                        bool is_arg_known = arg->type == STACK_ELEM_SUBSTACK &&
+                                            arg->indirection_level > 0;
+
+                        size_t pop_count = is_arg_known && arg->substack->size == 0 ? 2 : 1;
+
+                        // Anything pushed with indirection can be popped, but
+                        // elements without it may have pushed anything at all.
+                        if (is_arg_known && kept_idx + pop_count <= stack->size &&
+                            stack->contents[kept_idx + pop_count - 1].indirection_level > 0) {
+                                for (size_t j = 0; j < pop_count; ++j) {
+                                        destroy_stack_elem(&stack->contents[kept_idx++]);
+                                }
+                                ++fold_count;
+                                continue;
+                        }
+                }
+
+                if (elem->type == STACK_ELEM_SUBSTACK && elem->indirection_level == 0 &&
+                    elem->substack->reference_count == 1) {
+                        fold_count += fold_ifs(itype_list, elem->substack);
+                }
+
+                stack->contents[--kept_idx] = *elem;
+        }
+
+        stack->size -= kept_idx;
+        MOVE_MEMORY(stack->contents, &stack->contents[kept_idx], struct StackElem, stack->size);
+
+        return fold_count;
+}
+
+// Folds the "IF"s on the instruction stack that can be run ahead of time.
+// Only code that runs once is folded, which is what the instruction stack
+// has, save for the sub-stacks it shares with values and the data stack.
+// The rest, like the values of instruction types, can be logged or looked
+// at by the program, and can't change without changing what it does.
+static size_t fold_instr_stack_ifs(struct ITypeList * itype_list)
+{
+        struct Stack * instr_stack = instr_name_to_itype(itype_list, g_instr_stack_str)->value;
+        if (!instr_stack) {
+                return 0;
+        }
+
+        size_t fold_count = 0;
+        for (size_t i = 0; i < instr_stack->size; ++i) {
+                const struct StackElem * frame = &instr_stack->contents[i];
+                if (frame->type == STACK_ELEM_SUBSTACK && frame->indirection_level == 0 &&
+                    frame->substack->reference_count == 1) {
+                        fold_count += fold_ifs(itype_list, frame->substack);
+                }
+        }
+
+        return fold_count;
+}
+
+// "value. name. SET" in the code on the instruction stack, "value" being a
+// literal sub-stack at "value_idx" of "code".
+struct Definition {
+        struct Stack * code;
+        size_t value_idx;
+        instr_id_t name;
+
+        // Whether "name" is used, and so is the value.
+        bool is_live;
+};
+
+// The instruction types a program uses, found by going through its stacks
+// but for the values of definitions, which are only gone through once the
+// names they're given are found to be used.
+struct UseSearch {
+        const struct ITypeList * itype_list;
+
+        // Indexed by ID.
+        bool * is_used;
+
+        struct List definitions;
+
+        // The "struct Stack *"s of code on the instruction stack, which
+        // definitions are found in.
+        struct List code;
+
+        // The "struct Stack *"s yet to be gone through.
+        struct List pending;
+
+        // Every stack gone through or pending, like in "find_reachable_stacks".
+        struct PtrMap found;
+};
+
+// Returns "true" if "stack" defines an instruction type at "idx".
+// "SET" can't fail on a definition, since it has what it sets and the
+// value it's set to right before it.
+static bool is_definition(const struct ITypeList * itype_list,
+                          const struct Stack * stack,
+                          size_t idx)
+{
+        if (idx < 2) {
+                return false;
+        }
+
+        const struct StackElem * value = &stack->contents[idx];
+        const struct StackElem * name = &stack->contents[idx - 1];
+
+        return value->type == STACK_ELEM_SUBSTACK && value->indirection_level > 0 &&
+               value->substack->reference_count == 1 &&
+               name->type == STACK_ELEM_INSTR && name->indirection_level == 1 &&
+               !is_builtin(name->instr) &&
+               get_called_builtin(itype_list, &stack->contents[idx - 2]) == BUILTIN_SET;
+}
+
+static void search_stack(struct UseSearch * search, struct Stack * stack)
+{
+        if (!ptr_map_contains(&search->found, stack)) {
+                ptr_map_insert(&search->found, stack, 0);
+                list_append(&search->pending, &stack);
+        }
+}
+
+static void search_elem(struct UseSearch * search, const struct StackElem * elem)
+{
+        if (elem->type == STACK_ELEM_INSTR && !is_builtin(elem->instr)) {
+                search->is_used[elem->instr] = true;
+        } else if (elem->type == STACK_ELEM_SUBSTACK) {
+                search_stack(search, elem->substack);
+        } else if (elem->type == STACK_ELEM_STACK_REF) {
+                search_stack(search, elem->stack_ref);
+        }
+}
+
+static void search_pending(struct UseSearch * search)
+{
+        while (search->pending.length > 0) {
+                size_t last = search->pending.length - 1;
+                struct Stack * stack = *(struct Stack **) get_list_elem(&search->pending, last);
+                list_pop(&search->pending);
+
+                for (size_t i = 0; i < stack->size; ++i) {
+                        search_elem(search, &stack->contents[i]);
+                }
+        }
+}
+
+// Goes through "code", a sub-stack of the instruction stack nothing else
+// refers to, and the code it runs, finding the definitions in it.
+static void search_code(struct UseSearch * search, struct Stack * code)
+{
+        list_append(&search->code, &code);
+
+        for (size_t i = code->size; i-- > 0;) {
+                struct StackElem * elem = &code->contents[i];
+
+                if (is_definition(search->itype_list, code, i)) {
+                        struct Definition definition = {
+                                .code = code,
+                                .value_idx = i,
+                                .name = code->contents[i - 1].instr,
+                                .is_live = false
+                        };
+                        list_append(&search->definitions, &definition);
+
+                        search_elem(search, &code->contents[i - 2]);
+                        i -= 2;
+                } else if (elem->type == STACK_ELEM_SUBSTACK && elem->indirection_level == 0 &&
+                           elem->substack->reference_count == 1) {
+                        search_code(search, elem->substack);
+                } else {
+                        search_elem(search, elem);
+                }
+        }
+}
+
+// Removes the elements of "stack" left invalid.
+static void remove_invalid_elems(struct Stack * stack)
+{
+        size_t kept_count = 0;
+        for (size_t i = 0; i < stack->size; ++i) {
+                if (is_stack_elem_valid(&stack->contents[i])) {
+                        stack->contents[kept_count++] = stack->contents[i];
+                }
+        }
+        stack->size = kept_count;
+}
+
+// Removes the definitions on the instruction stack of instruction types
+// that are never used, such as most of the ones in imported libraries.
+// An instruction type is used if it's found anywhere but where it's
+// defined, or in the value of a definition of one that's used, or if it's
+// logged. Values can only be looked at through their instruction types,
+// so they aren't missed, and their definitions run once, from the
+// instruction stack, so they aren't either.
+// Returns how many definitions were removed.
+static size_t remove_unused_definitions(struct ITypeList * itype_list)
+{
+        size_t itype_count = itype_list->itypes.length;
+
+        struct UseSearch search;
+        search.itype_list = itype_list;
+        search.is_used = ALLOC(bool, itype_count);
+        search.definitions = create_list(sizeof(struct Definition), NULL);
+        search.code = create_list(sizeof(struct Stack *), NULL);
+        search.pending = create_list(sizeof(struct Stack *), NULL);
+        search.found = create_ptr_map();
+
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+
+        for (size_t id = 0; id < itype_count; ++id) {
+                const struct IType * itype = id_to_itype_const(itype_list, id);
+                search.is_used[id] = is_itype_loggable(itype->name) ||
+                                     (instr_id_t) id == instr_stack ||
+                                     (instr_id_t) id == data_stack;
+
+                if (itype->value && (instr_id_t) id != instr_stack) {
+                        search_stack(&search, itype->value);
+                }
+        }
+
+        struct Stack * instr_stack_val = id_to_itype(itype_list, instr_stack)->value;
+        for (size_t i = 0; instr_stack_val && i < instr_stack_val->size; ++i) {
+                struct StackElem * frame = &instr_stack_val->contents[i];
+                if (frame->type == STACK_ELEM_SUBSTACK && frame->indirection_level == 0 &&
+                    frame->substack->reference_count == 1) {
+                        search_code(&search, frame->substack);
+                } else {
+                        search_elem(&search, frame);
+                }
+        }
+
+        search_pending(&search);
+
+        // Values of definitions found to be used may use more instruction
+        // types, whose definitions have to be gone through again.
+        bool is_changed = true;
+        while (is_changed) {
+                is_changed = false;
+
+                for (size_t i = 0; i < search.definitions.length; ++i) {
+                        struct Definition * definition = get_list_elem(&search.definitions, i);
+                        if (definition->is_live || !search.is_used[definition->name]) {
+                                continue;
+                        }
+
+                        definition->is_live = true;
+                        search_stack(&search,
+                                     definition->code->contents[definition->value_idx].substack);
+                        search_pending(&search);
+                        is_changed = true;
+                }
+        }
+
+        size_t removed_count = 0;
+        for (size_t i = 0; i < search.definitions.length; ++i) {
+                const struct Definition * definition = get_list_elem(&search.definitions, i);
+                if (definition->is_live) {
+                        continue;
+                }
+
+                for (size_t j = 0; j < 3; ++j) {
+                        struct StackElem * elem =
+                                &definition->code->contents[definition->value_idx - j];
+                        destroy_stack_elem(elem);
+                        *elem = create_invalid_stack_elem();
+                }
+                ++removed_count;
+        }
+
+        for (size_t i = 0; i < search.code.length; ++i) {
+                remove_invalid_elems(*(struct Stack **) get_list_elem(&search.code, i));
+        }
+
+        FREE(search.is_used);
+        destroy_list(&search.definitions);
+        destroy_list(&search.code);
+        destroy_list(&search.pending);
+        destroy_ptr_map(&search.found);
+
+        return removed_count;
+}
+
+// Removes the instruction types found nowhere in the program and without
+// a value, apart from the ones that are logged, and logs how many.
+// "stacks" are the stacks reachable in the program.
+static void remove_unused_itypes(struct ITypeList * itype_list, const struct List * stacks)
+{
+        size_t itype_count = itype_list->itypes.length;
+        bool * is_kept = ALLOC(bool, itype_count);
+
+        for (size_t id = 0; id < itype_count; ++id) {
+                is_kept[id] = is_itype_logged(id_to_itype_const(itype_list, id)->name) ||
+                              id_to_itype_const(itype_list, id)->value;
+        }
+
+        for (size_t i = 0; i < stacks->length; ++i) {
+                const struct Stack * stack =
+                        *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_INSTR && !is_builtin(elem->instr)) {
+                                is_kept[elem->instr] = true;
+                        }
+                }
+        }
+
+        size_t removed_count = 0;
+        for (size_t id = 0; id < itype_count; ++id) {
+                removed_count += !is_kept[id];
+        }
+
+        if (removed_count > 0) {
+                remove_itypes(itype_list, is_kept);
+        }
+        LOG_DEBUG("Removed %zu unused instruction types.\n", removed_count);
+
+        FREE(is_kept);
+}
+
+struct DepthEstimate optimize(struct ITypeList * itype_list)
+{
+        struct List stacks = find_reachable_stacks(itype_list);
+        bool * is_indirect = find_indirect_itypes(itype_list, &stacks);
+
+        // The program can look at the instruction stack, or set the data stack,
+        // if either is found with indirection. Checkpoints may also have
+        // references to them, or have them shared with values already.
+        // Programs that set the data stack can set any instruction type,
+        // "IF" and "SET" included, by making it the target of "SET" from a
+        // literal, and push onto any stack.
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+        const struct Stack * instr_stack_val = id_to_itype(itype_list, instr_stack)->value;
+        const struct Stack * data_stack_val = id_to_itype(itype_list, data_stack)->value;
+        bool are_stacks_exposed = is_indirect[instr_stack] || is_indirect[data_stack] ||
+                                  (instr_stack_val && instr_stack_val->reference_count != 1) ||
+                                  (data_stack_val && data_stack_val->reference_count != 1);
+
+        find_constant_itypes(itype_list, is_indirect, are_stacks_exposed);
+        FREE(is_indirect);
+
+        // Code on the instruction stack is only changed if the program
+        // can't look at it, nor set the built-ins the code is changed for.
+        if (!are_stacks_exposed) {
+                size_t fold_count = fold_instr_stack_ifs(itype_list);
+                LOG_DEBUG("Folded %zu %s instructions.\n", fold_count, g_builtin_names[BUILTIN_IF]);
+
+                size_t definition_count = remove_unused_definitions(itype_list);
+                LOG_DEBUG("Removed %zu unused definitions.\n", definition_count);
+
+                // Code left out frees the stacks in it.
+                if (fold_count > 0 || definition_count > 0) {
+                        destroy_list(&stacks);
+                        stacks = find_reachable_stacks(itype_list);
+                }
+        }
+
+        // Removing instruction types doesn't change the stacks there are, so
+        // the rest of the passes go through the same ones.
+        remove_unused_itypes(itype_list, &stacks);
+
+        verify(itype_list, &stacks, are_stacks_exposed);
+        struct DepthEstimate estimate = estimate_depths(itype_list, &stacks, are_stacks_exposed);
+
+        destroy_list(&stacks);
+
+        return estimate;
+}
@@ -0,0 +1,27 @@
+// Optimizations of programs that are about to run, which make them run
+// faster without changing what they do. Only how many steps they take
+// changes, along with the sub-stacks left on the instruction stack of
+// programs that fail, which have less of the work in progress on them.
+// Stacks that can be looked at, by logging or by the program itself, are
+// left as they are, so optimizations leave notes on the instruction types
+// for "run" to make use of, and only change the code on the instruction
+// stack, which runs once and is gone, unless the program can look at it.
+// Instruction types that are never used, and aren't logged, are removed,
+// giving the rest new IDs.
+// Calls of built-ins are verified last, so that the ones proved to pass
+// the checks of their built-ins skip them. Then how deep the data stack
+// and the instruction stack get is estimated, for them to be presized.
+
+#ifndef OPTIMIZING_H
+#define OPTIMIZING_H
+
+#include "../data_types/itype.h"
+#include "presizing.h"
+
+// Optimizes the program in "itype_list", which may be parsed, loaded from
+// an image or restored from a checkpoint. Programs changed in any way but
+// by running them have to be optimized again.
+// Returns how deep the stacks are estimated to get as the program runs.
+struct DepthEstimate optimize(struct ITypeList * itype_list);
+
+#endif
@@ -1,179 +1,188 @@
-#include "parsing.h"
-#include "../data_types/itype.h"
-#include "token.h"
-#include "../tools/log.h"
-#include "../data_types/stack.h"
-#include "../settings.h"
-#include "../tools/mem_tools.h"
-
-static struct List tokens_to_itype_list(const struct List * tokens)
-{
-        struct List itype_list = create_list(sizeof(struct IType), destroy_itype_void_ptr);
-
-        // IS and DS must be in the list even if they're not referenced in the
-        // program, as they're implicitly used by the built-in instructions.
-        add_itype_to_list(&itype_list, g_instr_stack_str);
-        add_itype_to_list(&itype_list, g_data_stack_str);
-
-        for (size_t i = 0; i < tokens->length; ++i) {
-
-                const struct Token * curr_tok = get_list_elem_const(tokens, i);
-
-                if (curr_tok->type == TOK_INSTR &&
-                    !itype_in_list(&itype_list, curr_tok->instr_name)) {
-                        add_itype_to_list(&itype_list, curr_tok->instr_name);
-                }
-        }
-
-        return itype_list;
-}
-
-static struct Stack * tokens_to_stack(const struct List * tokens, const struct List * itype_list);
-
-static struct StackElem get_nested_stack(const struct List * tokens,
-                                         const struct List * itype_list,
-                                         size_t * iterator)
-{
-        size_t stack_open_idx = *iterator;
-        const struct Token * stack_open_tok = get_list_elem_const(tokens, stack_open_idx);
-
-        int nesting_level = 0;
-        do {
-                ASSERT_OR_HANDLE(*iterator < tokens->length, create_invalid_stack_elem(),
-                                 "Unclosed %s in line %d.",
-                                 token_type_as_string(stack_open_tok->type), stack_open_tok->line);
-
-                const struct Token * curr_tok = get_list_elem_const(tokens, *iterator);
-                switch (curr_tok->type) {
-                case TOK_STACK_OPEN:
-                        ++nesting_level;
-                        break;
-                case TOK_STACK_CLOSE:
-                        --nesting_level;
-                        break;
-                default:
-                        break;
-                }
-
-                ++*iterator;
-
-        } while (nesting_level > 0);
-
-        size_t stack_close_idx = *iterator - 1;
-        struct List sublist = create_sublist(tokens, stack_open_idx + 1, stack_close_idx);
-
-        int indirection_level = 0;
-        if (*iterator < tokens->length) {
-
-                const struct Token * tok_after_substack = get_list_elem_const(tokens, *iterator);
-
-                if (tok_after_substack->type == TOK_INDIRECTION) {
-                        indirection_level = tok_after_substack->indirection_level;
-                        ++*iterator;
-                }
-        }
-
-        struct Stack * stack = tokens_to_stack(&sublist, itype_list);
-        struct StackElem stack_as_substack = create_substack(stack, indirection_level);
-
-        return stack_as_substack;
-}
-
-static struct StackElem get_instr(const struct List * tokens,
-                                  const struct List * itype_list,
-                                  size_t * iterator)
-{
-        const struct Token * instr_tok = get_list_elem_const(tokens, *iterator);
-        ++*iterator;
-
-        int indirection_level = 0;
-
-        if (*iterator < tokens->length) {
-                const struct Token * next_tok = get_list_elem_const(tokens, *iterator);
-                if (next_tok->type == TOK_INDIRECTION) {
-                        indirection_level = next_tok->indirection_level;
-                        ++*iterator;
-                }
-        }
-
-        instr_id_t instr = find_instr_id(itype_list, instr_tok->instr_name);
-
-        struct StackElem instr_as_stack_elem = instr_to_stack_elem(instr, indirection_level);
-        return instr_as_stack_elem;
-}
-
-static struct Stack * tokens_to_stack(const struct List * tokens, const struct List * itype_list)
-{
-        struct Stack * stack = create_stack();
-
-        size_t idx = 0;
-        while (idx < tokens->length) {
-
-                const struct Token * curr_tok = get_list_elem_const(tokens, idx);
-
-                switch (curr_tok->type) {
-                case TOK_STACK_OPEN: {
-                        struct StackElem stack_elem = get_nested_stack(tokens, itype_list, &idx);
-                        stack_push(stack, &stack_elem);
-                        break;
-
-                } case TOK_INSTR: {
-                        struct StackElem stack_elem = get_instr(tokens, itype_list, &idx);
-                        stack_push(stack, &stack_elem);
-                        break;
-                } default: {
-                        ASSERT_OR_HANDLE(false, create_invalid_stack(), "Unexpected %s in line %d.",
-                                         token_type_as_string(curr_tok->type), curr_tok->line);
-
-                }
-                }
-        }
-
-        reverse_stack(stack);
-        return stack;
-}
-
-static void set_builtin_value(enum Builtin builtin, struct List * itype_list)
-{
-        const char * builtin_name = g_builtin_names[builtin];
-
-        if (itype_in_list(itype_list, builtin_name)) {
-                struct IType * itype = instr_name_to_itype(itype_list, builtin_name);
-                itype->value = create_stack();
-
-                // Built-ins have indices -1, -2, -3 etc.
-                instr_id_t instr = builtin_to_id(builtin);
-                struct StackElem stack_elem = instr_to_stack_elem(instr, 0);
-
-                stack_push(itype->value, &stack_elem);
-        }
-}
-
-struct List parse(const struct List * tokens)
-{
-        struct List itype_list = tokens_to_itype_list(tokens);
-
-        LOG_DEBUG("Instruction types:\n");
-        log_itype_list(LOG_LVL_DEBUG, &itype_list);
-        LOG_DEBUG("\n\n");
-
-        for (enum Builtin i = 0; i < BUILTINS_COUNT; ++i) {
-                set_builtin_value(i, &itype_list);
-        }
-
-        struct IType * data_stack = instr_name_to_itype(&itype_list, g_data_stack_str);
-        data_stack->value = create_stack();
-
-        struct Stack * instr_substack = tokens_to_stack(tokens, &itype_list);
-        struct StackElem instr_substack_as_stack_elem = create_substack(instr_substack, 0);
-
-        struct IType * instr_stack = instr_name_to_itype(&itype_list, g_instr_stack_str);
-        instr_stack->value = create_stack();
-        stack_push(instr_stack->value, &instr_substack_as_stack_elem);
-
-        LOG_DEBUG("%s (backwards for better readability):\n", g_instr_stack_str);
-        log_stack_backwards(LOG_LVL_DEBUG, instr_stack->value, &itype_list);
-        LOG_DEBUG("\n\n");
-
-        return itype_list;
-}
+#include "parsing.h"
+#include "../data_types/itype.h"
+#include "token.h"
+#include "lexing.h"
+#include "../tools/log.h"
+#include "../data_types/stack.h"
+#include "../settings.h"
+#include "../tools/mem_tools.h"
+
+// Returns the indirection level following the element that was just
+// parsed, consuming the "TOK_INDIRECTION" if there is one.
+static int parse_indirection(struct TokenIter * tokens)
+{
+        struct Token next_tok = peek_token(tokens);
+        if (next_tok.type != TOK_INDIRECTION) {
+                return 0;
+        }
+
+        (void) next_token(tokens);
+        return next_tok.indirection_level;
+}
+
+// Creates a stack of the elements in "elems" from "start" onward, and
+// removes them from "elems". The stack is created with the exact capacity
+// needed, so it never has to grow.
+static struct Stack * pop_elems_as_stack(struct List * elems, size_t start)
+{
+        struct Stack * stack = create_stack_with_capacity(elems->length - start);
+
+        // The elements are in the order they're written, but stacks are
+        // stored with the top, the first element, last.
+        // Pushing can't fail, since the stack has room for every element.
+        for (size_t i = elems->length; i > start; --i) {
+                (void) stack_push(stack, get_list_elem(elems, i - 1));
+        }
+
+        list_truncate(elems, start);
+
+        return stack;
+}
+
+// Destroys the sub-stacks in "elems" and then "elems" itself.
+static void destroy_parsed_elems(struct List * elems)
+{
+        for (size_t i = 0; i < elems->length; ++i) {
+                struct StackElem * elem = get_list_elem(elems, i);
+                if (elem->type == STACK_ELEM_SUBSTACK) {
+                        destroy_stack(elem->substack);
+                }
+        }
+
+        destroy_list(elems);
+}
+
+// Builds the stack of the whole program from the tokens. Nested stacks are
+// built as their tokens arrive, so tokens never have to be stored, and
+// without recursion, so there's no limit to how deep they can be nested.
+// Returns "NULL" if the tokens are invalid.
+static struct Stack * parse_program_stack(struct TokenIter * tokens)
+{
+        // The elements of the stacks that aren't closed yet, in the order
+        // they're found. The elements of a stack come right after the ones of
+        // the stack it's nested in found so far, so only the innermost stack
+        // is ever added to.
+        struct List elems = create_list(sizeof(struct StackElem), NULL);
+
+        // The index in "elems" of the first element of each stack that isn't
+        // closed yet, starting with the program itself.
+        struct List elem_starts = create_list(sizeof(size_t), NULL);
+        size_t program_start = 0;
+        list_append(&elem_starts, &program_start);
+
+        struct Stack * program = NULL;
+
+        while (!program) {
+                struct Token curr_tok = next_token(tokens);
+
+                switch (curr_tok.type) {
+                case TOK_STACK_OPEN: {
+                        size_t elem_start = elems.length;
+                        list_append(&elem_starts, &elem_start);
+                        break;
+
+                } case TOK_INSTR: {
+                        // The lexer interned the names in the names of the
+                        // instruction type list, so the ID of the name is the ID of
+                        // the instruction.
+                        instr_id_t instr = (instr_id_t) curr_tok.name_id;
+
+                        int indirection_level = parse_indirection(tokens);
+                        struct StackElem stack_elem = instr_to_stack_elem(instr, indirection_level);
+                        list_append(&elems, &stack_elem);
+                        break;
+
+                } case TOK_STACK_CLOSE:
+                case TOK_END: {
+                        // The lexer makes sure parentheses are balanced, so a stack
+                        // can only be closed if it's nested.
+                        bool is_nested = elem_starts.length > 1;
+                        ASSERT(is_nested == (curr_tok.type == TOK_STACK_CLOSE),
+                               "Unexpected %s.", token_type_as_string(curr_tok.type));
+
+                        size_t elem_start = *(size_t *) get_list_elem(&elem_starts,
+                                                                      elem_starts.length - 1);
+                        list_pop(&elem_starts);
+
+                        struct Stack * stack = pop_elems_as_stack(&elems, elem_start);
+
+                        if (!is_nested) {
+                                program = stack;
+                                break;
+                        }
+
+                        int indirection_level = parse_indirection(tokens);
+                        struct StackElem stack_elem = create_substack(stack, indirection_level);
+                        list_append(&elems, &stack_elem);
+                        break;
+
+                } case TOK_INVALID: {
+                        destroy_parsed_elems(&elems);
+                        destroy_list(&elem_starts);
+                        return NULL;
+
+                } default: {
+                        destroy_parsed_elems(&elems);
+                        destroy_list(&elem_starts);
+                        ASSERT_OR_HANDLE(false, NULL, "Unexpected %s in \"%s\", line %d.",
+                                         token_type_as_string(curr_tok.type),
+                                         curr_tok.source->path, curr_tok.line);
+                }
+                }
+        }
+
+        destroy_list(&elems);
+        destroy_list(&elem_starts);
+
+        return program;
+}
+
+static void set_builtin_value(enum Builtin builtin, struct ITypeList * itype_list)
+{
+        const char * builtin_name = g_builtin_names[builtin];
+
+        if (itype_in_list(itype_list, builtin_name)) {
+                struct IType * itype = instr_name_to_itype(itype_list, builtin_name);
+                itype->value = create_stack();
+
+                // Built-ins have indices -1, -2, -3 etc.
+                instr_id_t instr = builtin_to_id(builtin);
+                struct StackElem stack_elem = instr_to_stack_elem(instr, 0);
+
+                // New stacks have room for an element, so pushing can't fail.
+                (void) stack_push(itype->value, &stack_elem);
+        }
+}
+
+bool parse(struct TokenIter * tokens, struct ITypeList * itype_list)
+{
+        struct Stack * instr_substack = parse_program_stack(tokens);
+        if (!instr_substack) {
+                return false;
+        }
+
+        add_interned_itypes(itype_list);
+
+        LOG_DEBUG("Instruction types:\n");
+        log_itype_list(LOG_LVL_DEBUG, itype_list);
+        LOG_DEBUG("\n\n");
+
+        for (enum Builtin i = 0; i < BUILTINS_COUNT; ++i) {
+                set_builtin_value(i, itype_list);
+        }
+
+        struct IType * data_stack = instr_name_to_itype(itype_list, g_data_stack_str);
+        data_stack->value = create_stack();
+
+        struct StackElem instr_substack_as_stack_elem = create_substack(instr_substack, 0);
+
+        struct IType * instr_stack = instr_name_to_itype(itype_list, g_instr_stack_str);
+        instr_stack->value = create_stack();
+        (void) stack_push(instr_stack->value, &instr_substack_as_stack_elem);
+
+        LOG_DEBUG("%s (backwards for better readability):\n", g_instr_stack_str);
+        log_stack_backwards(LOG_LVL_DEBUG, instr_stack->value, itype_list);
+        LOG_DEBUG("\n\n");
+
+        return true;
+}
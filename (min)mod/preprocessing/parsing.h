@@ -1,11 +1,14 @@
-#ifndef PARSING_H
-#define PARSING_H
-
-#include "../tools/list.h"
-
-// Converts a list of tokens to a list of stacks, including the instruction
-// stack and data stack (which both have arbitrary indices within the list
-// but correct names).
-struct List parse(const struct List * tokens);
-
-#endif
+#ifndef PARSING_H
+#define PARSING_H
+
+#include "lexing.h"
+#include "../data_types/itype.h"
+
+// Converts tokens to stacks as they're lexed, adding an instruction type for
+// every instruction name and setting the values of the built-ins, the
+// instruction stack and the data stack.
+// The tokens must be lexed with "itype_list->names" as the table of names.
+// Returns "true" iff there's no errors.
+bool parse(struct TokenIter * tokens, struct ITypeList * itype_list);
+
+#endif
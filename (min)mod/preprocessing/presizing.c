@@ -0,0 +1,366 @@
+#include "presizing.h"
+#include <stddef.h>
+#include "../settings.h"
+#include "../data_types/stack.h"
+#include "../tools/list.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/ptr_map.h"
+
+// Stacks are only presized up to this many elements. Estimates of programs
+// with "IF"s in them can be well over what's needed, since the data stack
+// is assumed to lose only one element when it's not known whether it
+// loses two.
+#define MAX_PRESIZED_CAPACITY (1 << 16)
+
+// What running a stack, as a sub-stack on the instruction stack, does to
+// the depth of the stacks, at most.
+struct Summary {
+        // How many more elements the data stack has once the stack has run,
+        // which is negative if it has fewer.
+        ptrdiff_t data_stack_change;
+
+        // The most elements the data stack has beyond what it had before.
+        ptrdiff_t data_stack_rise;
+
+        // The most sub-stacks the instruction stack has beyond what it had
+        // before, counting the stack itself.
+        size_t instr_stack_rise;
+};
+
+struct StackSummary {
+        bool is_done;
+        struct Summary summary;
+};
+
+struct Analysis {
+        const struct ITypeList * itype_list;
+
+        // Cleared as soon as anything can't be analyzed.
+        bool is_analyzable;
+
+        // The stacks each instruction type may have as its value, as lists of
+        // "struct Stack *", indexed by ID.
+        struct List * values;
+
+        // Maps stacks to the index of their "struct StackSummary" in
+        // "summaries". Stacks being summarized are in it, without being done.
+        struct PtrMap summary_indices;
+        struct List summaries;
+};
+
+// Finds the values each instruction type may have from the calls of "SET"
+// in "stack", which must all be definitions of instruction types as
+// literal sub-stacks, "value. name. SET", for their values to be known.
+static void find_values(struct Analysis * analysis, const struct Stack * stack)
+{
+        const struct ITypeList * itype_list = analysis->itype_list;
+
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+
+        for (size_t i = 0; i < stack->size; ++i) {
+                const struct StackElem * elem = &stack->contents[i];
+                if (get_called_builtin(itype_list, elem) != BUILTIN_SET) {
+                        continue;
+                }
+
+                if (i + 2 >= stack->size) {
+                        analysis->is_analyzable = false;
+                        return;
+                }
+
+                const struct StackElem * name = &stack->contents[i + 1];
+                const struct StackElem * value = &stack->contents[i + 2];
+
+                if (name->type != STACK_ELEM_INSTR || name->indirection_level != 1 ||
+                    is_builtin(name->instr) || name->instr == instr_stack ||
+                    name->instr == data_stack || value->type != STACK_ELEM_SUBSTACK ||
+                    value->indirection_level == 0) {
+                        analysis->is_analyzable = false;
+                        return;
+                }
+
+                list_append(&analysis->values[name->instr], &value->substack);
+        }
+}
+
+static struct Summary summarize_stack(struct Analysis * analysis, const struct Stack * stack);
+
+// Returns what calling the instruction type "instr" does, at most, over
+// every value it may have.
+static struct Summary summarize_call(struct Analysis * analysis, instr_id_t instr)
+{
+        struct Summary summary = { 0, 0, 0 };
+
+        const struct List * values = &analysis->values[instr];
+        if (values->length == 0) {
+                analysis->is_analyzable = false;
+        }
+
+        for (size_t i = 0; analysis->is_analyzable && i < values->length; ++i) {
+                const struct Stack * value =
+                        *(struct Stack * const *) get_list_elem_const(values, i);
+                struct Summary value_summary = summarize_stack(analysis, value);
+
+                if (i == 0 || value_summary.data_stack_change > summary.data_stack_change) {
+                        summary.data_stack_change = value_summary.data_stack_change;
+                }
+                if (value_summary.data_stack_rise > summary.data_stack_rise) {
+                        summary.data_stack_rise = value_summary.data_stack_rise;
+                }
+                if (value_summary.instr_stack_rise > summary.instr_stack_rise) {
+                        summary.instr_stack_rise = value_summary.instr_stack_rise;
+                }
+        }
+
+        return summary;
+}
+
+// Returns the number of elements the call of "IF" at "idx" of "stack" pops
+// from the data stack, at most.
+static ptrdiff_t get_if_pop_count(const struct Stack * stack, size_t idx)
+{
+        if (idx + 2 < stack->size) {
+                const struct StackElem * arg = &stack->contents[idx + 1];
+                if (arg->type == STACK_ELEM_SUBSTACK && arg->indirection_level > 0 &&
+                    arg->substack->size == 0) {
+                        return 2;
+                }
+        }
+
+        return 1;
+}
+
+static struct Summary summarize_elems(struct Analysis * analysis, const struct Stack * stack)
+{
+        struct Summary summary = { 0, 0, 1 };
+
+        for (size_t i = stack->size; analysis->is_analyzable && i-- > 0;) {
+                const struct StackElem * elem = &stack->contents[i];
+
+                if (elem->indirection_level > 0) {
+                        ++summary.data_stack_change;
+                        if (summary.data_stack_change > summary.data_stack_rise) {
+                                summary.data_stack_rise = summary.data_stack_change;
+                        }
+                        continue;
+                }
+
+                struct Summary callee = { 0, 0, 0 };
+
+                if (elem->type == STACK_ELEM_SUBSTACK) {
+                        callee = summarize_stack(analysis, elem->substack);
+                } else if (elem->type != STACK_ELEM_INSTR) {
+                        analysis->is_analyzable = false;
+                        break;
+                } else {
+                        switch (get_called_builtin(analysis->itype_list, elem)) {
+                        case BUILTIN_SET:
+                                summary.data_stack_change -= 2;
+                                continue;
+                        case BUILTIN_UNWRAP:
+                                continue;
+                        case BUILTIN_IF:
+                                summary.data_stack_change -= get_if_pop_count(stack, i);
+                                continue;
+                        case BUILTINS_COUNT:
+                                callee = summarize_call(analysis, elem->instr);
+                                break;
+                        }
+                }
+
+                // The stack stays on the instruction stack while what it
+                // runs does, even once it's run out of elements.
+                ptrdiff_t data_stack_rise = summary.data_stack_change + callee.data_stack_rise;
+                if (data_stack_rise > summary.data_stack_rise) {
+                        summary.data_stack_rise = data_stack_rise;
+                }
+                if (callee.instr_stack_rise + 1 > summary.instr_stack_rise) {
+                        summary.instr_stack_rise = callee.instr_stack_rise + 1;
+                }
+                summary.data_stack_change += callee.data_stack_change;
+        }
+
+        return summary;
+}
+
+// Returns what running "stack" does, summarizing every stack only once.
+static struct Summary summarize_stack(struct Analysis * analysis, const struct Stack * stack)
+{
+        struct Summary summary = { 0, 0, 0 };
+
+        size_t index;
+        if (ptr_map_find(&analysis->summary_indices, stack, &index)) {
+                const struct StackSummary * stack_summary =
+                        get_list_elem_const(&analysis->summaries, index);
+
+                // Stacks that end up running themselves may do so any number
+                // of times.
+                if (!stack_summary->is_done) {
+                        analysis->is_analyzable = false;
+                }
+
+                return stack_summary->summary;
+        }
+
+        index = analysis->summaries.length;
+        struct StackSummary stack_summary = { false, summary };
+        list_append(&analysis->summaries, &stack_summary);
+        ptr_map_insert(&analysis->summary_indices, stack, index);
+
+        summary = summarize_elems(analysis, stack);
+
+        struct StackSummary * done_summary = get_list_elem(&analysis->summaries, index);
+        done_summary->is_done = true;
+        done_summary->summary = summary;
+
+        return summary;
+}
+
+// Estimates how deep the stacks get as the sub-stacks on the instruction
+// stack run, the top one first.
+static struct DepthEstimate estimate_frames(struct Analysis * analysis,
+                                            const struct Stack * instr_stack,
+                                            const struct Stack * data_stack)
+{
+        struct DepthEstimate estimate = { false, 0, 0 };
+
+        ptrdiff_t data_stack_depth = data_stack->size;
+        size_t max_data_stack_depth = data_stack->size;
+        size_t max_instr_stack_depth = instr_stack->size;
+
+        for (size_t i = instr_stack->size; analysis->is_analyzable && i-- > 0;) {
+                const struct StackElem * frame = &instr_stack->contents[i];
+                if (frame->type != STACK_ELEM_SUBSTACK) {
+                        analysis->is_analyzable = false;
+                        break;
+                }
+
+                struct Summary summary = summarize_stack(analysis, frame->substack);
+
+                if (data_stack_depth + summary.data_stack_rise > (ptrdiff_t) max_data_stack_depth) {
+                        max_data_stack_depth = data_stack_depth + summary.data_stack_rise;
+                }
+                if (i + summary.instr_stack_rise > max_instr_stack_depth) {
+                        max_instr_stack_depth = i + summary.instr_stack_rise;
+                }
+
+                data_stack_depth += summary.data_stack_change;
+                if (data_stack_depth < 0) {
+                        data_stack_depth = 0;
+                }
+        }
+
+        if (analysis->is_analyzable) {
+                estimate.is_known = true;
+                estimate.data_stack_depth = max_data_stack_depth;
+                estimate.instr_stack_depth = max_instr_stack_depth;
+        }
+
+        return estimate;
+}
+
+struct DepthEstimate estimate_depths(const struct ITypeList * itype_list,
+                                     const struct List * stacks,
+                                     bool are_stacks_exposed)
+{
+        struct DepthEstimate estimate = { false, 0, 0 };
+
+        // Stacks the program looks at or sets may be pushed onto and popped
+        // from in any way.
+        if (are_stacks_exposed) {
+                LOG_DEBUG("Couldn't estimate how deep the stacks get.\n");
+                return estimate;
+        }
+
+        const struct Stack * instr_stack =
+                id_to_itype_const(itype_list, find_instr_id(itype_list, g_instr_stack_str))->value;
+        const struct Stack * data_stack =
+                id_to_itype_const(itype_list, find_instr_id(itype_list, g_data_stack_str))->value;
+        if (!instr_stack || !data_stack) {
+                return estimate;
+        }
+
+        size_t itype_count = itype_list->itypes.length;
+
+        struct Analysis analysis;
+        analysis.itype_list = itype_list;
+        analysis.is_analyzable = true;
+        analysis.values = ALLOC(struct List, itype_count);
+        analysis.summary_indices = create_ptr_map();
+        analysis.summaries = create_list(sizeof(struct StackSummary), NULL);
+
+        for (size_t id = 0; id < itype_count; ++id) {
+                analysis.values[id] = create_list(sizeof(struct Stack *), NULL);
+
+                // The values the instruction types have now are only run if
+                // they're not built-ins run right away.
+                const struct IType * itype = id_to_itype_const(itype_list, id);
+                if (itype->value && itype->value != instr_stack && itype->value != data_stack &&
+                    itype->constant_builtin == BUILTINS_COUNT) {
+                        list_append(&analysis.values[id], &itype->value);
+                }
+        }
+
+        // The values of instruction types that are always built-ins are
+        // never run as sub-stacks.
+        struct PtrMap constant_values = create_ptr_map();
+        for (size_t id = 0; id < itype_count; ++id) {
+                const struct IType * itype = id_to_itype_const(itype_list, id);
+                if (itype->value && itype->constant_builtin != BUILTINS_COUNT) {
+                        if (!ptr_map_contains(&constant_values, itype->value)) {
+                                ptr_map_insert(&constant_values, itype->value, id);
+                        }
+                }
+        }
+
+        for (size_t i = 0; analysis.is_analyzable && i < stacks->length; ++i) {
+                const struct Stack * stack =
+                        *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                if (!ptr_map_contains(&constant_values, stack)) {
+                        find_values(&analysis, stack);
+                }
+        }
+
+        destroy_ptr_map(&constant_values);
+
+        estimate = estimate_frames(&analysis, instr_stack, data_stack);
+
+        for (size_t id = 0; id < itype_count; ++id) {
+                destroy_list(&analysis.values[id]);
+        }
+        FREE(analysis.values);
+        destroy_ptr_map(&analysis.summary_indices);
+        destroy_list(&analysis.summaries);
+
+        if (estimate.is_known) {
+                LOG_DEBUG("Estimated the data stack to have at most %zu elements, "
+                          "and the instruction stack %zu.\n",
+                          estimate.data_stack_depth, estimate.instr_stack_depth);
+        } else {
+                LOG_DEBUG("Couldn't estimate how deep the stacks get.\n");
+        }
+
+        return estimate;
+}
+
+void presize_stacks(struct ITypeList * itype_list, const struct DepthEstimate * estimate)
+{
+        if (!estimate->is_known) {
+                return;
+        }
+
+        struct Stack * instr_stack = instr_name_to_itype(itype_list, g_instr_stack_str)->value;
+        struct Stack * data_stack = instr_name_to_itype(itype_list, g_data_stack_str)->value;
+
+        size_t data_stack_capacity = estimate->data_stack_depth < MAX_PRESIZED_CAPACITY ?
+                                     estimate->data_stack_depth : MAX_PRESIZED_CAPACITY;
+        size_t instr_stack_capacity = estimate->instr_stack_depth < MAX_PRESIZED_CAPACITY ?
+                                      estimate->instr_stack_depth : MAX_PRESIZED_CAPACITY;
+
+        // Stacks the quota has no room for grow as they're pushed onto.
+        (void) reserve_stack(data_stack, data_stack_capacity);
+        (void) reserve_stack(instr_stack, instr_stack_capacity);
+}
@@ -0,0 +1,41 @@
+// Presizing of the data stack and the instruction stack, so that they
+// don't have to grow one reallocation at a time while a program runs.
+// How deep they get is estimated from what each sub-stack the program may
+// run does to their depth, which is found once for each sub-stack.
+
+#ifndef PRESIZING_H
+#define PRESIZING_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../data_types/itype.h"
+#include "../tools/list.h"
+
+struct DepthEstimate {
+        // Whether the program could be analyzed. Programs can't be if they
+        // set instruction types to anything but literal sub-stacks, or if
+        // instruction types end up running themselves.
+        bool is_known;
+
+        // The most elements the data stack and the instruction stack may
+        // have as the program runs, or 0 if they aren't known.
+        size_t data_stack_depth;
+        size_t instr_stack_depth;
+};
+
+// Estimates how deep the stacks of the program in "itype_list" get as it
+// runs from where it is now. "stacks" are the stacks reachable in the
+// program, from "find_reachable_stacks". Nothing is estimated if
+// "are_stacks_exposed", when the program may look at the instruction stack
+// or set the data stack, as "optimize" finds.
+struct DepthEstimate estimate_depths(const struct ITypeList * itype_list,
+                                     const struct List * stacks,
+                                     bool are_stacks_exposed);
+
+// Makes room on the stacks of the program in "itype_list" for as many
+// elements as "estimate" has, up to a point, so that they don't grow while
+// the program runs. Stacks are left as they are if the quota of the memory
+// of the thread has no room for them.
+void presize_stacks(struct ITypeList * itype_list, const struct DepthEstimate * estimate);
+
+#endif
@@ -0,0 +1,104 @@
+#include "source.h"
+#include "../tools/mem_tools.h"
+#include "../tools/log.h"
+
+static struct SourceFile * create_source_file(char * path, struct FileView contents)
+{
+        struct SourceFile * source = ALLOC(struct SourceFile, 1);
+        source->path = path;
+        source->contents = contents;
+        source->has_id = get_file_id(path, &source->id);
+
+        return source;
+}
+
+struct SourceFile * load_source_file(char * path)
+{
+        LOG_INFO("Loading \"%s\" ...\n", path);
+
+        struct FileView contents = open_file_view(path);
+        if (!is_file_view_valid(&contents)) {
+                FREE(path);
+                return NULL;
+        }
+
+        // Tokens store offsets into the contents as 32-bit integers.
+        if (contents.length > UINT32_MAX) {
+                LOG_ERROR("\"%s\" is too large to be lexed (%zu bytes).\n",
+                          path, contents.length);
+                close_file_view(&contents);
+                FREE(path);
+                return NULL;
+        }
+
+        return create_source_file(path, contents);
+}
+
+struct SourceFile * try_load_source_file(char * path)
+{
+        struct FileView contents = try_open_file_view(path);
+        if (!is_file_view_valid(&contents)) {
+                return NULL;
+        }
+
+        if (contents.length > UINT32_MAX) {
+                close_file_view(&contents);
+                return NULL;
+        }
+
+        return create_source_file(path, contents);
+}
+
+struct SourceFile * create_buffer_source_file(char * path, const char * contents, size_t length)
+{
+        if (length > UINT32_MAX) {
+                LOG_ERROR("\"%s\" is too large to be lexed (%zu bytes).\n", path, length);
+                FREE(path);
+                return NULL;
+        }
+
+        // At least one byte is allocated, so that empty contents are still
+        // valid.
+        char * data = ALLOC(char, length + 1);
+        COPY_MEMORY(data, contents, char, length);
+
+        struct FileView view;
+        view.data = data;
+        view.length = length;
+        view.is_mapped = false;
+
+        return create_source_file(path, view);
+}
+
+void destroy_source_file(struct SourceFile * source)
+{
+        close_file_view(&source->contents);
+        FREE(source->path);
+        FREE(source);
+}
+
+void destroy_source_file_ptr(void * source)
+{
+        destroy_source_file(*(struct SourceFile **) source);
+}
+
+struct List create_source_file_list(void)
+{
+        return create_list(sizeof(struct SourceFile *), destroy_source_file_ptr);
+}
+
+const void * get_source_file_key(const struct SourceFile * source, size_t * key_length)
+{
+        if (source->has_id) {
+                *key_length = sizeof(source->id);
+                return &source->id;
+        }
+
+        *key_length = strlen(source->path);
+        return source->path;
+}
+
+const char * get_slice_start(const struct SourceFile * source, struct SourceSlice slice)
+{
+        return source->contents.data + slice.offset;
+}
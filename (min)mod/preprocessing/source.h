@@ -0,0 +1,64 @@
+// Source files, loaded into memory once. Tokens refer to their contents
+// rather than copying them, so a "struct SourceFile" must outlive every
+// token lexed from it.
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "../tools/list.h"
+#include "../tools/platform.h"
+
+struct SourceFile {
+        char * path;
+
+        // Not null-terminated, since it may be a memory-mapped file.
+        struct FileView contents;
+
+        // Which file was loaded, regardless of "path". Only valid if "has_id".
+        struct FileId id;
+        bool has_id;
+};
+
+// A range of characters within the contents of a "struct SourceFile".
+struct SourceSlice {
+        uint32_t offset;
+        uint32_t length;
+};
+
+// Loads the file at "path", which must be "ALLOC"ed and is owned by the
+// returned value from then on.
+// Returns "NULL" if the file can't be read, in which case "path" is freed.
+struct SourceFile * load_source_file(char * path);
+
+// Like "load_source_file", but nothing is logged if the file can't be read,
+// so that it's safe to call from any thread. "path" is only owned by the
+// returned value if the file is loaded.
+struct SourceFile * try_load_source_file(char * path);
+
+// Creates a source file from a copy of the "length" bytes at "contents",
+// as if they were loaded from "path", which must be "ALLOC"ed and is owned
+// by the returned value from then on.
+// Returns "NULL" if the contents are too large to be lexed, in which case
+// "path" is freed.
+struct SourceFile * create_buffer_source_file(char * path, const char * contents, size_t length);
+
+void destroy_source_file(struct SourceFile * source);
+
+void destroy_source_file_ptr(void * source);
+
+// Creates a list of "struct SourceFile *"s, which are destroyed along with
+// the list.
+struct List create_source_file_list(void);
+
+// Returns bytes identifying the file "source" was loaded from, and stores
+// their length in "key_length". Uses "source->id" if there is one, and the
+// path otherwise.
+const void * get_source_file_key(const struct SourceFile * source, size_t * key_length);
+
+// Returns a pointer to the first character of "slice" within "source".
+// The characters aren't null-terminated.
+const char * get_slice_start(const struct SourceFile * source, struct SourceSlice slice);
+
+#endif
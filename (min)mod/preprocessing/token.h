@@ -1,42 +1,48 @@
-#ifndef TOKEN_H
-#define TOKEN_H
-
-#include "../tools/list.h"
-
-enum TokenType {
-        TOK_INVALID,
-        TOK_WHITESPACE,
-        TOK_COMMENT,
-        TOK_IMPORT,
-        TOK_INSTR,
-        TOK_INDIRECTION,
-        TOK_STACK_OPEN,
-        TOK_STACK_CLOSE
-};
-
-struct Token {
-        enum TokenType type;
-        union {
-                char * instr_name;
-                char * import_file;
-                int indirection_level;
-        };
-        const char * file;
-        int line;
-};
-
-struct Token create_token(enum TokenType type, const char * file, int line);
-
-struct Token create_invalid_token(void);
-
-void destroy_token(struct Token * token);
-
-void destroy_token_void_ptr(void * token);
-
-const char * token_type_as_string(enum TokenType token_type);
-
-void log_token(int log_level, const struct Token * tok);
-
-void log_token_list(int log_level, const struct List * list);
-
-#endif
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include "../tools/list.h"
+#include "../tools/str_table.h"
+#include "source.h"
+
+enum TokenType {
+        TOK_INVALID,
+        TOK_IMPORT,
+        TOK_INSTR,
+        TOK_INDIRECTION,
+        TOK_STACK_OPEN,
+        TOK_STACK_CLOSE,
+
+        // There are no tokens left.
+        TOK_END
+};
+
+struct Token {
+        enum TokenType type;
+        union {
+                // Interned by the lexer, so it's also the ID of the
+                // instruction type named by the token.
+                str_id_t name_id;
+                // Set instead of "name_id" by lexers that can't intern names,
+                // until the name is interned.
+                struct SourceSlice name;
+                // The path between the import quotes, as written.
+                struct SourceSlice import_path;
+                int indirection_level;
+        };
+        const struct SourceFile * source;
+        int line;
+};
+
+struct Token create_token(enum TokenType type, const struct SourceFile * source, int line);
+
+struct Token create_invalid_token(void);
+
+const char * token_type_as_string(enum TokenType token_type);
+
+// "names" must be the table the token names were interned in.
+void log_token(int log_level, const struct Token * tok, const struct StrTable * names);
+
+void log_token_list(int log_level, const struct List * list, const struct StrTable * names);
+
+#endif
@@ -0,0 +1,137 @@
+#include "token_buffer.h"
+#include <string.h>
+#include "char_class.h"
+#include "../settings.h"
+#include "../tools/byte.h"
+
+struct TokenBuffer create_token_buffer(const struct SourceFile * source)
+{
+        struct TokenBuffer buffer;
+        buffer.source = source;
+        buffer.kinds = create_list(sizeof(byte_t), NULL);
+        buffer.payloads = create_list(sizeof(uint32_t), NULL);
+        buffer.line_runs = create_list(sizeof(struct LineRun), NULL);
+
+        return buffer;
+}
+
+void destroy_token_buffer(struct TokenBuffer * buffer)
+{
+        destroy_list(&buffer->kinds);
+        destroy_list(&buffer->payloads);
+        destroy_list(&buffer->line_runs);
+}
+
+size_t get_token_buffer_length(const struct TokenBuffer * buffer)
+{
+        return buffer->kinds.length;
+}
+
+static uint32_t get_token_payload(const struct Token * token)
+{
+        switch (token->type) {
+        case TOK_INSTR:
+                return token->name.offset;
+        case TOK_IMPORT:
+                return token->import_path.offset;
+        case TOK_INDIRECTION:
+                return token->indirection_level;
+        default:
+                return 0;
+        }
+}
+
+void token_buffer_append(struct TokenBuffer * buffer, const struct Token * token)
+{
+        ASSERT(token->source == buffer->source, "Token from \"%s\" added to buffer of \"%s\".",
+               token->source->path, buffer->source->path);
+
+        size_t line_run_count = buffer->line_runs.length;
+        if (line_run_count == 0 ||
+            ((struct LineRun *) get_list_elem(&buffer->line_runs, line_run_count - 1))->line
+            != token->line) {
+
+                struct LineRun line_run;
+                line_run.first_token = buffer->kinds.length;
+                line_run.line = token->line;
+                list_append(&buffer->line_runs, &line_run);
+        }
+
+        byte_t kind = token->type;
+        uint32_t payload = get_token_payload(token);
+        list_append(&buffer->kinds, &kind);
+        list_append(&buffer->payloads, &payload);
+}
+
+struct TokenBufferReader create_token_buffer_reader(void)
+{
+        struct TokenBufferReader reader;
+        reader.token_index = 0;
+        reader.line_run_index = 0;
+
+        return reader;
+}
+
+// Returns the length of the instruction name at "offset" in the source
+// file of "buffer".
+static uint32_t measure_instr_name(const struct TokenBuffer * buffer, uint32_t offset)
+{
+        const char * begin = buffer->source->contents.data + offset;
+        const char * end = buffer->source->contents.data + buffer->source->contents.length;
+
+        return skip_instr_chs(begin, end) - begin;
+}
+
+// Returns the length of the import path at "offset" in the source file of
+// "buffer".
+static uint32_t measure_import_path(const struct TokenBuffer * buffer, uint32_t offset)
+{
+        const char * begin = buffer->source->contents.data + offset;
+        const char * end = buffer->source->contents.data + buffer->source->contents.length;
+
+        // The lexer made sure the import is closed.
+        const char * import_close = memchr(begin, g_import_close_ch, end - begin);
+        return import_close - begin;
+}
+
+struct Token read_token_buffer(const struct TokenBuffer * buffer, struct TokenBufferReader * reader)
+{
+        size_t index = reader->token_index;
+        ASSERT(index < get_token_buffer_length(buffer), "No tokens left to read.");
+
+        // Move on to the next line run if this token starts it.
+        size_t next_run_index = reader->line_run_index + 1;
+        if (next_run_index < buffer->line_runs.length &&
+            ((const struct LineRun *) get_list_elem_const(&buffer->line_runs, next_run_index))
+            ->first_token == index) {
+
+                reader->line_run_index = next_run_index;
+        }
+
+        const struct LineRun * line_run = get_list_elem_const(&buffer->line_runs,
+                                                              reader->line_run_index);
+        enum TokenType type = *(const byte_t *) get_list_elem_const(&buffer->kinds, index);
+        uint32_t payload = *(const uint32_t *) get_list_elem_const(&buffer->payloads, index);
+
+        struct Token token = create_token(type, buffer->source, line_run->line);
+
+        switch (type) {
+        case TOK_INSTR:
+                token.name.offset = payload;
+                token.name.length = measure_instr_name(buffer, payload);
+                break;
+        case TOK_IMPORT:
+                token.import_path.offset = payload;
+                token.import_path.length = measure_import_path(buffer, payload);
+                break;
+        case TOK_INDIRECTION:
+                token.indirection_level = payload;
+                break;
+        default:
+                break;
+        }
+
+        ++reader->token_index;
+
+        return token;
+}
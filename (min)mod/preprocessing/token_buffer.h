@@ -0,0 +1,59 @@
+// Tokens stored compactly, as a structure of arrays rather than an array of
+// "struct Token"s. Each token takes 5 bytes, and lines are stored once for
+// every line with tokens on it rather than once for every token.
+// All the tokens must belong to the same source file.
+
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+
+#include <stdint.h>
+#include "../tools/list.h"
+#include "source.h"
+#include "token.h"
+
+// The tokens from "first_token" up to the next run are on "line".
+struct LineRun {
+        uint32_t first_token;
+        int line;
+};
+
+struct TokenBuffer {
+        const struct SourceFile * source;
+
+        // The "enum TokenType" of each token, as a "byte_t".
+        struct List kinds;
+
+        // A "uint32_t" for each token: the indirection level of
+        // "TOK_INDIRECTION"s, and the offset of the name or the import path
+        // in the source file for "TOK_INSTR"s and "TOK_IMPORT"s. Their lengths
+        // are measured again when the tokens are read.
+        struct List payloads;
+
+        // "struct LineRun"s, only needed to turn the tokens back into
+        // "struct Token"s.
+        struct List line_runs;
+};
+
+// Where "read_token_buffer" is in a token buffer.
+struct TokenBufferReader {
+        size_t token_index;
+        size_t line_run_index;
+};
+
+struct TokenBuffer create_token_buffer(const struct SourceFile * source);
+
+void destroy_token_buffer(struct TokenBuffer * buffer);
+
+size_t get_token_buffer_length(const struct TokenBuffer * buffer);
+
+// "token" must be lexed from the source file of "buffer", with the names of
+// "TOK_INSTR"s in "token->name" rather than interned, and lines must never
+// decrease.
+void token_buffer_append(struct TokenBuffer * buffer, const struct Token * token);
+
+struct TokenBufferReader create_token_buffer_reader(void);
+
+// Returns the next token of "buffer", which must have tokens left.
+struct Token read_token_buffer(const struct TokenBuffer * buffer, struct TokenBufferReader * reader);
+
+#endif
@@ -0,0 +1,153 @@
+#include "verifying.h"
+#include "../data_types/stack.h"
+#include "../tools/list.h"
+#include "../tools/log.h"
+#include "../tools/ptr_map.h"
+
+// Returns "true" if "elem" pushes a copy of itself, with one level of
+// indirection less, onto the data stack when it runs.
+static bool is_pushed(const struct StackElem * elem)
+{
+        return elem->indirection_level > 0;
+}
+
+// Returns "true" if the call at "idx" of "stack" is proved to pass the
+// checks of its built-in by the elements run right before it, which are
+// the ones above it.
+static bool is_verified_call(const struct ITypeList * itype_list,
+                             const struct Stack * stack,
+                             size_t idx)
+{
+        enum Builtin builtin = get_called_builtin(itype_list, &stack->contents[idx]);
+        if (builtin == BUILTINS_COUNT || idx + 1 >= stack->size) {
+                return false;
+        }
+
+        const struct StackElem * arg1 = &stack->contents[idx + 1];
+        const struct StackElem * arg2 = idx + 2 < stack->size ? &stack->contents[idx + 2] : NULL;
+
+        if (!is_pushed(arg1)) {
+                return false;
+        }
+
+        bool is_arg1_stack = arg1->type == STACK_ELEM_SUBSTACK ||
+                             arg1->type == STACK_ELEM_STACK_REF;
+
+        switch (builtin) {
+        case BUILTIN_SET:
+                return arg1->type == STACK_ELEM_INSTR && arg1->indirection_level == 1 &&
+                       !is_builtin(arg1->instr) &&
+                       arg2 && is_pushed(arg2) &&
+                       (arg2->type != STACK_ELEM_INSTR || arg2->indirection_level == 1);
+        case BUILTIN_UNWRAP:
+                return is_arg1_stack;
+        case BUILTIN_IF:
+                // Whether the stack is empty is only known as it runs.
+                return is_arg1_stack && arg2 && is_pushed(arg2);
+        case BUILTINS_COUNT:
+                break;
+        }
+
+        return false;
+}
+
+// Returns "true" if no stack the program runs can be run as the data stack
+// or the instruction stack, so that the elements pushed before a call are
+// pushed right onto the data stack, without running in between.
+// Stacks run as code are sub-stacks, run in place or from copies of the
+// values of instruction types, while stacks run as the data stack or the
+// instruction stack are values. Running a program doesn't make values
+// sub-stacks or the other way around, since only copies are made of
+// either, so it's enough for none of them to be both. Except through the
+// instruction stack, which runs the sub-stacks on it, and through "SET"ting
+// the data stack, which makes a value it's set to the data stack, to be
+// pushed onto and run again, so nothing is verified if "are_stacks_exposed".
+static bool is_verifiable(const struct ITypeList * itype_list, const struct List * stacks,
+                          bool are_stacks_exposed)
+{
+        if (are_stacks_exposed) {
+                return false;
+        }
+
+        struct PtrMap substacks = create_ptr_map();
+
+        for (size_t i = 0; i < stacks->length; ++i) {
+                const struct Stack * stack =
+                        *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_SUBSTACK &&
+                            !ptr_map_contains(&substacks, elem->substack)) {
+                                ptr_map_insert(&substacks, elem->substack, 0);
+                        }
+                }
+        }
+
+        bool is_verifiable = true;
+
+        for (size_t id = 0; is_verifiable && id < itype_list->itypes.length; ++id) {
+                const struct Stack * value = id_to_itype_const(itype_list, id)->value;
+                if (value && ptr_map_contains(&substacks, value)) {
+                        is_verifiable = false;
+                }
+        }
+
+        for (size_t i = 0; is_verifiable && i < stacks->length; ++i) {
+                const struct Stack * stack =
+                        *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        if (elem->type == STACK_ELEM_STACK_REF &&
+                            ptr_map_contains(&substacks, elem->stack_ref)) {
+                                is_verifiable = false;
+                        }
+                }
+        }
+
+        destroy_ptr_map(&substacks);
+
+        return is_verifiable;
+}
+
+#if LOGGABLE(LOG_LVL_DEBUG)
+// Logs how many of the calls of built-ins in "stacks" were verified.
+static void log_verified_calls(const struct ITypeList * itype_list, const struct List * stacks)
+{
+        size_t call_count = 0;
+        size_t verified_count = 0;
+
+        for (size_t i = 0; i < stacks->length; ++i) {
+                const struct Stack * stack =
+                        *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        const struct StackElem * elem = &stack->contents[j];
+                        call_count += get_called_builtin(itype_list, elem) != BUILTINS_COUNT;
+                        verified_count += elem->is_verified;
+                }
+        }
+
+        LOG_DEBUG("Verified %zu of %zu calls of built-ins.\n", verified_count, call_count);
+}
+#else
+#define log_verified_calls(itype_list, stacks)
+#endif
+
+void verify(struct ITypeList * itype_list, const struct List * stacks, bool are_stacks_exposed)
+{
+        bool is_program_verifiable = is_verifiable(itype_list, stacks, are_stacks_exposed);
+
+        for (size_t i = 0; i < stacks->length; ++i) {
+                struct Stack * stack = *(struct Stack * const *) get_list_elem_const(stacks, i);
+
+                for (size_t j = 0; j < stack->size; ++j) {
+                        struct StackElem * elem = &stack->contents[j];
+                        elem->is_verified = is_program_verifiable &&
+                                            is_verified_call(itype_list, stack, j);
+                }
+        }
+
+        log_verified_calls(itype_list, stacks);
+}
@@ -0,0 +1,24 @@
+// A verifier proving, before a program runs, that calls of built-ins pass
+// the checks the built-ins make of their arguments, so that "run" can
+// skip them. Only the elements pushed right before a call are looked at,
+// as they're pushed onto the data stack as they are, one after another,
+// with nothing else running in between.
+
+#ifndef VERIFYING_H
+#define VERIFYING_H
+
+#include <stdbool.h>
+#include "../data_types/itype.h"
+#include "../tools/list.h"
+
+// Marks the calls of built-ins in the program in "itype_list" as verified
+// or not, finding instruction types that are built-ins as "optimize" does.
+// "stacks" are the stacks reachable in the program, from
+// "find_reachable_stacks".
+// Nothing is verified in programs whose stacks may be run as the data
+// stack, or as the instruction stack, where elements pushed run next, nor
+// if "are_stacks_exposed", when the program may look at the instruction
+// stack or set the data stack, as "optimize" finds.
+void verify(struct ITypeList * itype_list, const struct List * stacks, bool are_stacks_exposed);
+
+#endif
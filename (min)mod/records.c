@@ -0,0 +1,180 @@
+#include "records.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "settings.h"
+#include "data_types/itype.h"
+#include "running/running.h"
+#include "tools/mem_tools.h"
+#include "tools/platform.h"
+
+static void free_path(void * str)
+{
+        FREE(*(char **) str);
+}
+
+static bool is_comment(const char * line, size_t length)
+{
+        size_t comment_length = strlen(g_comment_str);
+        return length >= comment_length && strncmp(line, g_comment_str, comment_length) == 0;
+}
+
+bool read_manifest(const char * manifest_path, struct List * file_paths)
+{
+        *file_paths = create_list(sizeof(char *), free_path);
+
+        // Loaded quietly, since records may be the only thing written to the
+        // console.
+        struct FileView manifest = try_open_file_view(manifest_path);
+        if (!is_file_view_valid(&manifest)) {
+                return false;
+        }
+
+        const char * contents = manifest.data;
+        size_t length = manifest.length;
+        size_t line_start = 0;
+        while (line_start < length) {
+                size_t line_end = line_start;
+                while (line_end < length && contents[line_end] != '\n') {
+                        ++line_end;
+                }
+
+                // Lines may end in "\r\n" too.
+                size_t path_length = line_end - line_start;
+                if (path_length > 0 && contents[line_end - 1] == '\r') {
+                        --path_length;
+                }
+
+                const char * line = &contents[line_start];
+                if (path_length > 0 && !is_comment(line, path_length)) {
+                        char * file_path = ALLOC(char, path_length + 1);
+                        COPY_MEMORY(file_path, line, char, path_length);
+                        file_path[path_length] = '\0';
+                        list_append(file_paths, &file_path);
+                }
+
+                line_start = line_end + 1;
+        }
+
+        close_file_view(&manifest);
+
+        return true;
+}
+
+void append_str(struct List * chars, const char * str)
+{
+        for (; *str != '\0'; ++str) {
+                list_append(chars, str);
+        }
+}
+
+void append_json_str(struct List * chars, const char * str)
+{
+        append_str(chars, "\"");
+        for (; *str != '\0'; ++str) {
+                unsigned char ch = *str;
+                if (ch == '"') {
+                        append_str(chars, "\\\"");
+                } else if (ch == '\\') {
+                        append_str(chars, "\\\\");
+                } else if (ch == '\n') {
+                        append_str(chars, "\\n");
+                } else if (ch < 0x20) {
+                        char escaped[8];
+                        snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                        append_str(chars, escaped);
+                } else {
+                        list_append(chars, str);
+                }
+        }
+        append_str(chars, "\"");
+}
+
+static void append_stacks(struct List * chars, const struct MinmodContext * context)
+{
+        append_str(chars, "{");
+
+        bool is_first = true;
+        size_t stack_count = get_minmod_stack_count(context);
+        for (size_t i = 0; i < stack_count; ++i) {
+                const char * name = get_minmod_stack_name(context, i);
+                if (!is_itype_logged(name)) {
+                        continue;
+                }
+
+                if (!is_first) {
+                        append_str(chars, ", ");
+                }
+                is_first = false;
+
+                append_json_str(chars, name);
+                append_str(chars, ": ");
+
+                char * stack = format_minmod_stack(context, name);
+                if (stack) {
+                        append_json_str(chars, stack);
+                        free_minmod_str(stack);
+                } else {
+                        append_str(chars, "null");
+                }
+        }
+
+        append_str(chars, "}");
+}
+
+void append_run_record(struct List * chars,
+                       size_t index,
+                       const char * file_path,
+                       const struct MinmodContext * context,
+                       const char * log,
+                       uint64_t time_ns)
+{
+        char index_str[32];
+        snprintf(index_str, sizeof(index_str), "{\"index\": %zu, \"program\": ", index);
+        append_str(chars, index_str);
+        append_json_str(chars, file_path);
+
+        int exit_code;
+        switch (get_minmod_status(context)) {
+        case MINMOD_FINISHED:
+                exit_code = EXIT_SUCCESS;
+                break;
+        case MINMOD_LIMIT_EXCEEDED:
+                exit_code = EXIT_LIMIT_EXCEEDED;
+                break;
+        case MINMOD_OUT_OF_MEMORY:
+                exit_code = EXIT_OUT_OF_MEMORY;
+                break;
+        default:
+                exit_code = EXIT_FAILURE;
+                break;
+        }
+
+        char numbers[128];
+        snprintf(numbers, sizeof(numbers),
+                 ", \"exit_code\": %d, \"steps\": %" PRIu64 ", \"time_ns\": %" PRIu64
+                 ", \"peak_bytes\": %zu",
+                 exit_code, get_minmod_step_count(context), time_ns,
+                 get_minmod_peak_memory(context));
+        append_str(chars, numbers);
+
+        size_t data_stack_depth;
+        size_t instr_stack_depth;
+        if (get_minmod_depth_estimate(context, &data_stack_depth, &instr_stack_depth)) {
+                snprintf(numbers, sizeof(numbers),
+                         ", \"estimated_depths\": {\"%s\": %zu, \"%s\": %zu}",
+                         g_data_stack_str, data_stack_depth, g_instr_stack_str, instr_stack_depth);
+                append_str(chars, numbers);
+        } else {
+                append_str(chars, ", \"estimated_depths\": null");
+        }
+
+        snprintf(numbers, sizeof(numbers), ", \"grow_count\": %zu, \"stacks\": ",
+                 get_minmod_grow_count(context));
+        append_str(chars, numbers);
+
+        append_stacks(chars, context);
+        append_str(chars, ", \"log\": ");
+        append_json_str(chars, log);
+        append_str(chars, "}\n");
+}
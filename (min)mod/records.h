@@ -0,0 +1,50 @@
+// Manifests of programs, and records of how the programs ran, as used by
+// batch and server mode.
+// A manifest has the path of one program per line. Empty lines and lines
+// starting with the comment string of (min)mod are skipped.
+// A record is a JSON object on a line of its own. For example:
+// {"index": 0, "program": "a.(m)m", "exit_code": 0, "steps": 12, "time_ns": 3400,
+//  "peak_bytes": 512, "estimated_depths": {"DS": 4, "IS": 3}, "grow_count": 0,
+//  "stacks": {"IS": "()", "DS": "(a b)"}, "log": ""}
+// where "index" is the line of the program among the programs of the
+// manifest, "exit_code" is what (min)mod would exit with after running the
+// program on its own, "peak_bytes" the most memory the stacks of the
+// program took at once, "estimated_depths" the most elements the data stack
+// and the instruction stack were estimated to have, or "null" if the program
+// couldn't be analyzed, "grow_count" how many times stacks grew anyway,
+// "stacks" has the stacks a run would log at the end, uninitialized ones
+// being "null", and "log" is everything logged while loading and running
+// the program, such as its errors.
+
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lib/minmod.h"
+#include "tools/list.h"
+
+// Reads the paths of the programs in the manifest at "manifest_path" into a
+// list of "ALLOC"ed "char *"s, which are freed along with the list.
+// Returns "false" without logging anything if the manifest can't be read,
+// in which case the list is empty but still has to be destroyed.
+bool read_manifest(const char * manifest_path, struct List * file_paths);
+
+// Appends "str" to the "char"s in "chars", without a null terminator.
+void append_str(struct List * chars, const char * str);
+
+// Appends "str" as a JSON string, escaping what must be escaped.
+void append_json_str(struct List * chars, const char * str);
+
+// Appends the record of the program at "index" in the manifest, which ran
+// in "context", to "chars". "log" is what was logged while loading and
+// running it, and "time_ns" how long that took.
+void append_run_record(struct List * chars,
+                       size_t index,
+                       const char * file_path,
+                       const struct MinmodContext * context,
+                       const char * log,
+                       uint64_t time_ns);
+
+#endif
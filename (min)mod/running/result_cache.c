@@ -0,0 +1,160 @@
+#include "result_cache.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../preprocessing/source.h"
+#include "../settings.h"
+#include "../tools/hash.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/os.h"
+#include "../tools/platform.h"
+
+// Must be increased whenever the layout of results changes, or the way
+// programs run or stacks are logged does.
+#define RESULT_VERSION 1
+
+// Results are written in the byte order of the machine writing them, so
+// the mark reads differently on machines with another byte order.
+#define RESULT_BYTE_ORDER_MARK 0x01020304u
+
+// Hashing the files once more from another starting point tells apart
+// programs whose files hash the same from the first one.
+#define RESULT_CHECK_SEED 0x9e3779b97f4a7c15ULL
+
+static const char s_result_magic[8] = "(m)mres";
+
+// A result is this header followed by the "result_length" characters of
+// the result, without a null terminator.
+struct ResultHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order_mark;
+
+        uint64_t file_count;
+        uint64_t closure_check;
+        uint64_t result_length;
+};
+
+// Hashes the lengths and the contents of "sources", one after the other.
+// The lengths are hashed too, so that moving characters from the end of one
+// file to the start of the next one changes the hash.
+static uint64_t hash_closure(const struct List * sources, uint64_t seed)
+{
+        uint64_t hash = seed;
+        for (size_t i = 0; i < sources->length; ++i) {
+                const struct SourceFile * source;
+                source = *(struct SourceFile * const *) get_list_elem_const(sources, i);
+
+                uint64_t length = source->contents.length;
+                hash = hash_bytes(&length, sizeof(length), hash);
+                hash = hash_bytes(source->contents.data, source->contents.length, hash);
+        }
+
+        return hash;
+}
+
+char * get_result_path(const struct List * sources, const char * cache_dir)
+{
+        char sep = OS == OS_WINDOWS ? '\\' : '/';
+        unsigned long long closure_hash = hash_closure(sources, HASH_SEED);
+
+        size_t path_length = strlen(cache_dir) + 1 + 16 + 1 + strlen(g_result_file_ext);
+        char * result_path = ALLOC(char, path_length + 1);
+        snprintf(result_path, path_length + 1, "%s%c%016llx.%s",
+                 cache_dir, sep, closure_hash, g_result_file_ext);
+        return result_path;
+}
+
+static struct ResultHeader create_result_header(const struct List * sources, size_t result_length)
+{
+        struct ResultHeader header;
+        SET_MEMORY(&header, 0, struct ResultHeader, 1);
+        memcpy(header.magic, s_result_magic, sizeof(header.magic));
+        header.version = RESULT_VERSION;
+        header.byte_order_mark = RESULT_BYTE_ORDER_MARK;
+        header.file_count = sources->length;
+        header.closure_check = hash_closure(sources, RESULT_CHECK_SEED);
+        header.result_length = result_length;
+
+        return header;
+}
+
+char * load_result(const char * result_path, const struct List * sources)
+{
+        struct FileView contents = try_open_file_view(result_path);
+        if (!is_file_view_valid(&contents)) {
+                LOG_INFO("There's no result \"%s\".\n", result_path);
+                return NULL;
+        }
+
+        // Everything but the length of the result has to match.
+        struct ResultHeader expected = create_result_header(sources, 0);
+        struct ResultHeader header;
+        bool is_valid = contents.length >= sizeof(header);
+        if (is_valid) {
+                memcpy(&header, contents.data, sizeof(header));
+                expected.result_length = header.result_length;
+                is_valid = MEMORY_EQUALS(&header, &expected, struct ResultHeader, 1) &&
+                           header.result_length == contents.length - sizeof(header);
+        }
+
+        char * result = NULL;
+        if (is_valid) {
+                LOG_INFO("Loading the result \"%s\" ...\n", result_path);
+
+                result = ALLOC(char, header.result_length + 1);
+                memcpy(result, contents.data + sizeof(header), header.result_length);
+                result[header.result_length] = '\0';
+        } else {
+                LOG_INFO("\"%s\" isn't a valid result of the program.\n", result_path);
+        }
+
+        close_file_view(&contents);
+
+        return result;
+}
+
+bool save_result(const char * result_path, const struct List * sources, const char * result)
+{
+        LOG_INFO("Saving the result \"%s\" ...\n", result_path);
+
+        size_t tmp_path_length = strlen(result_path) + strlen(".tmp");
+        char * tmp_path = ALLOC(char, tmp_path_length + 1);
+        snprintf(tmp_path, tmp_path_length + 1, "%s.tmp", result_path);
+
+        size_t result_length = strlen(result);
+        struct ResultHeader header = create_result_header(sources, result_length);
+
+        bool is_saved = false;
+
+        FILE * file = fopen(tmp_path, "wb");
+        if (file) {
+                is_saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                           fwrite(result, sizeof(char), result_length, file) == result_length;
+
+                // Closing the file may be what writes it.
+                if (fclose(file) != 0) {
+                        is_saved = false;
+                }
+        }
+
+        // Unlike on POSIX systems, files can't be renamed to the names of
+        // existing files on Windows.
+        if (is_saved && OS == OS_WINDOWS) {
+                (void) remove(result_path);
+        }
+
+        if (is_saved) {
+                is_saved = rename(tmp_path, result_path) == 0;
+        }
+
+        if (!is_saved) {
+                (void) remove(tmp_path);
+                LOG_WARNING("Couldn't save the result \"%s\".\n", result_path);
+        }
+
+        FREE(tmp_path);
+
+        return is_saved;
+}
@@ -0,0 +1,31 @@
+// Results of programs, cached on disk so that a program that was run before
+// doesn't have to be parsed and run again.
+// Programs have no input, so what a program ends with only depends on the
+// contents of the files it's made of, which is what results are looked up
+// by. Only the final stacks of programs that finished successfully are
+// cached, as they're logged at the end of a run.
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdbool.h>
+#include "../tools/list.h"
+
+// Returns the path of the result in "cache_dir" of the program made of
+// "sources", the "struct SourceFile *"s of the program itself and of every
+// file it imports, directly or indirectly, in the order they're imported.
+// The returned path is "ALLOC"ed.
+char * get_result_path(const struct List * sources, const char * cache_dir);
+
+// Returns the result at "result_path", null-terminated and "ALLOC"ed, or
+// "NULL" if there's none, or if it's corrupted, from another version of
+// (min)mod or of another program.
+char * load_result(const char * result_path, const struct List * sources);
+
+// Writes "result" to "result_path" as the result of the program made of
+// "sources".
+// Returns "false" if the result can't be written, in which case nothing is
+// written at all.
+bool save_result(const char * result_path, const struct List * sources, const char * result);
+
+#endif
@@ -1,318 +1,503 @@
-// This file became a little uglier every time an error was fixed.
-// Now, I just have to pray that the errors are all gone.
-
-#include "running.h"
-#include <stdio.h>
-#include "../settings.h"
-#include "../data_types/stack.h"
-#include "../tools/mem_tools.h"
-#include "../tools/log.h"
-
-#if OS == OS_WINDOWS
-#include <conio.h>
-#endif
-
-typedef enum ErrState (*builtin_func_t)(struct List * itype_list,
-                                        instr_id_t data_stack_instr,
-                                        instr_id_t instr_stack_instr);
-
-static struct Stack * get_stack_elem_val(struct StackElem * elem, struct List * itype_list)
-{
-        switch (elem->type) {
-        case STACK_ELEM_INVALID:
-                break;
-        case STACK_ELEM_INSTR: {
-                if (is_builtin(elem->instr)) {
-                        return NULL;
-                }
-                struct IType * itype = get_list_elem(itype_list, elem->instr);
-                return itype->value;
-        }
-        case STACK_ELEM_SUBSTACK:
-                return elem->substack;
-        case STACK_ELEM_STACK_REF:
-                return elem->stack_ref;
-        }
-
-        ASSERT(false, "Invalid stack element type %d.", (int) elem->type);
-        return NULL;
-}
-
-static void pop_from_instr_substack(struct Stack * instr_stack, struct Stack * instr_substack)
-{
-        if (instr_substack->size == 0) {
-                stack_pop(instr_stack);
-        } else {
-                stack_pop(instr_substack);
-        }
-}
-
-static enum ErrState set_instr(struct List * itype_list,
-                               instr_id_t data_stack_instr,
-                               instr_id_t instr_stack_instr)
-{
-        struct IType * data_stack_itype = get_list_elem(itype_list, data_stack_instr);
-        struct Stack * data_stack = data_stack_itype->value;
-
-        ASSERT_OR_HANDLE(data_stack->size >= 2, ERR_FAILURE,
-                         "%s instruction requires data stack with 2 elements or more, got %d.",
-                         g_builtin_names[0], data_stack->size);
-
-        instr_id_t instr;
-
-        struct StackElem * arg1 = stack_peek(data_stack, 0);
-
-        ASSERT_OR_HANDLE(arg1->type == STACK_ELEM_INSTR, ERR_FAILURE,
-                         "First argument of %s instruction must be an instruction.",
-                         g_builtin_names[0]);
-
-        ASSERT_OR_HANDLE(arg1->indirection_level == 0, ERR_FAILURE, "First argument of %s "
-                         "instruction cannot have any level of indirection.",
-                         g_builtin_names[0]);
-
-        ASSERT_OR_HANDLE(!is_builtin(arg1->instr), ERR_FAILURE, "Cannot set a built-in");
-
-        instr = arg1->instr;
-
-        struct StackElem * arg2 = stack_peek(data_stack, 1);
-
-        ASSERT_OR_HANDLE(arg2->type != STACK_ELEM_INSTR || arg2->indirection_level == 0,
-                         ERR_FAILURE,
-                         "Second argument of %s instruction must have an indirection level of 0.",
-                         g_builtin_names[0]);
-
-        struct Stack * new_val = get_stack_elem_val(arg2, itype_list);
-        if (arg2->type == STACK_ELEM_SUBSTACK) {
-                new_val = deepcopy_stack(new_val);
-        } else if (new_val) {
-                add_stack_reference(new_val);
-        }
-
-        // Must happen before a stack changes its value in case "data_stack"
-        // changes.
-        stack_pop(data_stack);
-        stack_pop(data_stack);
-
-        struct IType * itype = get_list_elem(itype_list, instr);
-        if (itype->value) {
-                remove_stack_reference(itype->value);
-        }
-        itype->value = new_val;
-
-        return ERR_SUCCESS;
-}
-
-static enum ErrState unwrap_instr(struct List * itype_list,
-                                  instr_id_t data_stack_instr,
-                                  instr_id_t instr_stack_instr)
-{
-        struct IType * data_stack_itype = get_list_elem(itype_list, data_stack_instr);
-        struct Stack * data_stack = data_stack_itype->value;
-
-        ASSERT_OR_HANDLE(data_stack->size >= 1, ERR_FAILURE,
-                         "%s instruction requires data stack with 2 elements or more, got %d.",
-                         g_builtin_names[1], data_stack->size);
-
-        struct StackElem * arg = stack_peek(data_stack, 0);
-
-        ASSERT_OR_HANDLE(!(arg->type == STACK_ELEM_INSTR && is_builtin(arg->instr)), ERR_FAILURE,
-                         "Cannot unwrap a built-in");
-
-        struct Stack * arg_val = get_stack_elem_val(arg, itype_list);
-
-        if (arg->type == STACK_ELEM_INSTR && !arg_val) {
-                const struct IType * itype = get_list_elem(itype_list, arg->instr);
-
-                ASSERT_OR_HANDLE(false, ERR_FAILURE,
-                                 "Cannot unwrap uninitialized instruction \"%s\".", itype->name);
-        }
-
-        if (arg->type == STACK_ELEM_SUBSTACK) {
-                arg_val = deepcopy_stack(arg_val);
-        } else {
-                add_stack_reference(arg_val);
-        }
-
-        struct StackElem new_stack_elem = create_stack_ref(arg_val, arg->indirection_level);
-
-        stack_pop(data_stack);
-        stack_push(data_stack, &new_stack_elem);
-
-        return ERR_SUCCESS;
-}
-
-static enum ErrState if_instr(struct List * itype_list,
-                              instr_id_t data_stack_instr,
-                              instr_id_t instr_stack_instr)
-{
-        struct IType * data_stack_itype = get_list_elem(itype_list, data_stack_instr);
-        struct Stack * data_stack = data_stack_itype->value;
-
-        ASSERT_OR_HANDLE(data_stack->size >= 1, ERR_FAILURE,
-                         "%s instruction requires data stack with 1 element or more, got %d.",
-                         g_builtin_names[2], data_stack->size);
-
-        struct StackElem * arg = stack_peek(data_stack, 0);
-        struct Stack * arg_val = get_stack_elem_val(arg, itype_list);
-
-        ASSERT(!(arg->type == STACK_ELEM_INSTR && is_builtin(arg->instr)), ERR_FAILURE,
-               "Cannot perform %s instruction on built-in.", g_builtin_names[2]);
-
-        ASSERT(arg->type != STACK_ELEM_INSTR || arg_val,
-               "Cannot perform %s instruction on uninitialized stack.", g_builtin_names[2]);
-
-        if (arg_val->size == 0) {
-
-                ASSERT_OR_HANDLE(data_stack->size >= 2, ERR_FAILURE,
-                                 "%s instruction on empty stack requires data stack with 2 "
-                                 "elements or more, got %d.",
-                                 g_builtin_names[2], data_stack->size);
-
-                stack_pop(data_stack);
-                stack_pop(data_stack);
-        } else {
-                stack_pop(data_stack);
-        }
-
-        return ERR_SUCCESS;
-}
-
-static enum ErrState step(struct List * itype_list,
-                          instr_id_t data_stack_instr,
-                          instr_id_t instr_stack_instr)
-{
-        static const builtin_func_t builtin_funcs[] = {
-                set_instr,
-                unwrap_instr,
-                if_instr
-        };
-
-        struct IType * data_stack_itype = get_list_elem(itype_list, data_stack_instr);
-        struct Stack * data_stack = data_stack_itype->value;
-
-        ASSERT_OR_HANDLE(data_stack, ERR_FAILURE, "Data stack uninitialized.");
-
-        struct IType * instr_stack_itype = get_list_elem(itype_list, instr_stack_instr);
-        struct Stack * instr_stack = instr_stack_itype->value;
-
-        ASSERT_OR_HANDLE(instr_stack, ERR_FAILURE, "Instruction stack uninitialized.");
-
-        if (instr_stack->size == 0) {
-                return ERR_SUCCESS;
-        }
-
-        struct StackElem * instr_stack_top = stack_peek(instr_stack, 0);
-
-        ASSERT_OR_HANDLE(instr_stack_top->type == STACK_ELEM_SUBSTACK, ERR_FAILURE,
-               "Top value in instruction stack not a sub-stack.");
-
-        struct Stack * instr_substack = instr_stack_top->substack;
-
-        if (instr_substack->size == 0) {
-                stack_pop(instr_stack);
-                return ERR_UNFINISHED;
-        }
-
-        struct StackElem * substack_top = stack_peek(instr_substack, 0);
-
-        if (substack_top->indirection_level > 0) {
-
-                --substack_top->indirection_level;
-                stack_push(data_stack, substack_top);
-                ++substack_top->indirection_level;
-
-                pop_from_instr_substack(instr_stack, instr_substack);
-                return ERR_UNFINISHED;
-        }
-
-        if (substack_top->type == STACK_ELEM_SUBSTACK) {
-
-                struct StackElem new_substack = create_substack(substack_top->substack, 0);
-                stack_push(instr_stack, &new_substack);
-
-                pop_from_instr_substack(instr_stack, instr_substack);
-                return ERR_UNFINISHED;
-        }
-
-        if (substack_top->type == STACK_ELEM_STACK_REF) {
-                struct StackElem stack_ref = create_stack_ref(substack_top->stack_ref, 0);
-                stack_push(instr_stack, &stack_ref);
-
-                pop_from_instr_substack(instr_stack, instr_substack);
-                return ERR_UNFINISHED;
-        }
-
-        if (!is_builtin(substack_top->instr)) {
-
-                struct IType * instr = get_list_elem(itype_list, substack_top->instr);
-
-                ASSERT_OR_HANDLE(instr->value, ERR_FAILURE,
-                                 "Cannot execute uninitialized instruction \"%s\".",
-                                 instr->name);
-
-                struct Stack * instr_val_copy = deepcopy_stack(instr->value);
-                struct StackElem new_substack = create_substack(instr_val_copy, 0);
-                stack_push(instr_stack, &new_substack);
-
-                pop_from_instr_substack(instr_stack, instr_substack);
-
-                return ERR_UNFINISHED;
-        }
-
-        enum Builtin builtin = id_to_builtin(substack_top->instr);
-
-        pop_from_instr_substack(instr_stack, instr_substack);
-
-        enum ErrState err_state;
-        err_state = (builtin_funcs[builtin])(itype_list, data_stack_instr, instr_stack_instr);
-
-        if (err_state == ERR_FAILURE) {
-                return ERR_FAILURE;
-        } else {
-                return ERR_UNFINISHED;
-        }
-}
-
-static void get_keypress(void)
-{
-        #if OS == OS_WINDOWS
-                (void) getch();
-        #else
-                (void) getchar();
-        #endif
-}
-
-enum ErrState run(struct List * itype_list, bool debug)
-{
-        LOG_DEBUG("Running a program ...\n");
-
-        if (debug) {
-                #if OS == OS_WINDOWS
-                        LOG(LOG_LVL_CONSOLE, "Press any key to execute a single step.\n\n");
-                #else
-                        LOG(LOG_LVL_CONSOLE, "Press enter to execute a single step.\n");
-                #endif
-        }
-
-        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
-        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
-
-        enum ErrState err_state;
-        do {
-                if (debug) {
-                        get_keypress();
-                        LOG(LOG_LVL_CONSOLE, "Stacks:\n");
-                        log_itype_list(LOG_LVL_CONSOLE, itype_list);
-                        LOG(LOG_LVL_CONSOLE, "\n\n");
-                }
-
-                err_state = step(itype_list, data_stack, instr_stack);
-
-        } while (err_state == ERR_UNFINISHED);
-
-        if (debug) {
-                get_keypress();
-        }
-
-        return err_state;
-}
+// This file became a little uglier every time an error was fixed.
+// Now, I just have to pray that the errors are all gone.
+
+#include "running.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include "../settings.h"
+#include "../data_types/stack.h"
+#include "../preprocessing/image.h"
+#include "../tools/mem_tools.h"
+#include "../tools/log.h"
+#include "../tools/os.h"
+#include "../tools/platform.h"
+
+#if OS == OS_WINDOWS
+#include <conio.h>
+#endif
+
+typedef enum ErrState (*builtin_func_t)(struct ITypeList * itype_list,
+                                        instr_id_t data_stack_instr,
+                                        instr_id_t instr_stack_instr);
+
+static struct Stack * get_stack_elem_val(struct StackElem * elem, struct ITypeList * itype_list)
+{
+        switch (elem->type) {
+        case STACK_ELEM_INVALID:
+                break;
+        case STACK_ELEM_INSTR: {
+                if (is_builtin(elem->instr)) {
+                        return NULL;
+                }
+                struct IType * itype = id_to_itype(itype_list, elem->instr);
+                return itype->value;
+        }
+        case STACK_ELEM_SUBSTACK:
+                return elem->substack;
+        case STACK_ELEM_STACK_REF:
+                return elem->stack_ref;
+        }
+
+        ASSERT(false, "Invalid stack element type %d.", (int) elem->type);
+        return NULL;
+}
+
+// Logs that the stacks of the program would have gone beyond their quota,
+// and returns "ERR_OUT_OF_MEMORY".
+static enum ErrState out_of_memory(void)
+{
+        LOG(LOG_LVL_CONSOLE, "Stopped before the stacks went beyond the quota of %zu bytes.\n",
+            get_thread_stack_memory()->quota);
+        return ERR_OUT_OF_MEMORY;
+}
+
+static void pop_from_instr_substack(struct Stack * instr_stack, struct Stack * instr_substack)
+{
+        if (instr_substack->size == 0) {
+                stack_pop(instr_stack);
+        } else {
+                stack_pop(instr_substack);
+        }
+}
+
+// The built-ins come in two variants: the ones named after them check
+// their arguments, while the unchecked ones are for calls "verify" proved
+// to pass the checks. Both take the same arguments, to be called the same
+// way, whether they use all of them or not.
+
+static enum ErrState set_instr_unchecked(struct ITypeList * itype_list,
+                                         instr_id_t data_stack_instr,
+                                         instr_id_t instr_stack_instr)
+{
+        (void) instr_stack_instr;
+
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        instr_id_t instr = stack_peek(data_stack, 0)->instr;
+        struct StackElem * arg2 = stack_peek(data_stack, 1);
+
+        struct Stack * new_val = get_stack_elem_val(arg2, itype_list);
+        if (arg2->type == STACK_ELEM_SUBSTACK) {
+                new_val = deepcopy_stack(new_val);
+                if (!new_val) {
+                        return out_of_memory();
+                }
+        } else if (new_val) {
+                add_stack_reference(new_val);
+        }
+
+        // Must happen before a stack changes its value in case "data_stack"
+        // changes.
+        stack_pop(data_stack);
+        stack_pop(data_stack);
+
+        struct IType * itype = id_to_itype(itype_list, instr);
+        if (itype->value) {
+                remove_stack_reference(itype->value);
+        }
+        itype->value = new_val;
+
+        return ERR_SUCCESS;
+}
+
+static enum ErrState set_instr(struct ITypeList * itype_list,
+                               instr_id_t data_stack_instr,
+                               instr_id_t instr_stack_instr)
+{
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        ASSERT_OR_HANDLE(data_stack->size >= 2, ERR_FAILURE,
+                         "%s instruction requires data stack with 2 elements or more, got %d.",
+                         g_builtin_names[0], data_stack->size);
+
+        struct StackElem * arg1 = stack_peek(data_stack, 0);
+
+        ASSERT_OR_HANDLE(arg1->type == STACK_ELEM_INSTR, ERR_FAILURE,
+                         "First argument of %s instruction must be an instruction.",
+                         g_builtin_names[0]);
+
+        ASSERT_OR_HANDLE(arg1->indirection_level == 0, ERR_FAILURE, "First argument of %s "
+                         "instruction cannot have any level of indirection.",
+                         g_builtin_names[0]);
+
+        ASSERT_OR_HANDLE(!is_builtin(arg1->instr), ERR_FAILURE, "Cannot set a built-in");
+
+        struct StackElem * arg2 = stack_peek(data_stack, 1);
+
+        ASSERT_OR_HANDLE(arg2->type != STACK_ELEM_INSTR || arg2->indirection_level == 0,
+                         ERR_FAILURE,
+                         "Second argument of %s instruction must have an indirection level of 0.",
+                         g_builtin_names[0]);
+
+        return set_instr_unchecked(itype_list, data_stack_instr, instr_stack_instr);
+}
+
+static enum ErrState unwrap_instr_unchecked(struct ITypeList * itype_list,
+                                            instr_id_t data_stack_instr,
+                                            instr_id_t instr_stack_instr)
+{
+        (void) instr_stack_instr;
+
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        struct StackElem * arg = stack_peek(data_stack, 0);
+        struct Stack * arg_val = get_stack_elem_val(arg, itype_list);
+
+        if (arg->type == STACK_ELEM_SUBSTACK) {
+                arg_val = deepcopy_stack(arg_val);
+                if (!arg_val) {
+                        return out_of_memory();
+                }
+        } else {
+                add_stack_reference(arg_val);
+        }
+
+        struct StackElem new_stack_elem = create_stack_ref(arg_val, arg->indirection_level);
+
+        // Pushing can't fail, since the element takes the place of the one
+        // popped, and stacks never shrink.
+        stack_pop(data_stack);
+        (void) stack_push(data_stack, &new_stack_elem);
+
+        return ERR_SUCCESS;
+}
+
+static enum ErrState unwrap_instr(struct ITypeList * itype_list,
+                                  instr_id_t data_stack_instr,
+                                  instr_id_t instr_stack_instr)
+{
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        ASSERT_OR_HANDLE(data_stack->size >= 1, ERR_FAILURE,
+                         "%s instruction requires data stack with 2 elements or more, got %d.",
+                         g_builtin_names[1], data_stack->size);
+
+        struct StackElem * arg = stack_peek(data_stack, 0);
+
+        ASSERT_OR_HANDLE(!(arg->type == STACK_ELEM_INSTR && is_builtin(arg->instr)), ERR_FAILURE,
+                         "Cannot unwrap a built-in");
+
+        struct Stack * arg_val = get_stack_elem_val(arg, itype_list);
+
+        if (arg->type == STACK_ELEM_INSTR && !arg_val) {
+                const struct IType * itype = id_to_itype(itype_list, arg->instr);
+
+                ASSERT_OR_HANDLE(false, ERR_FAILURE,
+                                 "Cannot unwrap uninitialized instruction \"%s\".", itype->name);
+        }
+
+        return unwrap_instr_unchecked(itype_list, data_stack_instr, instr_stack_instr);
+}
+
+static enum ErrState if_instr_unchecked(struct ITypeList * itype_list,
+                                        instr_id_t data_stack_instr,
+                                        instr_id_t instr_stack_instr)
+{
+        (void) instr_stack_instr;
+
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        struct Stack * arg_val = get_stack_elem_val(stack_peek(data_stack, 0), itype_list);
+
+        if (arg_val->size == 0) {
+                stack_pop(data_stack);
+        }
+        stack_pop(data_stack);
+
+        return ERR_SUCCESS;
+}
+
+static enum ErrState if_instr(struct ITypeList * itype_list,
+                              instr_id_t data_stack_instr,
+                              instr_id_t instr_stack_instr)
+{
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        ASSERT_OR_HANDLE(data_stack->size >= 1, ERR_FAILURE,
+                         "%s instruction requires data stack with 1 element or more, got %d.",
+                         g_builtin_names[2], data_stack->size);
+
+        struct StackElem * arg = stack_peek(data_stack, 0);
+        struct Stack * arg_val = get_stack_elem_val(arg, itype_list);
+
+        ASSERT_OR_HANDLE(!(arg->type == STACK_ELEM_INSTR && is_builtin(arg->instr)), ERR_FAILURE,
+                         "Cannot perform %s instruction on built-in.", g_builtin_names[2]);
+
+        ASSERT_OR_HANDLE(arg->type != STACK_ELEM_INSTR || arg_val, ERR_FAILURE,
+                         "Cannot perform %s instruction on uninitialized stack.",
+                         g_builtin_names[2]);
+
+        if (arg_val->size == 0) {
+
+                ASSERT_OR_HANDLE(data_stack->size >= 2, ERR_FAILURE,
+                                 "%s instruction on empty stack requires data stack with 2 "
+                                 "elements or more, got %d.",
+                                 g_builtin_names[2], data_stack->size);
+        }
+
+        return if_instr_unchecked(itype_list, data_stack_instr, instr_stack_instr);
+}
+
+static enum ErrState step(struct ITypeList * itype_list,
+                          instr_id_t data_stack_instr,
+                          instr_id_t instr_stack_instr)
+{
+        static const builtin_func_t builtin_funcs[] = {
+                set_instr,
+                unwrap_instr,
+                if_instr
+        };
+
+        static const builtin_func_t unchecked_builtin_funcs[] = {
+                set_instr_unchecked,
+                unwrap_instr_unchecked,
+                if_instr_unchecked
+        };
+
+        struct IType * data_stack_itype = id_to_itype(itype_list, data_stack_instr);
+        struct Stack * data_stack = data_stack_itype->value;
+
+        ASSERT_OR_HANDLE(data_stack, ERR_FAILURE, "Data stack uninitialized.");
+
+        struct IType * instr_stack_itype = id_to_itype(itype_list, instr_stack_instr);
+        struct Stack * instr_stack = instr_stack_itype->value;
+
+        ASSERT_OR_HANDLE(instr_stack, ERR_FAILURE, "Instruction stack uninitialized.");
+
+        if (instr_stack->size == 0) {
+                return ERR_SUCCESS;
+        }
+
+        struct StackElem * instr_stack_top = stack_peek(instr_stack, 0);
+
+        ASSERT_OR_HANDLE(instr_stack_top->type == STACK_ELEM_SUBSTACK, ERR_FAILURE,
+               "Top value in instruction stack not a sub-stack.");
+
+        struct Stack * instr_substack = instr_stack_top->substack;
+
+        if (instr_substack->size == 0) {
+                stack_pop(instr_stack);
+                return ERR_UNFINISHED;
+        }
+
+        struct StackElem * substack_top = stack_peek(instr_substack, 0);
+
+        if (substack_top->indirection_level > 0) {
+
+                struct StackElem elem_copy = copy_stack_elem(substack_top);
+                --elem_copy.indirection_level;
+                if (!stack_push(data_stack, &elem_copy)) {
+                        destroy_stack_elem(&elem_copy);
+                        return out_of_memory();
+                }
+
+                pop_from_instr_substack(instr_stack, instr_substack);
+                return ERR_UNFINISHED;
+        }
+
+        if (substack_top->type == STACK_ELEM_SUBSTACK) {
+
+                struct StackElem new_substack = copy_stack_elem(substack_top);
+                if (!stack_push(instr_stack, &new_substack)) {
+                        destroy_stack_elem(&new_substack);
+                        return out_of_memory();
+                }
+
+                pop_from_instr_substack(instr_stack, instr_substack);
+                return ERR_UNFINISHED;
+        }
+
+        if (substack_top->type == STACK_ELEM_STACK_REF) {
+                struct StackElem stack_ref = copy_stack_elem(substack_top);
+                if (!stack_push(instr_stack, &stack_ref)) {
+                        destroy_stack_elem(&stack_ref);
+                        return out_of_memory();
+                }
+
+                pop_from_instr_substack(instr_stack, instr_substack);
+                return ERR_UNFINISHED;
+        }
+
+        enum Builtin builtin;
+        if (is_builtin(substack_top->instr)) {
+                builtin = id_to_builtin(substack_top->instr);
+        } else {
+                struct IType * instr = id_to_itype(itype_list, substack_top->instr);
+
+                // Instruction types that are nothing but a built-in run it
+                // right away, rather than from a copy of their value.
+                builtin = instr->constant_builtin;
+                if (builtin == BUILTINS_COUNT) {
+
+                        ASSERT_OR_HANDLE(instr->value, ERR_FAILURE,
+                                         "Cannot execute uninitialized instruction \"%s\".",
+                                         instr->name);
+
+                        struct Stack * instr_val_copy = deepcopy_stack(instr->value);
+                        if (!instr_val_copy) {
+                                return out_of_memory();
+                        }
+
+                        struct StackElem new_substack = create_substack(instr_val_copy, 0);
+                        if (!stack_push(instr_stack, &new_substack)) {
+                                destroy_stack_elem(&new_substack);
+                                return out_of_memory();
+                        }
+
+                        pop_from_instr_substack(instr_stack, instr_substack);
+
+                        return ERR_UNFINISHED;
+                }
+        }
+
+        builtin_func_t builtin_func = substack_top->is_verified ? unchecked_builtin_funcs[builtin]
+                                                                : builtin_funcs[builtin];
+
+        pop_from_instr_substack(instr_stack, instr_substack);
+
+        enum ErrState err_state;
+        err_state = builtin_func(itype_list, data_stack_instr, instr_stack_instr);
+
+        if (err_state == ERR_SUCCESS) {
+                return ERR_UNFINISHED;
+        } else {
+                return err_state;
+        }
+}
+
+static void get_keypress(void)
+{
+        #if OS == OS_WINDOWS
+                (void) getch();
+        #else
+                (void) getchar();
+        #endif
+}
+
+// Saves a checkpoint of the program if one is due after "step_count"
+// steps. Returns "ERR_INTERRUPTED" if the program has to stop there, and
+// "ERR_UNFINISHED" otherwise.
+static enum ErrState checkpoint(const struct ITypeList * itype_list,
+                                const struct RunOptions * options,
+                                uint64_t step_count)
+{
+        bool is_terminating = is_termination_requested();
+        bool is_due = options->checkpoint_interval > 0 &&
+                      step_count % options->checkpoint_interval == 0;
+
+        if (is_terminating || is_due) {
+                (void) save_checkpoint(options->checkpoint_path, itype_list);
+        }
+
+        return is_terminating ? ERR_INTERRUPTED : ERR_UNFINISHED;
+}
+
+uint64_t get_next_limit_check(const struct RunLimits * limits, uint64_t step_count)
+{
+        uint64_t next_check = UINT64_MAX;
+        if (limits->time_limit_ms > 0) {
+                next_check = step_count + STEPS_PER_TIME_CHECK;
+        }
+        if (limits->max_steps > 0 && limits->max_steps < next_check) {
+                next_check = limits->max_steps;
+        }
+
+        return next_check;
+}
+
+enum ErrState check_run_limits(const struct RunLimits * limits, uint64_t step_count, uint64_t start_ns)
+{
+        if (limits->max_steps > 0 && step_count >= limits->max_steps) {
+                LOG(LOG_LVL_CONSOLE, "Stopped after reaching the limit of %" PRIu64 " steps.\n",
+                    limits->max_steps);
+                return ERR_LIMIT_EXCEEDED;
+        }
+
+        if (limits->time_limit_ms > 0 &&
+            get_monotonic_ns() - start_ns >= limits->time_limit_ms * 1000000) {
+                LOG(LOG_LVL_CONSOLE, "Stopped after reaching the time limit of %" PRIu64
+                    " ms, %" PRIu64 " steps in.\n", limits->time_limit_ms, step_count);
+                return ERR_LIMIT_EXCEEDED;
+        }
+
+        return ERR_UNFINISHED;
+}
+
+enum ErrState run_steps(struct ITypeList * itype_list, uint64_t max_steps, uint64_t * step_count)
+{
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+
+        enum ErrState err_state = ERR_UNFINISHED;
+        uint64_t steps = 0;
+        while (steps < max_steps && err_state == ERR_UNFINISHED) {
+                err_state = step(itype_list, data_stack, instr_stack);
+                ++steps;
+        }
+
+        *step_count = steps;
+
+        return err_state;
+}
+
+enum ErrState run(struct ITypeList * itype_list, const struct RunOptions * options)
+{
+        LOG_DEBUG("Running a program ...\n");
+
+        if (options->debug) {
+                #if OS == OS_WINDOWS
+                        LOG(LOG_LVL_CONSOLE, "Press any key to execute a single step.\n\n");
+                #else
+                        LOG(LOG_LVL_CONSOLE, "Press enter to execute a single step.\n");
+                #endif
+        }
+
+        // Without checkpoints, there's nothing to do before terminating.
+        if (options->checkpoint_path) {
+                catch_termination_requests();
+        }
+
+        instr_id_t data_stack = find_instr_id(itype_list, g_data_stack_str);
+        instr_id_t instr_stack = find_instr_id(itype_list, g_instr_stack_str);
+
+        uint64_t step_count = 0;
+        uint64_t start_ns = get_monotonic_ns();
+        uint64_t next_limit_check = get_next_limit_check(&options->limits, step_count);
+
+        enum ErrState err_state;
+        do {
+                if (options->debug) {
+                        get_keypress();
+                        LOG(LOG_LVL_CONSOLE, "Stacks:\n");
+                        log_itype_list(LOG_LVL_CONSOLE, itype_list);
+                        LOG(LOG_LVL_CONSOLE, "\n\n");
+                }
+
+                err_state = step(itype_list, data_stack, instr_stack);
+                ++step_count;
+
+                if (err_state == ERR_UNFINISHED && step_count == next_limit_check) {
+                        err_state = check_run_limits(&options->limits, step_count, start_ns);
+                        next_limit_check = get_next_limit_check(&options->limits, step_count);
+                }
+
+                if (err_state == ERR_LIMIT_EXCEEDED && options->checkpoint_path) {
+                        (void) save_checkpoint(options->checkpoint_path, itype_list);
+                } else if (err_state == ERR_UNFINISHED && options->checkpoint_path) {
+                        err_state = checkpoint(itype_list, options, step_count);
+                }
+
+        } while (err_state == ERR_UNFINISHED);
+
+        if (options->debug) {
+                get_keypress();
+        }
+
+        return err_state;
+}
@@ -1,14 +1,79 @@
-#ifndef RUNNING_H
-#define RUNNING_H
-
-#include "../tools/list.h"
-
-enum ErrState {
-        ERR_FAILURE,
-        ERR_UNFINISHED,
-        ERR_SUCCESS
-};
-
-enum ErrState run(struct List * itype_list, bool debug);
-
-#endif
+#ifndef RUNNING_H
+#define RUNNING_H
+
+#include <stdint.h>
+#include "../data_types/itype.h"
+
+enum ErrState {
+        ERR_FAILURE,
+        ERR_UNFINISHED,
+        ERR_SUCCESS,
+
+        // The program was asked to terminate before it finished, and can
+        // be resumed from its checkpoint.
+        ERR_INTERRUPTED,
+
+        // The program ran into one of its "struct RunLimits", and was
+        // stopped where it was.
+        ERR_LIMIT_EXCEEDED,
+
+        // A step of the program needed more memory than the quota of the
+        // memory of the thread allows, as set by "set_thread_stack_memory",
+        // and the program was stopped in the middle of it.
+        ERR_OUT_OF_MEMORY
+};
+
+// The exit code of (min)mod when a program is stopped by a limit.
+#define EXIT_LIMIT_EXCEEDED 2
+
+// The exit code of (min)mod when a program runs out of memory.
+#define EXIT_OUT_OF_MEMORY 3
+
+// The number of steps between checks of the time limit. Reading the clock
+// every step would slow programs down noticeably.
+#define STEPS_PER_TIME_CHECK 65536
+
+// Limits on how long a program may run. 0 means no limit.
+struct RunLimits {
+        uint64_t max_steps;
+        uint64_t time_limit_ms;
+};
+
+struct RunOptions {
+        // Step through the program one instruction at a time.
+        bool debug;
+
+        // Where the program is saved between steps, so that it can be
+        // resumed later on, or "NULL" if it isn't. It's always saved if
+        // (min)mod is asked to terminate (by SIGTERM).
+        const char * checkpoint_path;
+
+        // The number of steps between checkpoints. 0 means checkpoints are
+        // only saved when (min)mod is asked to terminate.
+        uint64_t checkpoint_interval;
+
+        // A checkpoint is saved when the program is stopped by a limit too,
+        // if there's a "checkpoint_path".
+        struct RunLimits limits;
+};
+
+enum ErrState run(struct ITypeList * itype_list, const struct RunOptions * options);
+
+// Runs at most "max_steps" steps of the program, and stores how many steps
+// were run in "*step_count". Returns "ERR_UNFINISHED" if the program is
+// still running after them. Unlike "run", it never waits for the user, so
+// it can be called over and over to run a program a little at a time.
+enum ErrState run_steps(struct ITypeList * itype_list, uint64_t max_steps, uint64_t * step_count);
+
+// Returns the step count at which "check_run_limits" has to be called next
+// for a program that has run "step_count" steps. Between the checks, the
+// program can run without looking at its limits at all.
+uint64_t get_next_limit_check(const struct RunLimits * limits, uint64_t step_count);
+
+// Returns "ERR_LIMIT_EXCEEDED", after logging which limit was exceeded, if
+// a program that started running at "start_ns", as returned by
+// "get_monotonic_ns", and has run "step_count" steps since, has to stop.
+// Returns "ERR_UNFINISHED" otherwise.
+enum ErrState check_run_limits(const struct RunLimits * limits, uint64_t step_count, uint64_t start_ns);
+
+#endif
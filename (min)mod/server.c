@@ -0,0 +1,284 @@
+#include "server.h"
+#include <stdio.h>
+#include <string.h>
+#include "records.h"
+#include "lib/minmod.h"
+#include "tools/list.h"
+#include "tools/log.h"
+#include "tools/mem_tools.h"
+#include "tools/platform.h"
+#include "tools/str_map.h"
+
+// The longest request accepted, in bytes, not counting the newline.
+#define MAX_REQUEST_LENGTH 4096
+
+// How often idle workers and the server check whether they should
+// terminate, in milliseconds.
+#define SERVER_POLL_MS 100
+
+struct Server {
+        const struct ServerOptions * options;
+
+        // "char *"s, the paths of the programs.
+        struct List file_paths;
+
+        // Maps each path to the index of its program.
+        struct StrMap indices;
+
+        // "struct MinmodContext *"s, the programs, loaded but not run, in the
+        // order of "file_paths". Programs listed more than once are only
+        // loaded the first time, and are "NULL" after that.
+        struct List contexts;
+
+        struct LocalSocket listener;
+};
+
+static void destroy_context_ptr(void * context_ptr)
+{
+        struct MinmodContext * context = *(struct MinmodContext **) context_ptr;
+        if (context) {
+                destroy_minmod_context(context);
+        }
+}
+
+// Sends a response with "error" rather than a record.
+static void send_error(const struct LocalSocket * connection, const char * error)
+{
+        struct List response = create_list(sizeof(char), NULL);
+        append_str(&response, "{\"error\": ");
+        append_json_str(&response, error);
+        append_str(&response, "}\n");
+
+        (void) write_local_socket(connection, response.contents, response.length);
+
+        destroy_list(&response);
+}
+
+// Reads the request from "connection" into "request", null-terminated.
+// Returns "false" if there's no complete request, or if it's too long.
+static bool read_request(const struct LocalSocket * connection, char * request)
+{
+        size_t length = 0;
+        while (true) {
+                ptrdiff_t read_count = read_local_socket(connection, &request[length],
+                                                         MAX_REQUEST_LENGTH + 1 - length);
+                if (read_count <= 0) {
+                        return false;
+                }
+
+                char * newline = memchr(&request[length], '\n', read_count);
+                length += read_count;
+                if (newline) {
+                        // Requests may end in "\r\n" too.
+                        if (newline > request && newline[-1] == '\r') {
+                                --newline;
+                        }
+                        *newline = '\0';
+                        return true;
+                }
+
+                if (length > MAX_REQUEST_LENGTH) {
+                        return false;
+                }
+        }
+}
+
+// Runs the program "request" names, and sends back its record.
+// Only ever called by workers, each of which has a copy of the programs,
+// so the program can run in the copy it was parsed into.
+static void serve_request(struct Server * server, const struct LocalSocket * connection)
+{
+        uint64_t start_ns = get_monotonic_ns();
+        set_local_socket_timeout(connection, server->options->timeout_ms);
+
+        char request[MAX_REQUEST_LENGTH + 2];
+        if (!read_request(connection, request)) {
+                send_error(connection, "Expected the path of a program followed by a newline.");
+                return;
+        }
+
+        size_t index;
+        if (!str_map_find(&server->indices, request, strlen(request), &index)) {
+                send_error(connection, "Unknown program.");
+                return;
+        }
+
+        const char * file_path = *(char * const *) get_list_elem_const(&server->file_paths, index);
+        struct MinmodContext * context = *(struct MinmodContext **) get_list_elem(&server->contexts,
+                                                                                  index);
+
+        // The log of loading the program is kept before running it, since
+        // the log of a context only holds what the last call logged.
+        struct List log = create_list(sizeof(char), NULL);
+        append_str(&log, get_minmod_log(context));
+
+        set_minmod_limits(context, server->options->max_steps,
+                          (uint64_t) server->options->timeout_ms);
+        set_minmod_memory_quota(context, server->options->max_memory);
+        (void) run_minmod_steps(context, UINT64_MAX);
+        append_str(&log, get_minmod_log(context));
+
+        uint64_t time_ns = get_monotonic_ns() - start_ns;
+
+        char terminator = '\0';
+        list_append(&log, &terminator);
+
+        struct List record = create_list(sizeof(char), NULL);
+        append_run_record(&record, index, file_path, context, log.contents, time_ns);
+
+        (void) write_local_socket(connection, record.contents, record.length);
+
+        destroy_list(&record);
+        destroy_list(&log);
+}
+
+// Waits for a single request and serves it. Run by worker processes, which
+// exit once it returns, so nothing they change is ever cleaned up.
+static int run_worker(void * arg)
+{
+        struct Server * server = arg;
+
+        while (!is_termination_requested()) {
+                struct LocalSocket connection;
+                if (accept_local_connection(&server->listener, SERVER_POLL_MS, &connection)) {
+                        serve_request(server, &connection);
+                        close_local_socket(&connection);
+                        break;
+                }
+        }
+
+        return EXIT_SUCCESS;
+}
+
+// Loads every program in the manifest into "server".
+// Returns "false" if any of them can't be loaded.
+static bool load_programs(struct Server * server)
+{
+        const char * manifest_path = server->options->manifest_path;
+        if (!read_manifest(manifest_path, &server->file_paths)) {
+                LOG_ERROR("Failed to read the manifest \"%s\".\n", manifest_path);
+                return false;
+        }
+
+        for (size_t i = 0; i < server->file_paths.length; ++i) {
+                const char * file_path = *(char * const *) get_list_elem_const(&server->file_paths, i);
+
+                // Later lines listing the same program are ignored.
+                size_t index;
+                if (str_map_find(&server->indices, file_path, strlen(file_path), &index)) {
+                        struct MinmodContext * context = NULL;
+                        list_append(&server->contexts, &context);
+                        continue;
+                }
+                str_map_insert(&server->indices, file_path, strlen(file_path), i);
+
+                struct MinmodContext * context = create_minmod_context();
+                list_append(&server->contexts, &context);
+                if (!load_minmod_file(context, file_path)) {
+                        LOG(LOG_LVL_CONSOLE, "%s", get_minmod_log(context));
+                        LOG_ERROR("Failed to load \"%s\".\n", file_path);
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+// Starts a worker in every slot of "workers" without one, which have an
+// "id" of 0.
+static void start_workers(struct Server * server, struct ChildProcess * workers)
+{
+        for (int i = 0; i < server->options->worker_count; ++i) {
+                if (workers[i].id == 0 && !start_child_process(&workers[i], run_worker, server)) {
+                        LOG_WARNING("Couldn't start a worker process.\n");
+                        workers[i].id = 0;
+                }
+        }
+}
+
+// Stores that the worker "child" has exited. Returns "false" if it's not
+// one of "workers".
+static bool remove_worker(struct Server * server,
+                          struct ChildProcess * workers,
+                          const struct ChildProcess * child)
+{
+        for (int i = 0; i < server->options->worker_count; ++i) {
+                if (workers[i].id == child->id) {
+                        workers[i].id = 0;
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+// Keeps "worker_count" workers running until termination is requested,
+// and then waits for all of them to exit.
+static void supervise_workers(struct Server * server)
+{
+        int worker_count = server->options->worker_count;
+        struct ChildProcess * workers = ALLOC(struct ChildProcess, worker_count);
+        for (int i = 0; i < worker_count; ++i) {
+                workers[i].id = 0;
+        }
+
+        while (!is_termination_requested()) {
+                start_workers(server, workers);
+
+                struct ChildProcess child;
+                int exit_code;
+                if (wait_for_child_process(SERVER_POLL_MS, &child, &exit_code)) {
+                        (void) remove_worker(server, workers, &child);
+                }
+        }
+
+        int running_count = 0;
+        for (int i = 0; i < worker_count; ++i) {
+                if (workers[i].id != 0) {
+                        terminate_child_process(&workers[i]);
+                        ++running_count;
+                }
+        }
+        while (running_count > 0) {
+                struct ChildProcess child;
+                int exit_code;
+                if (wait_for_child_process(SERVER_POLL_MS, &child, &exit_code) &&
+                    remove_worker(server, workers, &child)) {
+                        --running_count;
+                }
+        }
+
+        FREE(workers);
+}
+
+bool run_server(const struct ServerOptions * options)
+{
+        struct Server server;
+        server.options = options;
+        server.indices = create_str_map();
+        server.contexts = create_list(sizeof(struct MinmodContext *), destroy_context_ptr);
+
+        bool is_started = load_programs(&server);
+        if (is_started) {
+                // Workers are copies of the server, and so terminate
+                // gracefully too as long as this is done before starting them.
+                catch_termination_requests();
+
+                is_started = listen_on_local_socket(options->socket_path, &server.listener);
+        }
+        if (is_started) {
+                LOG(LOG_LVL_CONSOLE, "Serving %zu programs on \"%s\" using %d workers ...\n",
+                    server.indices.length, options->socket_path, options->worker_count);
+
+                supervise_workers(&server);
+
+                close_local_socket(&server.listener);
+                (void) remove(options->socket_path);
+        }
+
+        destroy_list(&server.contexts);
+        destroy_str_map(&server.indices);
+        destroy_list(&server.file_paths);
+
+        return is_started;
+}
@@ -0,0 +1,50 @@
+// Server mode, which loads and parses the programs listed in a manifest
+// once, and then runs them on request, for requests that can't wait for
+// programs to be lexed and parsed.
+// Requests are served by worker processes, copied from the server after
+// the programs are parsed, so that they start out sharing the parsed
+// programs with it (copy-on-write on POSIX systems) and with each other.
+// Each worker serves a single request and exits, so every run starts from
+// the program as it was parsed, and the server starts a new worker in its
+// place.
+// Clients connect to a Unix domain socket and send the path of a program,
+// as it's written in the manifest, followed by a newline. The response is
+// the record of the run, as described in "records.h", after which the
+// connection is closed. If the program isn't in the manifest, or the
+// request is invalid, the response is a JSON object with an "error"
+// instead.
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct ServerOptions {
+        const char * manifest_path;
+        const char * socket_path;
+
+        // The number of worker processes, so the number of requests served
+        // at the same time.
+        int worker_count;
+
+        // How long a program may run for a request, in milliseconds.
+        // Programs that run longer are stopped, and their record has the
+        // stacks they had by then. Reading the request and sending the
+        // record time out after as long too.
+        int timeout_ms;
+
+        // How many steps a program may run for a request, and how much
+        // memory its stacks may take, 0 meaning no limit. Programs are
+        // stopped there just like when they time out.
+        uint64_t max_steps;
+        size_t max_memory;
+};
+
+// Serves requests until (min)mod is asked to terminate using SIGTERM, and
+// then waits for the requests being served.
+// Returns "false" if the server can't be started, after logging why.
+bool run_server(const struct ServerOptions * options);
+
+#endif
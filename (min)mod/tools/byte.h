@@ -1,6 +1,6 @@
-#ifndef BYTE_H
-#define BYTE_H
-
-typedef unsigned char byte_t;
-
-#endif
+#ifndef BYTE_H
+#define BYTE_H
+
+typedef unsigned char byte_t;
+
+#endif
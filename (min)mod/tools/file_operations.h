@@ -1,10 +1,12 @@
-#ifndef FILE_OPERATIONS_H
-#define FILE_OPERATIONS_H
-
-const char * get_file_ext(const char * fname);
-
-char * get_parent_dir(const char * fpath);
-
-char * file_to_string(const char * fname);
-
-#endif
+#ifndef FILE_OPERATIONS_H
+#define FILE_OPERATIONS_H
+
+const char * get_file_ext(const char * fname);
+
+char * get_parent_dir(const char * fpath);
+
+// The number of times "get_parent_dir" can be applied to "fpath" before it
+// fails.
+int count_parent_dirs(const char * fpath);
+
+#endif
@@ -0,0 +1,17 @@
+#include "hash.h"
+#include "byte.h"
+
+#define FNV_PRIME 1099511628211ULL
+
+uint64_t hash_bytes(const void * data, size_t length, uint64_t seed)
+{
+        const byte_t * bytes = data;
+        uint64_t hash = seed;
+
+        for (size_t i = 0; i < length; ++i) {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+        }
+
+        return hash;
+}
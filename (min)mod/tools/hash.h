@@ -0,0 +1,16 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// The value to start from when hashing something from scratch.
+#define HASH_SEED 14695981039346656037ULL
+
+// FNV-1a. Not cryptographically secure in any way, but fast and good
+// enough for hash tables and telling files apart.
+// "seed" should be "HASH_SEED", or the result of a previous call if
+// several pieces of data should be hashed as if they were one.
+uint64_t hash_bytes(const void * data, size_t length, uint64_t seed);
+
+#endif
@@ -1,13 +1,24 @@
-#ifndef OS_H
-#define OS_H
-
-#define OS_WINDOWS 1
-#define OS_UNKNOWN 2
-
-#ifdef WIN32
-#define OS OS_WINDOWS
-#else
-#define OS OS_UNKNOWN
-#endif
-
-#endif
+#ifndef OS_H
+#define OS_H
+
+#define OS_WINDOWS 1
+#define OS_UNKNOWN 2
+#define OS_LINUX 3
+
+// Other Unix-like systems. They get the same POSIX code as Linux, minus
+// anything Linux-specific.
+#define OS_POSIX 4
+
+#if defined(WIN32) || defined(_WIN32)
+#define OS OS_WINDOWS
+#elif defined(__linux__)
+#define OS OS_LINUX
+#elif defined(__unix__) || defined(__APPLE__)
+#define OS OS_POSIX
+#else
+#define OS OS_UNKNOWN
+#endif
+
+#define OS_IS_POSIX (OS == OS_LINUX || OS == OS_POSIX)
+
+#endif
@@ -0,0 +1,1036 @@
+// Needed for "madvise" when compiling with a strict "-std".
+#define _DEFAULT_SOURCE
+
+#include "platform.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log.h"
+#include "mem_tools.h"
+
+#if OS_IS_POSIX
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if OS == OS_LINUX
+#include <sys/inotify.h>
+
+// Anything that might change a file in a watched directory, including
+// replacing it by renaming another file.
+#define FILE_WATCH_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+                         IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+// The size of the chunks read at a time from files that can't be mapped.
+#define READ_CHUNK_SIZE 65536
+
+#define FALLBACK_PAGE_SIZE 4096
+
+// How often "wait_for_child_process" checks whether a child has exited, in
+// milliseconds.
+#define CHILD_POLL_MS 10
+
+static struct FileView create_invalid_file_view(void)
+{
+        struct FileView view;
+        view.data = NULL;
+        view.length = 0;
+        view.is_mapped = false;
+
+        return view;
+}
+
+bool is_file_view_valid(const struct FileView * view)
+{
+        return view->data != NULL;
+}
+
+// Appends chunks read by "read_chunk" to a growing buffer until it reports
+// the end of the file (0) or an error (-1).
+// Works for anything, including pipes whose length isn't known in advance.
+static struct FileView read_file_view(void * file, long (*read_chunk)(void * file, char * dest, size_t max))
+{
+        size_t capacity = READ_CHUNK_SIZE;
+        size_t length = 0;
+        char * data = ALLOC(char, capacity);
+
+        while (true) {
+                if (capacity - length < READ_CHUNK_SIZE) {
+                        capacity *= 2;
+                        REALLOC(&data, char, capacity);
+                }
+
+                long chunk_length = read_chunk(file, data + length, READ_CHUNK_SIZE);
+                if (chunk_length < 0) {
+                        FREE(data);
+                        return create_invalid_file_view();
+                }
+                if (chunk_length == 0) {
+                        break;
+                }
+                length += chunk_length;
+        }
+
+        struct FileView view;
+        view.data = data;
+        view.length = length;
+        view.is_mapped = false;
+
+        return view;
+}
+
+#if OS_IS_POSIX
+
+static long read_fd_chunk(void * file, char * dest, size_t max)
+{
+        int fd = *(int *) file;
+
+        ssize_t chunk_length;
+        do {
+                chunk_length = read(fd, dest, max);
+        } while (chunk_length < 0 && errno == EINTR);
+
+        return chunk_length;
+}
+
+static struct FileView open_file_view_impl(const char * path, bool report_errors)
+{
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                if (report_errors) {
+                        LOG_ERROR("Couldn't open \"%s\". Are you sure the file exists?\n", path);
+                }
+                return create_invalid_file_view();
+        }
+
+        struct stat file_stat;
+        bool is_regular = fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+
+        // Empty files can't be mapped, and don't need to be.
+        if (is_regular && file_stat.st_size == 0) {
+                close(fd);
+
+                struct FileView view;
+                view.data = "";
+                view.length = 0;
+                view.is_mapped = true;
+
+                return view;
+        }
+
+        if (is_regular) {
+                size_t length = file_stat.st_size;
+                void * data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (data != MAP_FAILED) {
+                        close(fd);
+
+                        // Sources are lexed from beginning to end exactly once, so
+                        // the kernel might as well read ahead aggressively and drop
+                        // pages right after we've used them.
+                        (void) madvise(data, length, MADV_SEQUENTIAL);
+
+                        struct FileView view;
+                        view.data = data;
+                        view.length = length;
+                        view.is_mapped = true;
+
+                        return view;
+                }
+        }
+
+        // Pipes, character devices and files on file systems that don't
+        // support mapping.
+        struct FileView view = read_file_view(&fd, read_fd_chunk);
+        close(fd);
+
+        if (!is_file_view_valid(&view) && report_errors) {
+                LOG_ERROR("Couldn't read \"%s\".\n", path);
+        }
+
+        return view;
+}
+
+void close_file_view(struct FileView * view)
+{
+        if (view->is_mapped) {
+                if (view->length > 0) {
+                        munmap((void *) view->data, view->length);
+                }
+        } else {
+                FREE((char *) view->data);
+        }
+
+        *view = create_invalid_file_view();
+}
+
+bool get_file_id(const char * path, struct FileId * id)
+{
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) {
+                return false;
+        }
+
+        // Zero the padding, if any, so that IDs can be hashed as bytes.
+        memset(id, 0, sizeof(*id));
+        id->device = file_stat.st_dev;
+        id->index = file_stat.st_ino;
+
+        return true;
+}
+
+uint64_t get_monotonic_ns(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+size_t get_page_size(void)
+{
+        long page_size = sysconf(_SC_PAGESIZE);
+        if (page_size <= 0) {
+                return FALLBACK_PAGE_SIZE;
+        }
+        return page_size;
+}
+
+int get_cpu_count(void)
+{
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpu_count <= 0) {
+                return 1;
+        }
+        return cpu_count;
+}
+
+#else
+
+static long read_stdio_chunk(void * file, char * dest, size_t max)
+{
+        FILE * fp = file;
+
+        size_t chunk_length = fread(dest, 1, max, fp);
+        if (chunk_length == 0 && ferror(fp)) {
+                return -1;
+        }
+        return chunk_length;
+}
+
+static struct FileView open_file_view_impl(const char * path, bool report_errors)
+{
+        FILE * fp = fopen(path, "rb");
+        if (!fp) {
+                if (report_errors) {
+                        LOG_ERROR("Couldn't open \"%s\". Are you sure the file exists?\n", path);
+                }
+                return create_invalid_file_view();
+        }
+
+        struct FileView view = read_file_view(fp, read_stdio_chunk);
+        fclose(fp);
+
+        if (!is_file_view_valid(&view) && report_errors) {
+                LOG_ERROR("Couldn't read \"%s\".\n", path);
+        }
+
+        return view;
+}
+
+void close_file_view(struct FileView * view)
+{
+        FREE((char *) view->data);
+        *view = create_invalid_file_view();
+}
+
+#if OS == OS_WINDOWS
+
+bool get_file_id(const char * path, struct FileId * id)
+{
+        // Directories can only be opened with "FILE_FLAG_BACKUP_SEMANTICS".
+        HANDLE file = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+                return false;
+        }
+
+        BY_HANDLE_FILE_INFORMATION info;
+        bool has_info = GetFileInformationByHandle(file, &info);
+        CloseHandle(file);
+
+        if (!has_info) {
+                return false;
+        }
+
+        memset(id, 0, sizeof(*id));
+        id->device = info.dwVolumeSerialNumber;
+        id->index = ((uint64_t) info.nFileIndexHigh << 32) | info.nFileIndexLow;
+
+        return true;
+}
+
+uint64_t get_monotonic_ns(void)
+{
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+
+        // Split up to avoid overflowing when multiplying.
+        uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+        uint64_t remainder = counter.QuadPart % frequency.QuadPart;
+        return seconds * 1000000000 + remainder * 1000000000 / frequency.QuadPart;
+}
+
+size_t get_page_size(void)
+{
+        SYSTEM_INFO system_info;
+        GetSystemInfo(&system_info);
+        return system_info.dwPageSize;
+}
+
+int get_cpu_count(void)
+{
+        SYSTEM_INFO system_info;
+        GetSystemInfo(&system_info);
+        return system_info.dwNumberOfProcessors;
+}
+
+#else
+
+bool get_file_id(const char * path, struct FileId * id)
+{
+        (void) path;
+        (void) id;
+        return false;
+}
+
+// Not necessarily monotonic, but it's the best the standard library has.
+uint64_t get_monotonic_ns(void)
+{
+        struct timespec now;
+        timespec_get(&now, TIME_UTC);
+        return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+size_t get_page_size(void)
+{
+        return FALLBACK_PAGE_SIZE;
+}
+
+int get_cpu_count(void)
+{
+        return 1;
+}
+
+#endif
+
+#endif
+
+struct FileView open_file_view(const char * path)
+{
+        return open_file_view_impl(path, true);
+}
+
+struct FileView try_open_file_view(const char * path)
+{
+        return open_file_view_impl(path, false);
+}
+
+// What a new thread should run. "ALLOC"ed by "start_thread" and "FREE"d by
+// the thread, since the operating systems only pass a single pointer.
+struct ThreadStart {
+        void (*run)(void * arg);
+        void * arg;
+};
+
+#if OS_IS_POSIX
+
+void create_mutex(struct Mutex * mutex)
+{
+        pthread_mutex_init(&mutex->handle, NULL);
+}
+
+void destroy_mutex(struct Mutex * mutex)
+{
+        pthread_mutex_destroy(&mutex->handle);
+}
+
+void lock_mutex(struct Mutex * mutex)
+{
+        pthread_mutex_lock(&mutex->handle);
+}
+
+void unlock_mutex(struct Mutex * mutex)
+{
+        pthread_mutex_unlock(&mutex->handle);
+}
+
+void create_cond_var(struct CondVar * cond_var)
+{
+        pthread_cond_init(&cond_var->handle, NULL);
+}
+
+void destroy_cond_var(struct CondVar * cond_var)
+{
+        pthread_cond_destroy(&cond_var->handle);
+}
+
+void wait_cond_var(struct CondVar * cond_var, struct Mutex * mutex)
+{
+        pthread_cond_wait(&cond_var->handle, &mutex->handle);
+}
+
+void signal_cond_var(struct CondVar * cond_var)
+{
+        pthread_cond_signal(&cond_var->handle);
+}
+
+void broadcast_cond_var(struct CondVar * cond_var)
+{
+        pthread_cond_broadcast(&cond_var->handle);
+}
+
+static void * run_thread_start(void * arg)
+{
+        struct ThreadStart start = *(struct ThreadStart *) arg;
+        FREE(arg);
+
+        start.run(start.arg);
+        return NULL;
+}
+
+bool start_thread(struct Thread * thread, void (*run)(void * arg), void * arg)
+{
+        struct ThreadStart * start = ALLOC(struct ThreadStart, 1);
+        start->run = run;
+        start->arg = arg;
+
+        if (pthread_create(&thread->handle, NULL, run_thread_start, start) != 0) {
+                FREE(start);
+                return false;
+        }
+        return true;
+}
+
+void join_thread(struct Thread * thread)
+{
+        pthread_join(thread->handle, NULL);
+}
+
+#elif OS == OS_WINDOWS
+
+void create_mutex(struct Mutex * mutex)
+{
+        InitializeSRWLock(&mutex->handle);
+}
+
+// Slim reader/writer locks don't have to be destroyed.
+void destroy_mutex(struct Mutex * mutex)
+{
+        (void) mutex;
+}
+
+void lock_mutex(struct Mutex * mutex)
+{
+        AcquireSRWLockExclusive(&mutex->handle);
+}
+
+void unlock_mutex(struct Mutex * mutex)
+{
+        ReleaseSRWLockExclusive(&mutex->handle);
+}
+
+void create_cond_var(struct CondVar * cond_var)
+{
+        InitializeConditionVariable(&cond_var->handle);
+}
+
+// Neither do condition variables.
+void destroy_cond_var(struct CondVar * cond_var)
+{
+        (void) cond_var;
+}
+
+void wait_cond_var(struct CondVar * cond_var, struct Mutex * mutex)
+{
+        SleepConditionVariableSRW(&cond_var->handle, &mutex->handle, INFINITE, 0);
+}
+
+void signal_cond_var(struct CondVar * cond_var)
+{
+        WakeConditionVariable(&cond_var->handle);
+}
+
+void broadcast_cond_var(struct CondVar * cond_var)
+{
+        WakeAllConditionVariable(&cond_var->handle);
+}
+
+static DWORD WINAPI run_thread_start(LPVOID arg)
+{
+        struct ThreadStart start = *(struct ThreadStart *) arg;
+        FREE(arg);
+
+        start.run(start.arg);
+        return 0;
+}
+
+bool start_thread(struct Thread * thread, void (*run)(void * arg), void * arg)
+{
+        struct ThreadStart * start = ALLOC(struct ThreadStart, 1);
+        start->run = run;
+        start->arg = arg;
+
+        thread->handle = CreateThread(NULL, 0, run_thread_start, start, 0, NULL);
+        if (!thread->handle) {
+                FREE(start);
+                return false;
+        }
+        return true;
+}
+
+void join_thread(struct Thread * thread)
+{
+        WaitForSingleObject(thread->handle, INFINITE);
+        CloseHandle(thread->handle);
+}
+
+#else
+
+void create_mutex(struct Mutex * mutex)
+{
+        (void) mutex;
+}
+
+void destroy_mutex(struct Mutex * mutex)
+{
+        (void) mutex;
+}
+
+void lock_mutex(struct Mutex * mutex)
+{
+        (void) mutex;
+}
+
+void unlock_mutex(struct Mutex * mutex)
+{
+        (void) mutex;
+}
+
+void create_cond_var(struct CondVar * cond_var)
+{
+        (void) cond_var;
+}
+
+void destroy_cond_var(struct CondVar * cond_var)
+{
+        (void) cond_var;
+}
+
+void wait_cond_var(struct CondVar * cond_var, struct Mutex * mutex)
+{
+        (void) cond_var;
+        (void) mutex;
+}
+
+void signal_cond_var(struct CondVar * cond_var)
+{
+        (void) cond_var;
+}
+
+void broadcast_cond_var(struct CondVar * cond_var)
+{
+        (void) cond_var;
+}
+
+bool start_thread(struct Thread * thread, void (*run)(void * arg), void * arg)
+{
+        (void) thread;
+        (void) run;
+        (void) arg;
+        return false;
+}
+
+void join_thread(struct Thread * thread)
+{
+        (void) thread;
+}
+
+#endif
+
+bool are_file_stamps_equal(const struct FileStamp * stamp1, const struct FileStamp * stamp2)
+{
+        return MEMORY_EQUALS(stamp1, stamp2, struct FileStamp, 1);
+}
+
+#if OS_IS_POSIX
+
+bool get_file_stamp(const char * path, struct FileStamp * stamp)
+{
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) {
+                return false;
+        }
+
+        // Zero the padding, if any, so that stamps can be compared as bytes.
+        memset(stamp, 0, sizeof(*stamp));
+
+        #if OS == OS_LINUX
+                stamp->modified_ns = (uint64_t) file_stat.st_mtim.tv_sec * 1000000000 +
+                                     file_stat.st_mtim.tv_nsec;
+        #else
+                stamp->modified_ns = (uint64_t) file_stat.st_mtime * 1000000000;
+        #endif
+
+        stamp->size = file_stat.st_size;
+        stamp->id.device = file_stat.st_dev;
+        stamp->id.index = file_stat.st_ino;
+
+        return true;
+}
+
+bool run_in_child_process(int (*run)(void * arg), void * arg, int * exit_code)
+{
+        fflush(NULL);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+                return false;
+        }
+
+        if (pid == 0) {
+                int child_exit_code = run(arg);
+                fflush(NULL);
+                _exit(child_exit_code);
+        }
+
+        int status;
+        while (waitpid(pid, &status, 0) < 0) {
+                if (errno != EINTR) {
+                        *exit_code = EXIT_FAILURE;
+                        return true;
+                }
+        }
+
+        *exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+        return true;
+}
+
+#elif OS == OS_WINDOWS
+
+bool get_file_stamp(const char * path, struct FileStamp * stamp)
+{
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) {
+                return false;
+        }
+
+        memset(stamp, 0, sizeof(*stamp));
+
+        // "FILETIME"s count 100 nanoseconds at a time.
+        uint64_t modified = ((uint64_t) attributes.ftLastWriteTime.dwHighDateTime << 32) |
+                            attributes.ftLastWriteTime.dwLowDateTime;
+        stamp->modified_ns = modified * 100;
+        stamp->size = ((uint64_t) attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+        (void) get_file_id(path, &stamp->id);
+
+        return true;
+}
+
+bool run_in_child_process(int (*run)(void * arg), void * arg, int * exit_code)
+{
+        (void) run;
+        (void) arg;
+        (void) exit_code;
+        return false;
+}
+
+#else
+
+bool get_file_stamp(const char * path, struct FileStamp * stamp)
+{
+        (void) path;
+        (void) stamp;
+        return false;
+}
+
+bool run_in_child_process(int (*run)(void * arg), void * arg, int * exit_code)
+{
+        (void) run;
+        (void) arg;
+        (void) exit_code;
+        return false;
+}
+
+#endif
+
+#if OS == OS_LINUX
+
+void create_file_watcher(struct FileWatcher * watcher)
+{
+        // If inotify isn't available, "wait_for_file_events" falls back to
+        // waiting until the timeout.
+        watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+void destroy_file_watcher(struct FileWatcher * watcher)
+{
+        if (watcher->fd >= 0) {
+                close(watcher->fd);
+        }
+}
+
+void watch_file(struct FileWatcher * watcher, const char * path)
+{
+        if (watcher->fd < 0) {
+                return;
+        }
+
+        // Watching a directory twice just updates the existing watch.
+        const char * last_sep = strrchr(path, '/');
+        if (!last_sep) {
+                (void) inotify_add_watch(watcher->fd, ".", FILE_WATCH_MASK);
+                return;
+        }
+
+        size_t dir_length = last_sep == path ? 1 : last_sep - path;
+        char * dir = ALLOC(char, dir_length + 1);
+        memcpy(dir, path, dir_length);
+        dir[dir_length] = '\0';
+
+        (void) inotify_add_watch(watcher->fd, dir, FILE_WATCH_MASK);
+
+        FREE(dir);
+}
+
+void wait_for_file_events(struct FileWatcher * watcher, int timeout_ms)
+{
+        if (watcher->fd < 0) {
+                (void) poll(NULL, 0, timeout_ms);
+                return;
+        }
+
+        struct pollfd poll_fd;
+        poll_fd.fd = watcher->fd;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+
+        if (poll(&poll_fd, 1, timeout_ms) <= 0) {
+                return;
+        }
+
+        // Which files changed is found out by checking them, so the events
+        // are only read to get rid of them.
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (read(watcher->fd, events, sizeof(events)) > 0) {
+        }
+}
+
+#else
+
+void create_file_watcher(struct FileWatcher * watcher)
+{
+        watcher->unused = 0;
+}
+
+void destroy_file_watcher(struct FileWatcher * watcher)
+{
+        (void) watcher;
+}
+
+void watch_file(struct FileWatcher * watcher, const char * path)
+{
+        (void) watcher;
+        (void) path;
+}
+
+void wait_for_file_events(struct FileWatcher * watcher, int timeout_ms)
+{
+        (void) watcher;
+
+        #if OS_IS_POSIX
+                (void) poll(NULL, 0, timeout_ms);
+        #elif OS == OS_WINDOWS
+                Sleep(timeout_ms);
+        #else
+                uint64_t end_ns = get_monotonic_ns() + (uint64_t) timeout_ms * 1000000;
+                while (get_monotonic_ns() < end_ns) {
+                }
+        #endif
+}
+
+#endif
+
+static volatile sig_atomic_t s_is_termination_requested = 0;
+
+static void request_termination(int signal_number)
+{
+        (void) signal_number;
+        s_is_termination_requested = 1;
+}
+
+void catch_termination_requests(void)
+{
+        #if OS_IS_POSIX
+                // Unlike "signal", "sigaction" keeps the handler after the
+                // first signal on every POSIX system.
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_handler = request_termination;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART;
+                (void) sigaction(SIGTERM, &action, NULL);
+        #else
+                (void) signal(SIGTERM, request_termination);
+        #endif
+}
+
+bool is_termination_requested(void)
+{
+        return s_is_termination_requested != 0;
+}
+
+#if OS_IS_POSIX
+
+bool start_child_process(struct ChildProcess * child, int (*run)(void * arg), void * arg)
+{
+        fflush(NULL);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+                return false;
+        }
+
+        if (pid == 0) {
+                int child_exit_code = run(arg);
+                fflush(NULL);
+                _exit(child_exit_code);
+        }
+
+        child->id = pid;
+        return true;
+}
+
+bool wait_for_child_process(int timeout_ms, struct ChildProcess * child, int * exit_code)
+{
+        // "waitpid" can't time out, so children are polled for instead.
+        uint64_t end_ns = get_monotonic_ns() + (uint64_t) timeout_ms * 1000000;
+        while (true) {
+                int status;
+                pid_t pid = waitpid(-1, &status, WNOHANG);
+                if (pid > 0) {
+                        child->id = pid;
+                        *exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+                        return true;
+                }
+                // Having no children at all isn't an error, so that callers
+                // polling for children don't spin while they have none.
+                if (pid < 0 && errno != EINTR && errno != ECHILD) {
+                        return false;
+                }
+
+                uint64_t now_ns = get_monotonic_ns();
+                if (now_ns >= end_ns) {
+                        return false;
+                }
+
+                int wait_ms = (end_ns - now_ns) / 1000000;
+                (void) poll(NULL, 0, wait_ms < CHILD_POLL_MS ? wait_ms + 1 : CHILD_POLL_MS);
+        }
+}
+
+void terminate_child_process(const struct ChildProcess * child)
+{
+        (void) kill((pid_t) child->id, SIGTERM);
+}
+
+bool listen_on_local_socket(const char * path, struct LocalSocket * listener)
+{
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(address.sun_path)) {
+                LOG_ERROR("The socket path \"%s\" is too long.\n", path);
+                return false;
+        }
+        strcpy(address.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+                LOG_ERROR("Couldn't create a socket.\n");
+                return false;
+        }
+
+        // Waiting processes poll for connections, so the one that doesn't
+        // get to accept one mustn't block.
+        int flags = fcntl(fd, F_GETFL);
+        (void) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+        (void) unlink(path);
+        if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+                LOG_ERROR("Couldn't listen on \"%s\".\n", path);
+                close(fd);
+                return false;
+        }
+
+        listener->fd = fd;
+        return true;
+}
+
+bool accept_local_connection(const struct LocalSocket * listener,
+                             int timeout_ms,
+                             struct LocalSocket * connection)
+{
+        struct pollfd poll_fd;
+        poll_fd.fd = listener->fd;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+        if (poll(&poll_fd, 1, timeout_ms) <= 0) {
+                return false;
+        }
+
+        int fd = accept(listener->fd, NULL, NULL);
+        if (fd < 0) {
+                return false;
+        }
+
+        // Connections may inherit "O_NONBLOCK" from the listener.
+        int flags = fcntl(fd, F_GETFL);
+        (void) fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+
+        connection->fd = fd;
+        return true;
+}
+
+void set_local_socket_timeout(const struct LocalSocket * connection, int timeout_ms)
+{
+        struct timeval timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        (void) setsockopt(connection->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        (void) setsockopt(connection->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+ptrdiff_t read_local_socket(const struct LocalSocket * connection, void * data, size_t size)
+{
+        while (true) {
+                ssize_t read_count = recv(connection->fd, data, size, 0);
+                if (read_count >= 0 || errno != EINTR) {
+                        return read_count;
+                }
+        }
+}
+
+bool write_local_socket(const struct LocalSocket * connection, const void * data, size_t size)
+{
+        // Writing to a closed connection fails rather than raising SIGPIPE,
+        // where the system allows it.
+        #ifdef MSG_NOSIGNAL
+                int flags = MSG_NOSIGNAL;
+        #else
+                int flags = 0;
+        #endif
+
+        const char * bytes = data;
+        while (size > 0) {
+                ssize_t write_count = send(connection->fd, bytes, size, flags);
+                if (write_count < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return false;
+                }
+
+                bytes += write_count;
+                size -= write_count;
+        }
+
+        return true;
+}
+
+void close_local_socket(struct LocalSocket * socket)
+{
+        close(socket->fd);
+        socket->fd = -1;
+}
+
+#else
+
+bool start_child_process(struct ChildProcess * child, int (*run)(void * arg), void * arg)
+{
+        (void) child;
+        (void) run;
+        (void) arg;
+        return false;
+}
+
+bool wait_for_child_process(int timeout_ms, struct ChildProcess * child, int * exit_code)
+{
+        (void) timeout_ms;
+        (void) child;
+        (void) exit_code;
+        return false;
+}
+
+void terminate_child_process(const struct ChildProcess * child)
+{
+        (void) child;
+}
+
+bool listen_on_local_socket(const char * path, struct LocalSocket * listener)
+{
+        (void) listener;
+        LOG_ERROR("Can't listen on \"%s\", since sockets aren't supported on this system.\n",
+                  path);
+        return false;
+}
+
+bool accept_local_connection(const struct LocalSocket * listener,
+                             int timeout_ms,
+                             struct LocalSocket * connection)
+{
+        (void) listener;
+        (void) timeout_ms;
+        (void) connection;
+        return false;
+}
+
+void set_local_socket_timeout(const struct LocalSocket * connection, int timeout_ms)
+{
+        (void) connection;
+        (void) timeout_ms;
+}
+
+ptrdiff_t read_local_socket(const struct LocalSocket * connection, void * data, size_t size)
+{
+        (void) connection;
+        (void) data;
+        (void) size;
+        return -1;
+}
+
+bool write_local_socket(const struct LocalSocket * connection, const void * data, size_t size)
+{
+        (void) connection;
+        (void) data;
+        (void) size;
+        return false;
+}
+
+void close_local_socket(struct LocalSocket * socket)
+{
+        (void) socket;
+}
+
+#endif
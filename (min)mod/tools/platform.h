@@ -0,0 +1,261 @@
+// Things the C standard library can't do (or can't do fast), implemented
+// separately for each operating system in "os.h".
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "os.h"
+
+#if OS_IS_POSIX
+#include <pthread.h>
+#elif OS == OS_WINDOWS
+#include <windows.h>
+#endif
+
+// The read-only contents of a file.
+// The contents are NOT null-terminated, since a memory-mapped file ends
+// wherever the file ends.
+struct FileView {
+        const char * data;
+        size_t length;
+
+        // "true" if "data" is memory-mapped rather than "ALLOC"ed.
+        bool is_mapped;
+};
+
+// Memory-maps the file at "path" when possible (regular files on POSIX
+// systems), and reads it into memory otherwise (pipes, other systems).
+// Returns an invalid view if the file can't be read.
+struct FileView open_file_view(const char * path);
+
+// Like "open_file_view", but nothing is logged if the file can't be read,
+// so that it's safe to call from any thread.
+struct FileView try_open_file_view(const char * path);
+
+bool is_file_view_valid(const struct FileView * view);
+
+void close_file_view(struct FileView * view);
+
+// Identifies a file regardless of the path used to reach it, so that paths
+// like "a/../b", symbolic links and hard links to the same file are
+// recognized as such.
+struct FileId {
+        uint64_t device;
+        uint64_t index;
+};
+
+// Returns "false" if the file doesn't exist, or if the operating system
+// has no way of identifying files.
+bool get_file_id(const char * path, struct FileId * id);
+
+// Nanoseconds since some arbitrary point in time. Unlike the wall clock,
+// it never jumps backwards, so it's suitable for measuring durations.
+uint64_t get_monotonic_ns(void);
+
+// The size of a page of virtual memory, in bytes.
+size_t get_page_size(void);
+
+// The number of CPUs that can run threads at the moment, or 1 if unknown.
+int get_cpu_count(void);
+
+// Thin wrappers around the threads of the operating system.
+// On systems without threads, mutexes and condition variables do nothing
+// and "start_thread" always fails, so callers must be able to do the work
+// themselves.
+#if OS_IS_POSIX
+
+struct Mutex {
+        pthread_mutex_t handle;
+};
+
+struct CondVar {
+        pthread_cond_t handle;
+};
+
+struct Thread {
+        pthread_t handle;
+};
+
+#define MUTEX_INITIALIZER {PTHREAD_MUTEX_INITIALIZER}
+
+#elif OS == OS_WINDOWS
+
+struct Mutex {
+        SRWLOCK handle;
+};
+
+struct CondVar {
+        CONDITION_VARIABLE handle;
+};
+
+struct Thread {
+        HANDLE handle;
+};
+
+#define MUTEX_INITIALIZER {SRWLOCK_INIT}
+
+#else
+
+struct Mutex {
+        int unused;
+};
+
+struct CondVar {
+        int unused;
+};
+
+struct Thread {
+        int unused;
+};
+
+#define MUTEX_INITIALIZER {0}
+
+#endif
+
+// Mutexes and condition variables can't be copied once they're created.
+void create_mutex(struct Mutex * mutex);
+
+void destroy_mutex(struct Mutex * mutex);
+
+void lock_mutex(struct Mutex * mutex);
+
+void unlock_mutex(struct Mutex * mutex);
+
+void create_cond_var(struct CondVar * cond_var);
+
+void destroy_cond_var(struct CondVar * cond_var);
+
+// Unlocks "mutex", which must be locked, until "cond_var" is signaled.
+// Might also return without being signaled, so the condition waited for
+// must be checked again.
+void wait_cond_var(struct CondVar * cond_var, struct Mutex * mutex);
+
+// Wakes up at least one thread waiting for "cond_var", if any.
+void signal_cond_var(struct CondVar * cond_var);
+
+// Wakes up every thread waiting for "cond_var".
+void broadcast_cond_var(struct CondVar * cond_var);
+
+// Runs "run(arg)" on a new thread.
+// Returns "false" if the thread can't be created.
+bool start_thread(struct Thread * thread, void (*run)(void * arg), void * arg);
+
+// Waits until the thread has finished running.
+void join_thread(struct Thread * thread);
+
+// Changes whenever a file is written to or replaced, as far as the
+// operating system can tell.
+struct FileStamp {
+        uint64_t modified_ns;
+        uint64_t size;
+        struct FileId id;
+};
+
+// Returns "false" if the file doesn't exist, or if the operating system
+// has no way of telling when files change.
+bool get_file_stamp(const char * path, struct FileStamp * stamp);
+
+bool are_file_stamps_equal(const struct FileStamp * stamp1, const struct FileStamp * stamp2);
+
+// Waits for files to change. Only Linux tells when they do (using
+// inotify). Elsewhere, "wait_for_file_events" just waits until the timeout,
+// so the files must be checked using "get_file_stamp" either way.
+#if OS == OS_LINUX
+
+struct FileWatcher {
+        int fd;
+};
+
+#else
+
+struct FileWatcher {
+        int unused;
+};
+
+#endif
+
+void create_file_watcher(struct FileWatcher * watcher);
+
+void destroy_file_watcher(struct FileWatcher * watcher);
+
+// Watches the directory of the file at "path", so that the file is noticed
+// even if it's replaced, or created later on.
+void watch_file(struct FileWatcher * watcher, const char * path);
+
+// Returns once something happens to a watched file, or after "timeout_ms"
+// milliseconds.
+void wait_for_file_events(struct FileWatcher * watcher, int timeout_ms);
+
+// Runs "run(arg)" in a copy of the current process, so nothing it does to
+// its memory affects the caller, and stores what it returns in
+// "*exit_code". Everything logged before is written out first, so it's not
+// logged twice.
+// Returns "false" without running anything if processes can't be copied
+// (anywhere but on POSIX systems), in which case the caller has to run it.
+bool run_in_child_process(int (*run)(void * arg), void * arg, int * exit_code);
+
+// Makes SIGTERM set a flag rather than terminate (min)mod, so that it can
+// stop at a point of its choosing once "is_termination_requested" says so.
+void catch_termination_requests(void);
+
+bool is_termination_requested(void);
+
+// Processes running a copy of the current process, which only POSIX
+// systems can make.
+struct ChildProcess {
+        int64_t id;
+};
+
+// Like "run_in_child_process", but returns as soon as the child process is
+// started, rather than waiting for it to exit.
+bool start_child_process(struct ChildProcess * child, int (*run)(void * arg), void * arg);
+
+// Waits at most "timeout_ms" milliseconds for any child process to exit,
+// and stores which one it was and what it returned, even if there are no
+// child processes to begin with.
+// Returns "false" if none exited.
+bool wait_for_child_process(int timeout_ms, struct ChildProcess * child, int * exit_code);
+
+// Sends SIGTERM to "child".
+void terminate_child_process(const struct ChildProcess * child);
+
+// Sockets connecting processes on the same machine through a path in the
+// file system (Unix domain sockets), which are only supported on POSIX
+// systems.
+struct LocalSocket {
+        int fd;
+};
+
+// Creates a socket at "path" listening for connections, replacing any
+// socket left at "path" by a previous process.
+// Returns "false", after logging why, if it can't.
+bool listen_on_local_socket(const char * path, struct LocalSocket * listener);
+
+// Waits at most "timeout_ms" milliseconds for a connection to "listener",
+// and accepts it. Several processes can wait for connections to the same
+// listener, and only one of them accepts each connection.
+// Returns "false" if no connection was accepted.
+bool accept_local_connection(const struct LocalSocket * listener,
+                             int timeout_ms,
+                             struct LocalSocket * connection);
+
+// Makes reading from and writing to "connection" fail if they take longer
+// than "timeout_ms" milliseconds.
+void set_local_socket_timeout(const struct LocalSocket * connection, int timeout_ms);
+
+// Reads at most "size" bytes from "connection" into "data".
+// Returns how many bytes were read, 0 if the other end closed the
+// connection, and -1 if reading failed or timed out.
+ptrdiff_t read_local_socket(const struct LocalSocket * connection, void * data, size_t size);
+
+// Writes all "size" bytes at "data" to "connection".
+// Returns "false" if writing failed or timed out.
+bool write_local_socket(const struct LocalSocket * connection, const void * data, size_t size);
+
+void close_local_socket(struct LocalSocket * socket);
+
+#endif
@@ -0,0 +1,115 @@
+#include "ptr_map.h"
+#include <stdint.h>
+#include "hash.h"
+#include "mem_tools.h"
+
+#define MIN_PTR_MAP_CAPACITY 16
+
+// The map grows before more than half of its slots are used, which keeps
+// the probe sequences short.
+#define MAX_LOAD_NUMERATOR 1
+#define MAX_LOAD_DENOMINATOR 2
+
+static struct PtrMapSlot * allocate_slots(size_t capacity)
+{
+        struct PtrMapSlot * slots = ALLOC(struct PtrMapSlot, capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+                slots[i].key = NULL;
+        }
+        return slots;
+}
+
+struct PtrMap create_ptr_map(void)
+{
+        struct PtrMap map;
+        map.capacity = MIN_PTR_MAP_CAPACITY;
+        map.length = 0;
+        map.slots = allocate_slots(map.capacity);
+
+        return map;
+}
+
+void destroy_ptr_map(struct PtrMap * map)
+{
+        FREE(map->slots);
+        map->slots = NULL;
+        map->capacity = 0;
+        map->length = 0;
+}
+
+// The address itself is hashed, since its lowest bits are the same for
+// everything aligned alike.
+static uint64_t hash_ptr(const void * key)
+{
+        uintptr_t address = (uintptr_t) key;
+        return hash_bytes(&address, sizeof(address), HASH_SEED);
+}
+
+// Returns the slot containing the key, or the empty slot where it would
+// be inserted if it isn't in the map.
+static struct PtrMapSlot * find_slot(const struct PtrMapSlot * slots,
+                                     size_t capacity,
+                                     const void * key)
+{
+        size_t mask = capacity - 1;
+        size_t idx = hash_ptr(key) & mask;
+
+        // There's always at least one empty slot, so this terminates.
+        while (slots[idx].key && slots[idx].key != key) {
+                idx = (idx + 1) & mask;
+        }
+
+        return (struct PtrMapSlot *) &slots[idx];
+}
+
+static void grow_ptr_map(struct PtrMap * map)
+{
+        size_t new_capacity = map->capacity * 2;
+        struct PtrMapSlot * new_slots = allocate_slots(new_capacity);
+
+        for (size_t i = 0; i < map->capacity; ++i) {
+                const struct PtrMapSlot * old_slot = &map->slots[i];
+                if (!old_slot->key) {
+                        continue;
+                }
+
+                *find_slot(new_slots, new_capacity, old_slot->key) = *old_slot;
+        }
+
+        FREE(map->slots);
+        map->slots = new_slots;
+        map->capacity = new_capacity;
+}
+
+bool ptr_map_find(const struct PtrMap * map, const void * key, size_t * value)
+{
+        const struct PtrMapSlot * slot = find_slot(map->slots, map->capacity, key);
+        if (!slot->key) {
+                return false;
+        }
+
+        *value = slot->value;
+        return true;
+}
+
+bool ptr_map_contains(const struct PtrMap * map, const void * key)
+{
+        return find_slot(map->slots, map->capacity, key)->key != NULL;
+}
+
+void ptr_map_insert(struct PtrMap * map, const void * key, size_t value)
+{
+        ASSERT(key, "Pointer maps can't have \"NULL\" as a key.");
+
+        if ((map->length + 1) * MAX_LOAD_DENOMINATOR > map->capacity * MAX_LOAD_NUMERATOR) {
+                grow_ptr_map(map);
+        }
+
+        struct PtrMapSlot * slot = find_slot(map->slots, map->capacity, key);
+
+        ASSERT(!slot->key, "%p is already in the pointer map.", key);
+
+        slot->key = key;
+        slot->value = value;
+        ++map->length;
+}
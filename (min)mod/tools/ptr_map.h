@@ -0,0 +1,39 @@
+// Hash map from pointers to indices, using open addressing with linear
+// probing, for looking things up by their address rather than by what
+// they contain, such as telling apart stacks that look alike.
+
+#ifndef PTR_MAP_H
+#define PTR_MAP_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+struct PtrMapSlot {
+        // "NULL" if the slot is empty.
+        const void * key;
+        size_t value;
+};
+
+struct PtrMap {
+        // "capacity" is always a power of two, so a hash can be turned
+        // into an index using a bitmask rather than a modulo.
+        struct PtrMapSlot * slots;
+        size_t capacity;
+        size_t length;
+};
+
+struct PtrMap create_ptr_map(void);
+
+void destroy_ptr_map(struct PtrMap * map);
+
+// Returns "true" and sets "*value" iff "key" is in the map.
+bool ptr_map_find(const struct PtrMap * map, const void * key, size_t * value);
+
+// Returns "true" iff "key" is in the map, for maps used as sets.
+bool ptr_map_contains(const struct PtrMap * map, const void * key);
+
+// Maps "key", which can't be "NULL", to "value". "key" cannot already be
+// in the map.
+void ptr_map_insert(struct PtrMap * map, const void * key, size_t value);
+
+#endif
@@ -0,0 +1,117 @@
+#include "str_map.h"
+#include <string.h>
+#include "hash.h"
+#include "mem_tools.h"
+
+#define MIN_STR_MAP_CAPACITY 16
+
+// The map grows before more than half of its slots are used, which keeps
+// the probe sequences short.
+#define MAX_LOAD_NUMERATOR 1
+#define MAX_LOAD_DENOMINATOR 2
+
+static struct StrMapSlot * allocate_slots(size_t capacity)
+{
+        struct StrMapSlot * slots = ALLOC(struct StrMapSlot, capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+                slots[i].key = NULL;
+        }
+        return slots;
+}
+
+struct StrMap create_str_map(void)
+{
+        struct StrMap map;
+        map.capacity = MIN_STR_MAP_CAPACITY;
+        map.length = 0;
+        map.slots = allocate_slots(map.capacity);
+
+        return map;
+}
+
+void destroy_str_map(struct StrMap * map)
+{
+        FREE(map->slots);
+        map->slots = NULL;
+        map->capacity = 0;
+        map->length = 0;
+}
+
+// Returns the slot containing the key, or the empty slot where it would
+// be inserted if it isn't in the map.
+static struct StrMapSlot * find_slot(const struct StrMapSlot * slots,
+                                     size_t capacity,
+                                     const char * key,
+                                     size_t key_length,
+                                     uint64_t hash)
+{
+        size_t mask = capacity - 1;
+        size_t idx = hash & mask;
+
+        // There's always at least one empty slot, so this terminates.
+        while (slots[idx].key) {
+                const struct StrMapSlot * slot = &slots[idx];
+                if (slot->hash == hash &&
+                    slot->key_length == key_length &&
+                    memcmp(slot->key, key, key_length) == 0) {
+                        break;
+                }
+                idx = (idx + 1) & mask;
+        }
+
+        return (struct StrMapSlot *) &slots[idx];
+}
+
+static void grow_str_map(struct StrMap * map)
+{
+        size_t new_capacity = map->capacity * 2;
+        struct StrMapSlot * new_slots = allocate_slots(new_capacity);
+
+        for (size_t i = 0; i < map->capacity; ++i) {
+                const struct StrMapSlot * old_slot = &map->slots[i];
+                if (!old_slot->key) {
+                        continue;
+                }
+
+                struct StrMapSlot * new_slot = find_slot(new_slots, new_capacity,
+                                                         old_slot->key,
+                                                         old_slot->key_length,
+                                                         old_slot->hash);
+                *new_slot = *old_slot;
+        }
+
+        FREE(map->slots);
+        map->slots = new_slots;
+        map->capacity = new_capacity;
+}
+
+bool str_map_find(const struct StrMap * map, const char * key, size_t key_length, size_t * value)
+{
+        uint64_t hash = hash_bytes(key, key_length, HASH_SEED);
+        const struct StrMapSlot * slot = find_slot(map->slots, map->capacity,
+                                                   key, key_length, hash);
+        if (!slot->key) {
+                return false;
+        }
+
+        *value = slot->value;
+        return true;
+}
+
+void str_map_insert(struct StrMap * map, const char * key, size_t key_length, size_t value)
+{
+        if ((map->length + 1) * MAX_LOAD_DENOMINATOR > map->capacity * MAX_LOAD_NUMERATOR) {
+                grow_str_map(map);
+        }
+
+        uint64_t hash = hash_bytes(key, key_length, HASH_SEED);
+        struct StrMapSlot * slot = find_slot(map->slots, map->capacity, key, key_length, hash);
+
+        ASSERT(!slot->key, "\"%.*s\" is already in the string map.", (int) key_length, key);
+
+        slot->key = key;
+        slot->key_length = key_length;
+        slot->hash = hash;
+        slot->value = value;
+        ++map->length;
+}
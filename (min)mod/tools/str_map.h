@@ -0,0 +1,40 @@
+// Hash map from strings to indices, using open addressing with linear
+// probing.
+// The map doesn't own its keys, so they must outlive it.
+
+#ifndef STR_MAP_H
+#define STR_MAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct StrMapSlot {
+        // "NULL" if the slot is empty.
+        const char * key;
+        size_t key_length;
+        uint64_t hash;
+        size_t value;
+};
+
+struct StrMap {
+        // "capacity" is always a power of two, so a hash can be turned
+        // into an index using a bitmask rather than a modulo.
+        struct StrMapSlot * slots;
+        size_t capacity;
+        size_t length;
+};
+
+struct StrMap create_str_map(void);
+
+void destroy_str_map(struct StrMap * map);
+
+// Looks up the first "key_length" characters of "key". "key" doesn't have
+// to be null-terminated.
+// Returns "true" and sets "*value" iff the key is in the map.
+bool str_map_find(const struct StrMap * map, const char * key, size_t key_length, size_t * value);
+
+// Maps "key" to "value". "key" cannot already be in the map.
+void str_map_insert(struct StrMap * map, const char * key, size_t key_length, size_t value);
+
+#endif
@@ -0,0 +1,63 @@
+#include "str_table.h"
+#include <string.h>
+#include "mem_tools.h"
+
+static void free_str(void * str)
+{
+        FREE(*(char **) str);
+}
+
+struct StrTable create_str_table(void)
+{
+        struct StrTable table;
+        table.strings = create_list(sizeof(char *), free_str);
+        table.ids = create_str_map();
+
+        return table;
+}
+
+void destroy_str_table(struct StrTable * table)
+{
+        // The map's keys are owned by "strings", so it must go first.
+        destroy_str_map(&table->ids);
+        destroy_list(&table->strings);
+}
+
+str_id_t intern_str(struct StrTable * table, const char * str, size_t length)
+{
+        size_t id;
+        if (str_map_find(&table->ids, str, length, &id)) {
+                return (str_id_t) id;
+        }
+
+        char * str_cpy = ALLOC(char, length + 1);
+        memcpy(str_cpy, str, length);
+        str_cpy[length] = '\0';
+
+        id = table->strings.length;
+        list_append(&table->strings, &str_cpy);
+        str_map_insert(&table->ids, str_cpy, length, id);
+
+        return (str_id_t) id;
+}
+
+bool str_table_find(const struct StrTable * table, const char * str, size_t length, str_id_t * id)
+{
+        size_t found_id;
+        if (!str_map_find(&table->ids, str, length, &found_id)) {
+                return false;
+        }
+
+        *id = (str_id_t) found_id;
+        return true;
+}
+
+const char * str_table_get(const struct StrTable * table, str_id_t id)
+{
+        return *(char * const *) get_list_elem_const(&table->strings, id);
+}
+
+size_t str_table_length(const struct StrTable * table)
+{
+        return table->strings.length;
+}
@@ -0,0 +1,41 @@
+// Interned strings. Every distinct string is stored once and given a
+// small integer ID, so strings can be compared by comparing their IDs.
+
+#ifndef STR_TABLE_H
+#define STR_TABLE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "list.h"
+#include "str_map.h"
+
+typedef unsigned int str_id_t;
+
+struct StrTable {
+        // "char *"s owned by the table, indexed by their IDs. IDs are handed
+        // out in the order strings are first interned.
+        struct List strings;
+
+        // Maps the strings in "strings" to their IDs.
+        struct StrMap ids;
+};
+
+struct StrTable create_str_table(void);
+
+void destroy_str_table(struct StrTable * table);
+
+// Returns the ID of the first "length" characters of "str", copying them
+// into the table if they haven't been interned before. "str" doesn't have
+// to be null-terminated.
+str_id_t intern_str(struct StrTable * table, const char * str, size_t length);
+
+// Returns "true" and sets "*id" iff the first "length" characters of
+// "str" are interned.
+bool str_table_find(const struct StrTable * table, const char * str, size_t length, str_id_t * id);
+
+// Returns the null-terminated string with ID "id".
+const char * str_table_get(const struct StrTable * table, str_id_t id);
+
+size_t str_table_length(const struct StrTable * table);
+
+#endif
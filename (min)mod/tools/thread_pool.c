@@ -0,0 +1,158 @@
+#include "thread_pool.h"
+#include "log.h"
+#include "mem_tools.h"
+
+struct Task create_task(void (*run)(void * arg), void * arg)
+{
+        struct Task task;
+        task.run = run;
+        task.arg = arg;
+        task.is_started = false;
+        task.is_done = false;
+        task.next = NULL;
+
+        return task;
+}
+
+// Removes the first task from the queue. The mutex must be locked.
+static struct Task * pop_first_task(struct ThreadPool * pool)
+{
+        struct Task * task = pool->first_task;
+        pool->first_task = task->next;
+        if (!pool->first_task) {
+                pool->last_task = NULL;
+        }
+        task->is_started = true;
+
+        return task;
+}
+
+// Removes "task", which must be queued, from the queue. The mutex must be
+// locked.
+static void remove_task(struct ThreadPool * pool, struct Task * task)
+{
+        struct Task * prev = NULL;
+        struct Task * curr = pool->first_task;
+        while (curr != task) {
+                prev = curr;
+                curr = curr->next;
+        }
+
+        if (prev) {
+                prev->next = task->next;
+        } else {
+                pool->first_task = task->next;
+        }
+        if (pool->last_task == task) {
+                pool->last_task = prev;
+        }
+        task->is_started = true;
+}
+
+// Runs "task" with the mutex unlocked, then marks it as done. The mutex
+// must be locked.
+static void run_task(struct ThreadPool * pool, struct Task * task)
+{
+        unlock_mutex(&pool->mutex);
+        task->run(task->arg);
+        lock_mutex(&pool->mutex);
+
+        task->is_done = true;
+        broadcast_cond_var(&pool->task_done);
+}
+
+static void run_worker(void * arg)
+{
+        struct ThreadPool * pool = arg;
+
+        lock_mutex(&pool->mutex);
+        while (true) {
+                while (!pool->first_task && !pool->is_stopping) {
+                        wait_cond_var(&pool->task_submitted, &pool->mutex);
+                }
+                if (pool->is_stopping) {
+                        break;
+                }
+
+                run_task(pool, pop_first_task(pool));
+        }
+        unlock_mutex(&pool->mutex);
+}
+
+struct ThreadPool * create_thread_pool(int thread_count)
+{
+        ASSERT(thread_count >= 0, "Invalid thread count %d.", thread_count);
+
+        struct ThreadPool * pool = ALLOC(struct ThreadPool, 1);
+        create_mutex(&pool->mutex);
+        create_cond_var(&pool->task_submitted);
+        create_cond_var(&pool->task_done);
+        pool->first_task = NULL;
+        pool->last_task = NULL;
+        pool->is_stopping = false;
+
+        pool->threads = ALLOC(struct Thread, thread_count);
+        pool->thread_count = 0;
+        for (int i = 0; i < thread_count; ++i) {
+                if (!start_thread(&pool->threads[i], run_worker, pool)) {
+                        LOG_WARNING("Could only start %d of %d threads.\n", i, thread_count);
+                        break;
+                }
+                ++pool->thread_count;
+        }
+
+        return pool;
+}
+
+void destroy_thread_pool(struct ThreadPool * pool)
+{
+        lock_mutex(&pool->mutex);
+        pool->is_stopping = true;
+        broadcast_cond_var(&pool->task_submitted);
+        unlock_mutex(&pool->mutex);
+
+        for (int i = 0; i < pool->thread_count; ++i) {
+                join_thread(&pool->threads[i]);
+        }
+
+        FREE(pool->threads);
+        destroy_cond_var(&pool->task_done);
+        destroy_cond_var(&pool->task_submitted);
+        destroy_mutex(&pool->mutex);
+        FREE(pool);
+}
+
+void submit_task(struct ThreadPool * pool, struct Task * task)
+{
+        task->is_started = false;
+        task->is_done = false;
+        task->next = NULL;
+
+        lock_mutex(&pool->mutex);
+
+        if (pool->last_task) {
+                pool->last_task->next = task;
+        } else {
+                pool->first_task = task;
+        }
+        pool->last_task = task;
+
+        signal_cond_var(&pool->task_submitted);
+        unlock_mutex(&pool->mutex);
+}
+
+void wait_for_task(struct ThreadPool * pool, struct Task * task)
+{
+        lock_mutex(&pool->mutex);
+
+        if (!task->is_started) {
+                remove_task(pool, task);
+                run_task(pool, task);
+        }
+
+        while (!task->is_done) {
+                wait_cond_var(&pool->task_done, &pool->mutex);
+        }
+
+        unlock_mutex(&pool->mutex);
+}
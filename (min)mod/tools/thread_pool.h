@@ -0,0 +1,49 @@
+// A fixed set of threads running tasks submitted by other threads.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include "platform.h"
+
+// Owned by whoever submits it, and must stay in place until it's done.
+struct Task {
+        void (*run)(void * arg);
+        void * arg;
+
+        // Only touched by the thread pool, with its mutex locked.
+        bool is_started;
+        bool is_done;
+        struct Task * next;
+};
+
+struct ThreadPool {
+        struct Mutex mutex;
+        struct CondVar task_submitted;
+        struct CondVar task_done;
+
+        // Tasks that aren't started yet, in the order they were submitted.
+        struct Task * first_task;
+        struct Task * last_task;
+
+        struct Thread * threads;
+        int thread_count;
+        bool is_stopping;
+};
+
+struct Task create_task(void (*run)(void * arg), void * arg);
+
+// If no threads can be started, tasks are run by "wait_for_task" instead.
+struct ThreadPool * create_thread_pool(int thread_count);
+
+// Waits for the threads to finish their current tasks. Tasks that aren't
+// started yet never will be.
+void destroy_thread_pool(struct ThreadPool * pool);
+
+void submit_task(struct ThreadPool * pool, struct Task * task);
+
+// Returns once "task" is done. If no thread has started it yet, it's run
+// on the calling thread rather than waiting for one to become available.
+void wait_for_task(struct ThreadPool * pool, struct Task * task);
+
+#endif
@@ -0,0 +1,142 @@
+#include "work_stealing.h"
+#include "platform.h"
+#include "mem_tools.h"
+#include "log.h"
+
+// The jobs a thread hasn't started yet, from "begin" up to but not
+// including "end".
+struct JobRange {
+        struct Mutex mutex;
+        size_t begin;
+        size_t end;
+};
+
+struct Worker {
+        struct Scheduler * scheduler;
+        int index;
+};
+
+struct Scheduler {
+        void (*run)(void * arg, size_t job);
+        void * arg;
+
+        // One per thread.
+        struct JobRange * ranges;
+        int thread_count;
+};
+
+// Takes the first job of "range". Returns "false" if it's empty.
+static bool take_job(struct JobRange * range, size_t * job)
+{
+        lock_mutex(&range->mutex);
+
+        bool has_job = range->begin < range->end;
+        if (has_job) {
+                *job = range->begin;
+                ++range->begin;
+        }
+
+        unlock_mutex(&range->mutex);
+
+        return has_job;
+}
+
+// Moves the back half of the jobs of another thread, rounded up, to the
+// range of the thread "index". Returns "false" if every other thread is out
+// of jobs, which means that they're all running or done, since jobs are
+// never added.
+static bool steal_jobs(struct Scheduler * scheduler, int index)
+{
+        for (int i = 1; i < scheduler->thread_count; ++i) {
+                struct JobRange * victim = &scheduler->ranges[(index + i) % scheduler->thread_count];
+
+                lock_mutex(&victim->mutex);
+
+                size_t begin = victim->begin + (victim->end - victim->begin) / 2;
+                size_t end = victim->end;
+                victim->end = begin;
+
+                unlock_mutex(&victim->mutex);
+
+                if (begin < end) {
+                        struct JobRange * range = &scheduler->ranges[index];
+
+                        lock_mutex(&range->mutex);
+                        range->begin = begin;
+                        range->end = end;
+                        unlock_mutex(&range->mutex);
+
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+static void run_worker(void * arg)
+{
+        struct Worker * worker = arg;
+        struct Scheduler * scheduler = worker->scheduler;
+        struct JobRange * range = &scheduler->ranges[worker->index];
+
+        do {
+                size_t job;
+                while (take_job(range, &job)) {
+                        scheduler->run(scheduler->arg, job);
+                }
+        } while (steal_jobs(scheduler, worker->index));
+}
+
+void run_jobs(size_t job_count, int thread_count, void (*run)(void * arg, size_t job), void * arg)
+{
+        ASSERT(thread_count > 0, "Invalid thread count %d.", thread_count);
+
+        if ((size_t) thread_count > job_count) {
+                thread_count = job_count > 0 ? job_count : 1;
+        }
+
+        struct Scheduler scheduler;
+        scheduler.run = run;
+        scheduler.arg = arg;
+        scheduler.ranges = ALLOC(struct JobRange, thread_count);
+        scheduler.thread_count = thread_count;
+
+        // The jobs are split evenly to begin with.
+        for (int i = 0; i < thread_count; ++i) {
+                struct JobRange * range = &scheduler.ranges[i];
+                create_mutex(&range->mutex);
+                range->begin = job_count * i / thread_count;
+                range->end = job_count * (i + 1) / thread_count;
+        }
+
+        struct Worker * workers = ALLOC(struct Worker, thread_count);
+        struct Thread * threads = ALLOC(struct Thread, thread_count);
+        int started_count = 0;
+        for (int i = 0; i < thread_count; ++i) {
+                workers[i].scheduler = &scheduler;
+                workers[i].index = i;
+        }
+
+        // The calling thread is worker 0. Jobs of threads that can't be
+        // started are stolen by the others.
+        for (int i = 1; i < thread_count; ++i) {
+                if (!start_thread(&threads[i], run_worker, &workers[i])) {
+                        LOG_WARNING("Could only start %d of %d threads.\n", i, thread_count);
+                        break;
+                }
+                ++started_count;
+        }
+
+        run_worker(&workers[0]);
+
+        for (int i = 1; i <= started_count; ++i) {
+                join_thread(&threads[i]);
+        }
+
+        for (int i = 0; i < thread_count; ++i) {
+                destroy_mutex(&scheduler.ranges[i].mutex);
+        }
+        FREE(threads);
+        FREE(workers);
+        FREE(scheduler.ranges);
+}
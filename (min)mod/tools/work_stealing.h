@@ -0,0 +1,19 @@
+// Runs a fixed number of independent jobs on several threads.
+// Each thread starts out with a range of jobs of its own, running them from
+// the front. A thread that runs out of jobs steals the back half of the
+// range of another thread, so that threads that get quick jobs help those
+// that get slow ones, without every job going through a single queue.
+
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <stddef.h>
+
+// Runs "run(arg, job)" for every "job" below "job_count" using
+// "thread_count" threads, the calling thread being one of them, and returns
+// once every job is done. Jobs run at the same time as each other, and in
+// no particular order. If no more threads can be started, the jobs are run
+// by the threads that could.
+void run_jobs(size_t job_count, int thread_count, void (*run)(void * arg, size_t job), void * arg);
+
+#endif